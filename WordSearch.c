@@ -3,12 +3,12 @@
    Program:    WordSearch
    File:       WordSearch.c
    
-   Version:    V1.2
-   Date:       12.07.01
+   Version:    V2.26
+   Date:       18.10.26
    Function:   Build a WordSearch creating PostScript, LaTeX or ASCII
-               output
+               output. Command line front end to libwordsearch
    
-   Copyright:  (c) SciTech Software 1994-2001
+   Copyright:  (c) SciTech Software 1994-2026
    Author:     Dr. Andrew C. R. Martin
    Address:    SciTech Software
                23, Stag Leys,
@@ -39,6 +39,11 @@
 
    Usage:
    ======
+   Build with:
+      make
+   or:
+      cc -O2 -o wordsearch WordSearch.c libwordsearch.c -lpthread -lz
+   and the benchmarks in bench/ with "make bench".
 
 **************************************************************************
 
@@ -48,90 +53,205 @@
                   N.B. SortByLength() is currently a dummy routine. 
    V1.1  11.07.01 Outputs a proper PostScript header
    V1.2  12.07.01 Fixed bug in selecting random start for diagonals
+   V1.3  18.10.26 Replaced the MAXTRY random-retry placement with an
+                  exhaustive backtracking search. SortByLength() is now
+                  implemented.   By: agent
+   V1.4  18.10.26 Added batch mode (-b, -j). Grid, word order and output
+                  are now per-worker state rather than globals   By: agent
+   V2.0  18.10.26 The generator and renderers are now in libwordsearch.c
+                  and this file is just the command line program   By: agent
+   V2.1  18.10.26 Added -seed. Puzzle seeds come from wsPuzzleSeed()
+                  By: agent
+   V2.2  18.10.26 Any length of word list is read. Warns when long words
+                  are skipped   By: agent
+   V2.3  18.10.26 Added -sample, -minlen and -quota   By: agent
+   V2.4  18.10.26 Added -portfolio   By: agent
+   V2.5  18.10.26 Added -stats which writes a JSON summary of the work
+                  done   By: agent
+   V2.6  18.10.26 Added -server which serves requests on a Unix domain
+                  socket or stdin and stdout   By: agent
+   V2.7  18.10.26 Added -tile. Large grids are filled in tiles using -j
+                  threads   By: agent
+   V2.8  18.10.26 Added -verify and -solve   By: agent
+   V2.9  18.10.26 Added -unique   By: agent
+   V2.10 18.10.26 Added -dirs. Words may run in all eight directions
+                  By: agent
+   V2.11 18.10.26 Added -cache   By: agent
+   V2.12 18.10.26 Added -book which writes a batch as one document with
+                  an answer key   By: agent
+   V2.13 18.10.26 Added -pdf   By: agent
+   V2.14 18.10.26 Added -mkindex which compiles a word index and -index,
+                  -with and -without which sample each puzzle's words
+                  from one   By: agent
+   V2.15 18.10.26 Added -dense   By: agent
+   V2.16 18.10.26 Added -g auto   By: agent
+   V2.17 18.10.26 Added -deadline and -fallback. Dropped words are
+                  reported   By: agent
+   V2.18 18.10.26 Added -save which adds each puzzle to a puzzle file and
+                  render (or -render) which renders the puzzles of one
+                  such file   By: agent
+   V2.19 18.10.26 Added -budget. The stats count puzzles given up on
+                  By: agent
+   V2.20 18.10.26 Server requests may not change the cache, give driver
+                  file switches or ask for too many puzzles   By: agent
+   V2.21 18.10.26 The usage message gives WS_VERSION   By: agent
+   V2.22 18.10.26 Threaded batches hold at most RUNAHEAD puzzles per
+                  worker that are built but not yet written   By: agent
+   V2.23 18.10.26 The usage message gives the largest portfolio   By: agent
+   V2.24 18.10.26 Server requests may not ask for too large a grid,
+                  portfolio, number of threads or number of words   By: agent
+   V2.25 18.10.26 A word index is written to a file of its own and then
+                  renamed into place, so a server mapping the old one
+                  keeps it   By: agent
+   V2.26 18.10.26 Build notes give the Makefile   By: agent
 
 *************************************************************************/
 /* Includes
 */
+#define _POSIX_C_SOURCE 200809L    /* For open_memstream()              */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "wordsearch.h"
 
 /************************************************************************/
 /* Defines and macros
 */
-typedef int BOOL;
-
-#define TERMINATE(x) {  int j;               \
-                        for(j=0; x[j]; j++)  \
-                        {  if(x[j] == '\n')  \
-                           {  x[j] = '\0';   \
-                              break;         \
-                     }  }  }
+#define MAXBUFF     160
+#define MAXSWITCHES 128    /* Most switches in a server request         */
+#define LISTENQUEUE  16    /* Connections waiting to be accepted        */
+#define OUTBLOCK  65536    /* First size of a server output buffer      */
+#define RUNAHEAD      4    /* Puzzles built ahead per worker            */
+#define MAXREQUESTPUZZLES 1000 /* Most puzzles in one server request    */
+#define MAXREQUESTGRID    1024 /* Largest grid in a server request      */
+#define MAXREQUESTPORTFOLIO  8 /* Most searches raced in a request      */
+#define MAXREQUESTTHREADS    8 /* Most threads (-j) for a request       */
+#define MAXREQUESTWORDS   1000 /* Most words (-w) in a request          */
 
-#define UPPER(x) {  int i; \
-                    for(i=0; i<(int)strlen(x) && x[i]; i++) \
-                       x[i] = (char)toupper(x[i]);          \
-                 }
+/* A request's setting is over a limit unless the server has it too     */
+#define OVERLIMIT(request, server, limit) \
+   ((request) > (limit) && (request) != (server))
 
+/************************************************************************/
+/* Type definitions
+*/
+typedef struct             /* One worker's share of a batch             */
+{
+   pthread_mutex_t lock;
+   int             lo, hi; /* Puzzles lo..hi-1 have not been started    */
+}  WORKQUEUE;
 
-#ifndef TRUE
-#define TRUE          1
-#define FALSE         0
-#endif
+typedef struct             /* A rendered puzzle awaiting output         */
+{
+   char   *text,
+          *answer;         /* Solution page of a book                   */
+   size_t length,
+          answerLength;
+   char   *saved;          /* The puzzle as kept in a puzzle file       */
+   size_t savedLength;
+   BOOL   done;
+   int    status;
+}  RESULT;
 
-#define MAXBUFF     160
+typedef struct             /* State shared by all workers in a batch    */
+{
+   WSOPTIONS       *options;
+   BOOL            book;      /* Render book pages                      */
+   WSWORDLIST      *words;    /* Word list, shared read-only            */
+   uint64_t        seed;      /* Base random number seed                */
+   FILE            *save;     /* Puzzle file to add the puzzles to      */
+   int             nthreads;
+   WORKQUEUE       *queues;   /* One per worker                         */
+   RESULT          *results;  /* One per puzzle                         */
+   int             npuzzles,
+                   next,      /* First puzzle not yet in a queue        */
+                   written;   /* Puzzles written so far                 */
+   pthread_mutex_t lock;      /* Protects results[], next and written   */
+   pthread_cond_t  finished,  /* Signalled as each puzzle completes     */
+                   space;     /* Signalled as each puzzle is written    */
+}  BATCH;
 
-#define STYLE_PS      1    /* Output styles                             */
-#define STYLE_LATEX   2
-#define STYLE_ASCII   3
+typedef struct
+{
+   BATCH     *batch;
+   int       id;
+   pthread_t thread;
+   WSSTATS   stats;        /* Work done by this worker                  */
+}  WORKER;
 
-#define MAXWORDS     30    /* These defaults may be modified            */
-#define MAXWORDLEN   15
-#define GRIDSIZE     20
-#define MAXTRY      100
+typedef struct             /* State shared by all server threads        */
+{
+   WSOPTIONS       options;   /* Switches the server was given          */
+   int             listenfd;
+   pthread_mutex_t lock;      /* Protects nrequests                     */
+   int             nrequests; /* Requests started, for default seeds    */
+   WSINDEX         *index;    /* Word index given to the server         */
+}  SERVER;
 
-/************************************************************************/
-/* Globals
-*/
-FILE  *gIn        = NULL, 
-      *gOut       = NULL;
-BOOL  gSolution   = FALSE,
-      gWordList   = TRUE;
-int   gMaxWords   = MAXWORDS,
-      gMaxWordLen = MAXWORDLEN,
-      gGridSize   = GRIDSIZE,
-      gOutput     = STYLE_PS,
-      gFontSize   = 18;
-char  **gGrid     = NULL,
-      **gWords    = NULL;
+typedef struct             /* One server thread and what it keeps       */
+{
+   SERVER     *server;
+   pthread_t  thread;
+   WSOPTIONS  options;     /* Options of the current request            */
+   WSCONTEXT  *ctx;
+   WSWORDLIST *words;
+   char       *buffer,     /* Output of the current request             */
+              *dropped;    /* Words its puzzles dropped, each after a
+                              space                                     */
+   size_t     used,
+              size,
+              droppedUsed,
+              droppedSize;
+}  SERVERWORKER;
 
 /************************************************************************/
 /* Prototypes
 */
 int  main(int argc, char **argv);
-BOOL Initialise(char *infile, char *outfile);
-BOOL ReadCmdLine(int argc, char **argv, char *infile, char *outfile);
-BOOL BuildArrays(void);
-BOOL OpenFiles(char *infile, char *outfile);
-int  ReadInputData(void);
-BOOL FitWords(int NWords);
-void PrintSolution(void);
-void FillSpaces(void);
-void PrintPuzzle(int NWords);
+BOOL Initialise(char *infile, char *outfile, WSOPTIONS *options);
+BOOL ReadCmdLine(int argc, char **argv, char *infile, char *outfile,
+                 WSOPTIONS *options);
+BOOL OpenFiles(char *infile, char *outfile, FILE **in, FILE **out);
+BOOL RunBatch(WSOPTIONS *options, WSWORDLIST *words, uint64_t seed,
+              FILE *out, WSSTATS *stats);
+int  MakePuzzle(WSCONTEXT *ctx, WSWORDLIST *words, uint64_t seed,
+                int index, FILE *out, FILE *answer, FILE *save,
+                WSSTATS *stats);
+int  RenderPuzzle(WSCONTEXT *ctx, FILE *out, FILE *answer, FILE *save);
+void BuildResult(WSCONTEXT *ctx, WSWORDLIST *words, uint64_t seed,
+                 int index, BOOL book, BOOL save, RESULT *result,
+                 WSSTATS *stats);
+int  WriteResult(RESULT *result, WSBOOK *book, FILE *out, FILE *save);
+void ReportDropped(WSCONTEXT *ctx, int index);
+void *BatchWorker(void *arg);
+BOOL NextPuzzle(BATCH *batch, int id, int *index);
+BOOL WriteStats(WSOPTIONS *options, WSSTATS *stats, uint64_t readNs,
+                uint64_t totalNs);
+BOOL SolveGrid(WSOPTIONS *options, WSWORDLIST *words, FILE *out);
+WSINDEX *OpenIndex(const char *filename);
+BOOL WriteIndex(WSOPTIONS *options, WSWORDLIST *words);
+BOOL RenderPuzzles(WSOPTIONS *options, FILE *in, FILE *out);
+char *ReadGrid(const char *filename, int *gridsize);
+uint64_t NowNs(void);
+BOOL RunServer(WSOPTIONS *options);
+void *ServerWorker(void *arg);
+void ServeRequests(SERVERWORKER *worker, FILE *in, FILE *out);
+const char *StartRequest(SERVERWORKER *worker, char *switches);
+const char *FinishRequest(SERVERWORKER *worker);
+size_t BufferWrite(void *handle, const char *buffer, size_t length);
+BOOL AddDropped(SERVERWORKER *worker, const char *word);
+void FreeServerWorker(SERVERWORKER *worker);
 void Usage(void);
-void SortByLength(char **gWords, int NWords);
-int  RandomNum(int maxran);
-BOOL PlaceWord(char *word);
-void InitOutput(int style);
-void EndOutput(int style);
-void DoPSOutput(char **grid, int gridsize, BOOL WordList, int NWords, 
-                BOOL solution);
-void DoLaTeXOutput(char **grid, int gridsize, BOOL WordList, int NWords, 
-                   BOOL solution);
-void DoASCIIOutput(char **grid, int gridsize, BOOL WordList, 
-                   int NWords, BOOL solution);
 
 /************************************************************************/
 /*>int main(int argc, char **argv)
@@ -140,43 +260,104 @@ void DoASCIIOutput(char **grid, int gridsize, BOOL WordList,
    
    13.01.94 Original    By: ACRM
    14.01.94 Added calls to InitOutput() and EndOutput()
+   18.10.26 Modified    By: agent
+            The word list is read once and the puzzles are built by
+            RunBatch()
+            Warns about skipped words
+            Writes the stats with -stats
+            Runs the server with -server
+            Solves a grid with -solve
+            Reads and writes word indexes
+            Renders puzzle files
 */
 int main(int argc, char **argv)
 {
-   char  infile[MAXBUFF],
-         outfile[MAXBUFF];
-   int   NWords = 0;
+   char         infile[MAXBUFF],
+                outfile[MAXBUFF];
+   WSOPTIONS    options;
+   WSWORDLIST   *words;
+   WSINDEX      *index = NULL;
+   WSSTATS      stats;
+   FILE         *in, 
+                *out;
+   int          retval = 0,
+                nwords;
+   uint64_t     start, readNs;
          
-   if(Initialise(infile,outfile))
+   if(Initialise(infile,outfile,&options))
    {
-      if(ReadCmdLine(argc, argv, infile, outfile))
+      if(ReadCmdLine(argc, argv, infile, outfile, &options))
       {
-         if(BuildArrays())
+         if(options.server != NULL)
          {
-            if(OpenFiles(infile,outfile))
-            {
-               if((NWords=ReadInputData()) != 0)
-               {
-                  if(FitWords(NWords))
-                  {
-                     InitOutput(gOutput);
-                     if(gSolution) PrintSolution();
-                     FillSpaces();
-                     PrintPuzzle(NWords);
-                     EndOutput(gOutput);
-                  }
-                  else
-                  {
-                     fprintf(stderr,"Unable to build puzzle.\n");
-                     return(1);
-                  }
-               }
-            }
+            retval = RunServer(&options) ? 0 : 1;
          }
-         else
+         else if(OpenFiles(infile,outfile,&in,&out))
          {
-            fprintf(stderr,"Unable to allocate memory.\n");
-            return(1);
+            if((words=wsCreateWordList(&options))==NULL)
+            {
+               fprintf(stderr,"Unable to allocate memory.\n");
+               return(1);
+            }
+            
+            memset(&stats, 0, sizeof(WSSTATS));
+            start  = NowNs();
+            /* With an index, words are only read from a file given and
+               in render mode the input is a puzzle file
+            */
+            nwords = 0;
+            if(!options.render && (options.index == NULL || infile[0]))
+               nwords = wsReadWordList(words, in);
+            if(options.index != NULL && nwords >= 0 &&
+               (index = OpenIndex(options.index)) != NULL)
+               wsSetIndex(words, index);
+            readNs = NowNs() - start;
+            if(wsSkippedWords(words))
+            {
+               if(options.minWordLen > 1)
+                  fprintf(stderr,"Warning: %d words shorter than %d or \
+longer than %d letters were skipped.\n", wsSkippedWords(words), 
+                          options.minWordLen, options.maxWordLen);
+               else
+                  fprintf(stderr,"Warning: %d words longer than %d \
+letters were skipped.\n", wsSkippedWords(words), options.maxWordLen);
+            }
+
+            if(nwords < 0)
+            {
+               fprintf(stderr,"Unable to allocate memory.\n");
+               retval = 1;
+            }
+            else if(options.index != NULL && index == NULL)
+            {
+               retval = 1;
+            }
+            else if(options.render)
+            {
+               if(!RenderPuzzles(&options, in, out))
+                  retval = 1;
+            }
+            else if(options.makeIndex != NULL)
+            {
+               if(!WriteIndex(&options, words))
+                  retval = 1;
+            }
+            else if(options.solve != NULL)
+            {
+               if(!SolveGrid(&options, words, out))
+                  retval = 1;
+            }
+            else if(nwords != 0 || index != NULL)
+            {
+               if(!RunBatch(&options, words, options.seed, out, &stats))
+                  retval = 1;
+               if(options.statsFile != NULL &&
+                  !WriteStats(&options, &stats, readNs, NowNs() - start))
+                  retval = 1;
+            }
+            
+            wsDestroyWordList(words);
+            wsCloseIndex(index);
          }
       }
       else
@@ -185,92 +366,90 @@ int main(int argc, char **argv)
       }
    }
 
-   return(0);
+   return(retval);
 }
 
 /************************************************************************/
-/*>BOOL Initialise(char *infile, char *outfile)
-   --------------------------------------------
-   Initialise variables and seed the random number generator
+/*>BOOL Initialise(char *infile, char *outfile, WSOPTIONS *options)
+   ----------------------------------------------------------------
+   Initialise variables and seed the random number generator. The seed
+   may be overridden with -seed.
    
    13.01.94 Original    By: ACRM
+   18.10.26 Modified    By: agent
+            Sets the base seed from which each puzzle's seed is derived
+            Sets up a WSOPTIONS
+            The seed is kept in the options
 */
-BOOL Initialise(char *infile, char *outfile)
+BOOL Initialise(char *infile, char *outfile, WSOPTIONS *options)
 {
-   time_t seed;
+   time_t now;
    
    infile[0]   = '\0';
    outfile[0]  = '\0';
    
-   gMaxWords   = MAXWORDS;
-   gMaxWordLen = MAXWORDLEN;
-   gGridSize   = GRIDSIZE;
+   wsDefaultOptions(options);
 
    /* Seed random number generator                                      */
-   time(&seed);
-   srand((unsigned int)seed);
+   time(&now);
+   options->seed = (uint64_t)now;
    
    return(TRUE);
 }
 
 /************************************************************************/
-/*>BOOL ReadCmdLine(int argc, char **argv, char *infile, char *outfile)
+/*>BOOL ReadCmdLine(int argc, char **argv, char *infile, char *outfile,
+                    WSOPTIONS *options)
    --------------------------------------------------------------------
    Read the command line. Get flags from switches and record filenames
-   if specified. Returns FALSE if there is an error.
+   if specified. A first argument of render is taken as -render, so
+   that it reads as a subcommand. Returns FALSE if there is an error or
+   help was requested.
    
    13.01.94 Original    By: ACRM
    14.01.94 Added p,l,a,f and n switches
             Added return after reading filenames
+   18.10.26 Modified    By: agent
+            Added b and j switches
+            Switches are handled by wsSetOption()
+            Reports invalid values
+            Added the render subcommand
 */
-BOOL ReadCmdLine(int argc, char **argv, char *infile, char *outfile)
+BOOL ReadCmdLine(int argc, char **argv, char *infile, char *outfile,
+                 WSOPTIONS *options)
 {
+   BOOL usedValue;
+   
    argc--; argv++;
+
+   if(argc && !strcmp(argv[0], "render"))
+   {
+      options->render = TRUE;
+      argc--; argv++;
+   }
    
    while(argc)
    {
       if(argv[0][0] == '-')   /* Handle switches                        */
       {
-         switch(argv[0][1])
+         switch(wsSetOption(options, argv[0], (argc > 1) ? argv[1] : NULL,
+                            &usedValue))
          {
-         case 'w': case 'W':
-            argc--; argv++;
-            sscanf(argv[0],"%d",&gMaxWords);
-            break;
-         case 'm': case 'M':
-            argc--; argv++;
-            sscanf(argv[0],"%d",&gMaxWordLen);
-            break;
-         case 'g': case 'G':
-            argc--; argv++;
-            sscanf(argv[0],"%d",&gGridSize);
-            break;
-         case 's': case 'S':
-            gSolution = TRUE;
-            break;
-         case '?': case 'h': case 'H':
-            Usage();
-            exit(0);
-         case 'n': case 'N':
-            gWordList = FALSE;
-            break;
-         case 'p': case 'P':
-            gOutput = STYLE_PS;
-            break;
-         case 'l': case 'L':
-            gOutput = STYLE_LATEX;
-            break;
-         case 'a': case 'A':
-            gOutput = STYLE_ASCII;
-            break;
-         case 'f': case 'F':
-            argc--; argv++;
-            sscanf(argv[0],"%d",&gFontSize);
-            if(gFontSize < 1 || gFontSize > 48) gFontSize = 18;
+         case WS_OK:
             break;
-         default:
+         case WS_BADOPTION:
             fprintf(stderr,"Unknown switch: %s (ignored)\n",argv[0]);
             break;
+         case WS_BADVALUE:
+            fprintf(stderr,"Invalid value for %s: %s\n",argv[0],argv[1]);
+            return(FALSE);
+         default:
+            return(FALSE);
+         }
+         
+         if(usedValue)
+         {
+            argc--; argv++;
          }
       }
       else                    /* Handle file specifications             */
@@ -278,10 +457,12 @@ BOOL ReadCmdLine(int argc, char **argv, char *infile, char *outfile)
          switch(argc)
          {
          case 2:
-            strcpy(outfile,argv[1]);
+            strncpy(outfile,argv[1],MAXBUFF-1);
+            outfile[MAXBUFF-1] = '\0';
             /* Fall through                                             */
          case 1:
-            strcpy(infile,argv[0]);
+            strncpy(infile,argv[0],MAXBUFF-1);
+            infile[MAXBUFF-1] = '\0';
             break;
          default:
             return(FALSE);
@@ -295,63 +476,23 @@ BOOL ReadCmdLine(int argc, char **argv, char *infile, char *outfile)
 }
 
 /************************************************************************/
-/*>BOOL BuildArrays(void)
-   ----------------------
-   Assign memory for grid and words array. Returns FALSE if memory
-   allocation failed.
-   
-   13.01.94 Original    By: ACRM
-*/
-BOOL BuildArrays(void)
-{
-   int i,
-       j;
-   
-   /* Build the grid and fill with spaces                               */
-   if((gGrid = (char **)malloc(gGridSize * sizeof(char *)))==NULL)
-      return(FALSE);
-
-   for(i=0; i<gGridSize; i++)
-   {
-      gGrid[i] = (char *)malloc((gGridSize+1) * sizeof(char));
-      if(gGrid[i] == NULL) return(FALSE);
-      
-      for(j=0; j<gGridSize; j++)
-         gGrid[i][j] = ' ';
-      gGrid[i][gGridSize] = '\0';
-   }
-   
-   /* Build the words array                                             */
-   if((gWords = (char **)malloc(gMaxWords * sizeof(char *)))==NULL)
-      return(FALSE);
-
-   for(i=0; i<gMaxWords; i++)
-   {
-      gWords[i] = (char *)malloc((gMaxWordLen+1) * sizeof(char));
-      if(gWords[i] == NULL) return(FALSE);
-      
-      gWords[i][0] = '\0';
-   }
-   
-   return(TRUE);
-}
-
-/************************************************************************/
-/*>BOOL OpenFiles(char *infile, char *outfile)
-   -------------------------------------------
+/*>BOOL OpenFiles(char *infile, char *outfile, FILE **in, FILE **out)
+   ------------------------------------------------------------------
    Open the files of specified. Otherwise assume stdin/stdout.
    Returns FALSE if unable to open a file.
    
    13.01.94 Original    By: ACRM
+   18.10.26 Modified    By: agent
+            Returns the files rather than setting globals
 */
-BOOL OpenFiles(char *infile, char *outfile)
+BOOL OpenFiles(char *infile, char *outfile, FILE **in, FILE **out)
 {
-   gIn   = stdin;
-   gOut  = stdout;
+   *in   = stdin;
+   *out  = stdout;
    
    if(infile[0])
    {
-      if((gIn = fopen(infile,"r"))==NULL)
+      if((*in = fopen(infile,"r"))==NULL)
       {
          fprintf(stderr,"Unable to open input file: %s\n",infile);
          return(FALSE);
@@ -360,7 +501,7 @@ BOOL OpenFiles(char *infile, char *outfile)
    
    if(outfile[0])
    {
-      if((gOut = fopen(outfile,"w+"))==NULL)
+      if((*out = fopen(outfile,"w+"))==NULL)
       {
          fprintf(stderr,"Unable to open output file: %s\n",outfile);
          return(FALSE);
@@ -371,549 +512,1548 @@ BOOL OpenFiles(char *infile, char *outfile)
 }
 
 /************************************************************************/
-/*>int ReadInputData(void)
-   -----------------------
-   Read words from the input file. Returns the number of words given.
-   
-   13.01.94 Original    By: ACRM
-   14.01.94 Terminates word in word list
+/*>BOOL RunBatch(WSOPTIONS *options, WSWORDLIST *words, uint64_t seed,
+                 FILE *out, WSSTATS *stats)
+   --------------------------------------------------------------------
+   Build options->nPuzzles puzzles from the word list, writing them to 
+   out in order. With more than one thread, each worker fills its own
+   queue with the next few puzzles and, once that is empty, steals half
+   of the remaining puzzles from another worker (see NextPuzzle()). 
+   Rendered puzzles are buffered in memory and this thread writes them
+   out in order as they complete, so only the puzzles not yet written
+   are held in memory. The work done for every puzzle is added to
+   stats. Returns FALSE if any puzzle could not be built.
+
+   With options->book the puzzles are pages of one book. Each page is
+   written as soon as it is ready and the solutions go to the answer key
+   at the end.
+
+   With options->save each puzzle is also added, in order, to the end
+   of that puzzle file.
+
+   18.10.26 Original    By: agent
+            Added stats
+            Added books
+            Added the puzzle file
+            Queues start empty and are filled by NextPuzzle()
 */
-int ReadInputData(void)
+BOOL RunBatch(WSOPTIONS *options, WSWORDLIST *words, uint64_t seed,
+              FILE *out, WSSTATS *stats)
 {
-   char  buffer[MAXBUFF],
-         *ptr;
-   int   NWords = 0;
-   
-   while(fgets(buffer,MAXBUFF-1,gIn))
+   BATCH     batch;
+   WORKER    *workers;
+   WSCONTEXT *ctx;
+   WSBOOK    *book = NULL;
+   WSSINK    sink;
+   RESULT    result;
+   FILE      *save = NULL;
+   BOOL      ok = TRUE;
+   int       i,
+             status,
+             nthreads = options->nThreads,
+             npuzzles = options->nPuzzles;
+
+   if(nthreads < 1) 
+      nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+   if(nthreads > npuzzles) nthreads = npuzzles;
+
+   if(options->save != NULL && (save = fopen(options->save, "ab"))==NULL)
    {
-      TERMINATE(buffer);
-      UPPER(buffer);
-      
-      /* Remove any leading spaces                                      */
-      for(ptr=buffer; (*ptr==' ' || *ptr=='\t'); ptr++);
-      
-      /* Return if it was a blank line                                  */
-      if(!strlen(ptr)) return(NWords);
-      
-      /* Copy the string into the words array                           */
-      strncpy(gWords[NWords], ptr, gMaxWordLen);
-      gWords[NWords][gMaxWordLen] = '\0';
-            
-      if(++NWords >= gMaxWords) return(NWords);
+      fprintf(stderr,"Unable to open puzzle file: %s\n", options->save);
+      return(FALSE);
    }
-   
-   return(NWords);
-}
 
-/************************************************************************/
-/*>void FillSpaces(void)
-   ---------------------
-   Fill in spaces in the grid with random letters
-   
-   13.01.94 Original    By: ACRM
-*/
-void FillSpaces(void)
-{
-   int i, j;
+   if(options->book &&
+      (book = wsCreateBook(options, wsFileSink(&sink, out)))==NULL)
+   {
+      fprintf(stderr,"Unable to allocate memory.\n");
+      return(FALSE);
+   }
    
-   for(i=0; i<gGridSize; i++)
+   if(nthreads <= 1)          /* Build them one at a time               */
    {
-      for(j=0; j<gGridSize; j++)
+      if((ctx = wsCreateContext(options))==NULL)
+      {
+         fprintf(stderr,"Unable to allocate memory.\n");
+         return(FALSE);
+      }
+      
+      for(i=0; i<npuzzles; i++)
       {
-         if(gGrid[i][j] == ' ')
+         if(book != NULL)
+         {
+            BuildResult(ctx, words, seed, i, TRUE, (save != NULL),
+                        &result, stats);
+            status = WriteResult(&result, book, out, save);
+         }
+         else
          {
-            /* If it's a space, put in a random letter                  */
-            gGrid[i][j] = (char)(65 + RandomNum(26));
+            status = MakePuzzle(ctx, words, seed, i, out, NULL, save,
+                                stats);
          }
+         if(status != WS_OK)
+         {
+            if(npuzzles > 1) fprintf(stderr,"Puzzle %d: ", i+1);
+            fprintf(stderr,"%s.\n", wsErrorString(status));
+            ok = FALSE;
+         }
+      }
+      wsDestroyContext(ctx);
+      if(book != NULL && wsFinishBook(book) != WS_OK)
+      {
+         fprintf(stderr,"%s.\n", wsErrorString(WS_WRITEERROR));
+         ok = FALSE;
+      }
+      if(save != NULL && fclose(save))
+      {
+         fprintf(stderr,"%s: %s.\n", options->save,
+                 wsErrorString(WS_WRITEERROR));
+         ok = FALSE;
       }
+      return(ok);
    }
-}
 
-/************************************************************************/
-/*>int RandomNum(int maxran)
-   -------------------------
-   Return a random integer between 0 and maxran-1
-   
-   13.01.94 Original    By: ACRM
-*/
-int RandomNum(int maxran)
-{
-   float frac;
-   int   rnum;
-   
-   frac = (float)rand() / RAND_MAX;
-   rnum = (int)(maxran * frac);
-   
-   return(rnum);
+   batch.options  = options;
+   batch.book     = (book != NULL);
+   batch.words    = words;
+   batch.seed     = seed;
+   batch.save     = save;
+   batch.nthreads = nthreads;
+   batch.npuzzles = npuzzles;
+   batch.next     = 0;
+   batch.written  = 0;
+   batch.queues   = (WORKQUEUE *)malloc(nthreads * sizeof(WORKQUEUE));
+   batch.results  = (RESULT *)calloc(npuzzles, sizeof(RESULT));
+   workers        = (WORKER *)malloc(nthreads * sizeof(WORKER));
+   if(batch.queues == NULL || batch.results == NULL || workers == NULL)
+   {
+      fprintf(stderr,"Unable to allocate memory.\n");
+      return(FALSE);
+   }
+   pthread_mutex_init(&(batch.lock), NULL);
+   pthread_cond_init(&(batch.finished), NULL);
+   pthread_cond_init(&(batch.space), NULL);
+
+   for(i=0; i<nthreads; i++)
+   {
+      pthread_mutex_init(&(batch.queues[i].lock), NULL);
+      batch.queues[i].lo = 0;
+      batch.queues[i].hi = 0;
+   }
+
+   for(i=0; i<nthreads; i++)
+   {
+      workers[i].batch = &batch;
+      workers[i].id    = i;
+      memset(&(workers[i].stats), 0, sizeof(WSSTATS));
+      pthread_create(&(workers[i].thread), NULL, BatchWorker, 
+                     &(workers[i]));
+   }
+
+   /* Write the puzzles out in order as they become available           */
+   for(i=0; i<npuzzles; i++)
+   {
+      pthread_mutex_lock(&(batch.lock));
+      while(!batch.results[i].done)
+         pthread_cond_wait(&(batch.finished), &(batch.lock));
+      pthread_mutex_unlock(&(batch.lock));
+
+      if((status = WriteResult(&(batch.results[i]), book, out, save)) 
+         != WS_OK)
+      {
+         fprintf(stderr,"Puzzle %d: %s.\n", i+1, wsErrorString(status));
+         ok = FALSE;
+      }
+
+      pthread_mutex_lock(&(batch.lock));
+      batch.written = i+1;
+      pthread_cond_broadcast(&(batch.space));
+      pthread_mutex_unlock(&(batch.lock));
+   }
+
+   for(i=0; i<nthreads; i++)
+   {
+      pthread_join(workers[i].thread, NULL);
+      wsAddStats(stats, &(workers[i].stats));
+   }
+   for(i=0; i<nthreads; i++)
+      pthread_mutex_destroy(&(batch.queues[i].lock));
+   pthread_cond_destroy(&(batch.finished));
+   pthread_cond_destroy(&(batch.space));
+   pthread_mutex_destroy(&(batch.lock));
+   free(workers);
+   free(batch.queues);
+   free(batch.results);
+   if(book != NULL && wsFinishBook(book) != WS_OK)
+   {
+      fprintf(stderr,"%s.\n", wsErrorString(WS_WRITEERROR));
+      ok = FALSE;
+   }
+   if(save != NULL && fclose(save))
+   {
+      fprintf(stderr,"%s: %s.\n", options->save,
+              wsErrorString(WS_WRITEERROR));
+      ok = FALSE;
+   }
+      
+   return(ok);
 }
 
 /************************************************************************/
-/*>BOOL FitWords(int NWords)
-   -------------------------
-   Place words in the grid
-   
-   13.01.94 Original    By: ACRM
+/*>void *BatchWorker(void *arg)
+   ----------------------------
+   Thread function for one batch worker. Builds puzzles into a memory
+   buffer until there are none left to take or steal. The work done is
+   added to the worker's stats.
+
+   18.10.26 Original    By: agent
+            Buffering split out into BuildResult()
 */
-BOOL FitWords(int NWords)
+void *BatchWorker(void *arg)
 {
-   int i;
+   WORKER    *worker = (WORKER *)arg;
+   BATCH     *batch  = worker->batch;
+   WSCONTEXT *ctx    = wsCreateContext(batch->options);
+   RESULT    result;
+   int       index;
    
-   SortByLength(gWords, NWords);
-   
-   for(i=0; i<NWords; i++)
-      if(!PlaceWord(gWords[i])) return(FALSE);
-   
-   return(TRUE);
+   while(NextPuzzle(batch, worker->id, &index))
+   {
+      BuildResult(ctx, batch->words, batch->seed, index, batch->book,
+                  (batch->save != NULL), &result, &(worker->stats));
+      
+      pthread_mutex_lock(&(batch->lock));
+      batch->results[index] = result;
+      pthread_cond_signal(&(batch->finished));
+      pthread_mutex_unlock(&(batch->lock));
+   }
+
+   wsDestroyContext(ctx);
+   return(NULL);
 }
 
 /************************************************************************/
-/*>void Usage(void)
-   ----------------
-   Print a usage message.
-   
-   13.01.94 Original    By: ACRM
-   14.01.94 Added n,p,l,a and f switches
-*/
-void Usage(void)
-{
-   fprintf(stderr,"WordSearch V1.2 (c) 1994-2001, Dr. Andrew C. R. \
-Martin, SciTech Software\n");
-   fprintf(stderr,"Usage: wordsearch [-w maxwords] [-m maxwordlen] \
-[-g gridsize]\n");
-   fprintf(stderr,"                  [-s] [-h] [-n] [-p] [-l] [-a] \
-[infile] [outfile]\n\n");
-   fprintf(stderr,"       -w      Max words (Default: %d)\n",MAXWORDS);
-   fprintf(stderr,"       -m      Max word length (Default: %d)\n",
-           MAXWORDLEN);
-   fprintf(stderr,"       -g      Grid size (Default: %d)\n",GRIDSIZE);
-   fprintf(stderr,"       -s      Output solution\n");
-   fprintf(stderr,"       -n      Do not output word list\n");
-   fprintf(stderr,"       -p      Postscript output (default)\n");
-   fprintf(stderr,"       -l      LaTeX output\n");
-   fprintf(stderr,"       -a      ASCII output\n");
-   fprintf(stderr,"       -f      PostScript font size (Default: 18)\n");
+/*>BOOL NextPuzzle(BATCH *batch, int id, int *index)
+   -------------------------------------------------
+   Input:   BATCH  *batch     The batch
+            int    id         Worker number
+   Output:  int    *index     The next puzzle for this worker to build
+   Returns: BOOL              FALSE if there are no puzzles left
 
-   fprintf(stderr,"       -h      This help message\n");
-   fprintf(stderr,"       infile  Optional input file\n");
-   fprintf(stderr,"       outfile Optional output file\n\n");
-   
-   fprintf(stderr,"WordSearch takes a list of words from standard \
-input or\n");
-   fprintf(stderr,"infile if specified and creates a word search \
-grid.\n");
-   fprintf(stderr,"Output which is in PostScript format by default, \
-goes\n");
-   fprintf(stderr,"to standard output or to outfile if specified.\n");
-}
+   Take the next puzzle from the front of the worker's own queue. If it
+   is empty, fill it with up to RUNAHEAD puzzles that no worker has been
+   given yet, or else steal the back half of the first non-empty queue
+   found. 
 
-/************************************************************************/
-/*>BOOL PlaceWord(char *word)
-   --------------------------
-   Place a word in the grid. Returns FALSE if unable to do so.
+   No puzzle is given out while RUNAHEAD puzzles per worker are built or
+   being built but not yet written. If there is nothing to steal either,
+   the worker waits for puzzles to be written, so memory does not grow 
+   with the length of the batch.
 
-   13.01.94 Original    By: ACRM
-   12.07.01 Fixed bug in selecting random numbers on diagonals.
+   18.10.26 Original    By: agent
+            Added book pages
+            Puzzles are queued a few at a time and no more than 
+            RUNAHEAD per worker are held unwritten
 */
-BOOL PlaceWord(char *word)
+BOOL NextPuzzle(BATCH *batch, int id, int *index)
 {
-   int   try, 
-         i, 
-         x, y, 
-         direction, 
-         len, 
-         xstep, ystep;
-   BOOL  ok;
-   
-   len = strlen(word);
-   
-   
-   for(try=0; try<MAXTRY; try++)
+   WORKQUEUE *own = &(batch->queues[id]),
+             *victim;
+   int       i, 
+             lo, hi;
+
+   pthread_mutex_lock(&(own->lock));
+   if(own->lo < own->hi)
    {
-      /* Select the direction (0: horiz, 1: vert, 2: diagonal)          */
-      direction = RandomNum(3);
-      
-      /* Select the start point                                         */
-      switch(direction)
-      {
-      case 0:
-         x = RandomNum(gGridSize-len);
-         y = RandomNum(gGridSize);
-         xstep = 1; ystep = 0;
-         break;
-      case 1:
-         x = RandomNum(gGridSize);
-         y = RandomNum(gGridSize-len);
-         xstep = 0; ystep = 1;
-         break;
-      case 2:
-         x = RandomNum(gGridSize-len);
-         y = RandomNum(gGridSize-len);
-         xstep = 1; ystep = 1;
+      *index = own->lo++;
+      pthread_mutex_unlock(&(own->lock));
+      return(TRUE);
+   }
+   pthread_mutex_unlock(&(own->lock));
+
+   for(;;)
+   {
+      /* Queue the next few puzzles if that keeps within the limit      */
+      pthread_mutex_lock(&(batch->lock));
+      lo = batch->next;
+      hi = batch->written + RUNAHEAD * batch->nthreads;
+      if(hi > lo + RUNAHEAD)   hi = lo + RUNAHEAD;
+      if(hi > batch->npuzzles) hi = batch->npuzzles;
+      if(lo < hi)
+         batch->next = hi;
+      pthread_mutex_unlock(&(batch->lock));
+
+      if(lo < hi)
          break;
-      }
       
-      /* See if the word fits                                           */
-      ok = TRUE;
-      for(i=0; i<strlen(word); i++)
+      /* Otherwise steal from another worker                            */
+      for(i=1; i<batch->nthreads; i++)
       {
-         char ch;
-         
-         ch = gGrid[y + i*ystep][x + i*xstep];
-         
-         if(ch != ' ' && ch != word[i])
-         {
-            ok = FALSE;
+         victim = &(batch->queues[(id + i) % batch->nthreads]);
+
+         pthread_mutex_lock(&(victim->lock));
+         hi = victim->hi;
+         lo = hi - (victim->hi - victim->lo + 1) / 2;
+         victim->hi = lo;
+         pthread_mutex_unlock(&(victim->lock));
+
+         if(lo < hi)
             break;
-         }
       }
-      
-      if(ok)
+      if(lo < hi)
+         break;
+
+      /* Or wait for puzzles to be written if some are still to come    */
+      pthread_mutex_lock(&(batch->lock));
+      if(batch->next >= batch->npuzzles)
       {
-         /* Put in the word                                             */
-         for(i=0; i<strlen(word); i++)
-            gGrid[y + i*ystep][x + i*xstep] = word[i];
-         
-         return(TRUE);
+         pthread_mutex_unlock(&(batch->lock));
+         return(FALSE);
       }
+      if(batch->next >= batch->written + RUNAHEAD * batch->nthreads)
+         pthread_cond_wait(&(batch->space), &(batch->lock));
+      pthread_mutex_unlock(&(batch->lock));
    }
-   
-   return(FALSE);
+
+   /* Keep the first puzzle and queue the rest                          */
+   pthread_mutex_lock(&(own->lock));
+   own->lo = lo + 1;
+   own->hi = hi;
+   pthread_mutex_unlock(&(own->lock));
+   *index = lo;
+   return(TRUE);
 }
 
 /************************************************************************/
-/*>void PrintSolution(void)
-   ------------------------
-   Print the grid with only the specified words (no random letters)
-   
-   13.01.94 Original    By: ACRM
-   14.01.94 Changed to call DoASCIIOutput()
+/*>void BuildResult(WSCONTEXT *ctx, WSWORDLIST *words, uint64_t seed,
+                    int index, BOOL book, BOOL save, RESULT *result, 
+                    WSSTATS *stats)
+   ------------------------------------------------------------------
+   Build one puzzle into memory buffers in result, as the puzzle page
+   and solution page of a book if book is set, and as it is kept in a
+   puzzle file if save is set. The work done is added to stats.
+
+   18.10.26 Original    By: agent (split out of BatchWorker())
+            Added book
+            Added save
 */
-void PrintSolution(void)
+void BuildResult(WSCONTEXT *ctx, WSWORDLIST *words, uint64_t seed,
+                 int index, BOOL book, BOOL save, RESULT *result, 
+                 WSSTATS *stats)
 {
-   switch(gOutput)
+   FILE *out,
+        *answer = NULL,
+        *saved  = NULL;
+
+   result->text         = NULL;
+   result->answer       = NULL;
+   result->saved        = NULL;
+   result->length       = 0;
+   result->answerLength = 0;
+   result->savedLength  = 0;
+   result->status       = WS_NOMEMORY;
+
+   if(ctx != NULL && 
+      (out = open_memstream(&(result->text), &(result->length))) != NULL)
    {
-   case STYLE_ASCII:
-      DoASCIIOutput(gGrid, gGridSize, gWordList, 0, TRUE);
-      break;
-   case STYLE_PS:
-      DoPSOutput(gGrid, gGridSize, gWordList, 0, TRUE);
-      break;
-   case STYLE_LATEX:
-      DoLaTeXOutput(gGrid, gGridSize, gWordList, 0, TRUE);
-      break;
+      if((!book || 
+          (answer = open_memstream(&(result->answer), 
+                                   &(result->answerLength))) != NULL) &&
+         (!save ||
+          (saved = open_memstream(&(result->saved),
+                                  &(result->savedLength))) != NULL))
+         result->status = MakePuzzle(ctx, words, seed, index, out, 
+                                     answer, saved, stats);
+      fclose(out);
+      if(answer != NULL)
+         fclose(answer);
+      if(saved != NULL)
+         fclose(saved);
    }
+   result->done = TRUE;
 }
 
 /************************************************************************/
-/*>void PrintPuzzle(int NWords)
-   ----------------------------
-   Print the complete grid with the words for which to search.
-   
-   13.01.94 Original    By: ACRM
-   14.01.94 Changed to call DoASCIIOutput()
+/*>int WriteResult(RESULT *result, WSBOOK *book, FILE *out, 
+                    FILE *save)
+   -------------------------------------------------------
+   Write a puzzle built by BuildResult() to out, or add its pages to
+   book if that is not NULL, and free its buffers. Book pages are
+   flushed straight away. If save is not NULL the puzzle is added to
+   that puzzle file as well. Returns the puzzle's status or 
+   WS_WRITEERROR.
+
+   18.10.26 Original    By: agent
+            Added save
 */
-void PrintPuzzle(int NWords)
+int WriteResult(RESULT *result, WSBOOK *book, FILE *out, FILE *save)
 {
-   switch(gOutput)
+   int status = result->status;
+
+   if(status == WS_OK)
    {
-   case STYLE_ASCII:
-      DoASCIIOutput(gGrid, gGridSize, gWordList, NWords, FALSE);
-      break;
-   case STYLE_PS:
-      DoPSOutput(gGrid, gGridSize, gWordList, NWords, FALSE);
-      break;
-   case STYLE_LATEX:
-      DoLaTeXOutput(gGrid, gGridSize, gWordList, NWords, FALSE);
-      break;
+      if(book == NULL)
+      {
+         fwrite(result->text, 1, result->length, out);
+      }
+      else
+      {
+         if((status = wsBookPage(book, result->text, result->length,
+                                 FALSE)) == WS_OK)
+            status = wsBookPage(book, result->answer, 
+                                result->answerLength, TRUE);
+         fflush(out);
+      }
+      if(status == WS_OK && save != NULL &&
+         fwrite(result->saved, 1, result->savedLength, save) != 
+         result->savedLength)
+         status = WS_WRITEERROR;
    }
+
+   free(result->text);
+   free(result->answer);
+   free(result->saved);
+   return(status);
 }
 
 /************************************************************************/
-/*>void InitOutput(int style)
-   --------------------------
-   Initialise an output file (ASCII, PostScript or LaTeX)
+/*>int MakePuzzle(WSCONTEXT *ctx, WSWORDLIST *words, uint64_t seed,
+                  int index, FILE *out, FILE *answer, FILE *save,
+                  WSSTATS *stats)
+   ------------------------------------------------------------------
+   Build and output one puzzle using a worker's context. The puzzle's
+   random number seed depends only on the base seed and the puzzle 
+   number so a batch gives the same puzzles however many threads are
+   used. The work done is added to stats. Returns a WS_ status code.
+
+   The puzzle is rendered by RenderPuzzle(), which also adds it to save
+   if that is not NULL.
 
-   14.01.94 Original    By: ACRM
-   11.07.01 Outputs PostScript header
+   Words dropped because the deadline passed are reported on stderr.
+
+   18.10.26 Original    By: agent
+            Seed comes from wsPuzzleSeed()
+            Added stats
+            Added answer
+            Reports dropped words
+            Rendering split out into RenderPuzzle()
 */
-void InitOutput(int style)
+int MakePuzzle(WSCONTEXT *ctx, WSWORDLIST *words, uint64_t seed,
+               int index, FILE *out, FILE *answer, FILE *save,
+               WSSTATS *stats)
 {
-   switch(style)
-   {
-   case STYLE_ASCII:
-      break;
-   case STYLE_PS:
-      /* Print the PostScript header                                    */
-      fprintf(gOut,"%%!PS_Adobe-2.0\n");
-      fprintf(gOut,"%%%%Creator: WordSearch 1.2 (c) 1994-2001 \
-Andrew C.R. Martin\n");
-      fprintf(gOut,"%%%%EndComments\n");
+   WSSTATS puzzle;
+   int     status;
    
+   if((status = wsGenerate(ctx, words, wsPuzzleSeed(seed, index)))
+      == WS_OK)
+   {
+      if(wsDroppedWords(ctx))
+         ReportDropped(ctx, index);
+      status = RenderPuzzle(ctx, out, answer, save);
+   }
 
-      fprintf(gOut,"/max\n");
-      fprintf(gOut,"%% n1 n2...max...n\n");
-      fprintf(gOut,"{  2 copy\n");
-      fprintf(gOut,"   lt { exch } if\n");
-      fprintf(gOut,"   pop\n");
-      fprintf(gOut,"}  def\n\n");
-
-      fprintf(gOut,"/Helvetica-Bold findfont %d scalefont setfont\n\n",
-              gFontSize);
+   wsGetStats(ctx, &puzzle);
+   wsAddStats(stats, &puzzle);
 
-      fprintf(gOut,"/size (W)  stringwidth pop\n");
-      fprintf(gOut,"      (\\() stringwidth exch pop\n");
-      fprintf(gOut,"      max 4 add def\n\n");
-      
-      fprintf(gOut,"/xstart  72 def\n");
-      fprintf(gOut,"/ystart 720 def\n");
-      
-      fprintf(gOut,"/xpos xstart def\n");
-      fprintf(gOut,"/ypos ystart def\n");
-
-      fprintf(gOut,"%%%%EndProlog\n\n");
-      fprintf(gOut,"%%%%Page: 1 1\n");
-      break;
-   case STYLE_LATEX:
-      fprintf(gOut,"\\documentstyle[12pt,a4]{article}\n");
-         
-      fprintf(gOut,"\\oddsidemargin -0.3 in\n");
-      fprintf(gOut,"\\evensidemargin -0.3 in\n");
-      fprintf(gOut,"\\marginparwidth 0.75 in\n");
-      fprintf(gOut,"\\textwidth 7.0 true in\n");
-      
-      fprintf(gOut,"\\pagestyle{empty}\n");
-      fprintf(gOut,"\\newcommand{\\s}[1]{\\makebox[1.5em]{#1}}\n");
-      fprintf(gOut,"\\begin{document}\n");
-      fprintf(gOut,"\\Large\n");
-      break;
-   }
+   return(status);
 }
 
 /************************************************************************/
-/*>void EndOutput(int style)
-   -------------------------
-   Do any tidying up to end a file
+/*>int RenderPuzzle(WSCONTEXT *ctx, FILE *out, FILE *answer, FILE *save)
+   ---------------------------------------------------------------------
+   Output the puzzle in a context. If answer is not NULL, the puzzle is
+   rendered as pages of a book: the puzzle page to out and the solution
+   page to answer. If save is not NULL the puzzle is added to that
+   puzzle file. Returns a WS_ status code.
 
-   14.01.94 Original    By: ACRM
+   18.10.26 Original    By: agent (split out of MakePuzzle())
 */
-void EndOutput(int style)
+int RenderPuzzle(WSCONTEXT *ctx, FILE *out, FILE *answer, FILE *save)
 {
-   switch(style)
+   WSSINK sink;
+   int    status;
+
+   if(answer == NULL)
    {
-   case STYLE_ASCII:
-      break;
-   case STYLE_PS:
-      fprintf(gOut,"showpage\n");
-      break;
-   case STYLE_LATEX:
-      fprintf(gOut,"\\end{document}\n");
-      break;
+      status = wsRender(ctx, wsFileSink(&sink, out));
    }
-}
+   else if((status = wsRenderPage(ctx, wsFileSink(&sink, out), FALSE))
+           == WS_OK)
+   {
+      status = wsRenderPage(ctx, wsFileSink(&sink, answer), TRUE);
+   }
+   if(status == WS_OK && save != NULL)
+      status = wsWritePuzzle(ctx, save);
+
+   return(status);
+}
 
 /************************************************************************/
-/*>void DoPSOutput(char **grid, int gridsize, BOOL WordList, 
-                   int NWords, BOOL solution)
-   ---------------------------------------------------------
-   Create PostScript output.
-   Input:   char  **grid      The character grid
-            int   gridsize    The size of the grid
-            BOOL  WordList    Should be display the word list if this
-                              isn't the solution display
-            int   NWords      Number of words in the word list
-            BOOL  solution    Is this a solution display
-
-   14.01.94 Original    By: ACRM
-   11.07.01 Outputs PostScript page count
-*/
-void DoPSOutput(char **grid, int gridsize, BOOL WordList, 
-                int NWords, BOOL solution)
-{
-   int   i, j,
-         FontSize;
-   
+/*>void ReportDropped(WSCONTEXT *ctx, int index)
+   ---------------------------------------------
+   List the words left out of a puzzle because its deadline passed. The
+   line is written under the lock of stderr so that batch workers do
+   not mix their lines.
+
+   18.10.26 Original    By: agent
+*/
+void ReportDropped(WSCONTEXT *ctx, int index)
+{
+   int i;
 
-   if(solution)
+   flockfile(stderr);
+   fprintf(stderr,"Puzzle %d: out of time, dropped", index+1);
+   for(i=0; i<wsDroppedWords(ctx); i++)
+      fprintf(stderr," %s", wsGetDropped(ctx, i));
+   fprintf(stderr,"\n");
+   funlockfile(stderr);
+}
+
+/************************************************************************/
+/*>BOOL WriteStats(WSOPTIONS *options, WSSTATS *stats, uint64_t readNs,
+                   uint64_t totalNs)
+   ---------------------------------------------------------------------
+   Write a JSON summary of the work done to options->statsFile, or to
+   stderr if that is "-". The fit, fill and render times are summed over
+   all the threads; the read and total times are elapsed times. Returns
+   FALSE if the file could not be opened.
+
+   18.10.26 Original    By: agent
+            Added duplicates and the verify time
+            Added the fill counts
+            Lists rejected starts for the directions in use
+            Added the cache hits
+            Added the automatic grid sizes
+            Added the timeouts and dropped words
+            Added the puzzles given up on
+            Gives the grid sizes used with -g auto
+*/
+BOOL WriteStats(WSOPTIONS *options, WSSTATS *stats, uint64_t readNs,
+                uint64_t totalNs)
+{
+   static char *directions[] = {"across", "down", "diagonal",
+                                "backwards", "up", "up_left",
+                                "up_right", "down_left"},
+               *styles[]     = {"", "ps", "latex", "ascii", "pdf"};
+   FILE        *fp    = stderr;
+   BOOL        first  = TRUE;
+   int         i, n;
+   unsigned long built = stats->puzzles - stats->failures;
+
+   if(strcmp(options->statsFile, "-") &&
+      (fp = fopen(options->statsFile, "w"))==NULL)
    {
-      fprintf(gOut,"xpos ypos moveto (Solution:) show\n");
-      fprintf(gOut,"/ypos ypos size 2 mul sub def\n");
+      fprintf(stderr,"Unable to open stats file: %s\n",
+              options->statsFile);
+      return(FALSE);
    }
-   
-   for(i=0; i<gridsize; i++)
+
+   fprintf(fp,"{\n  \"puzzles\": %lu, \"failures\": %lu, \"gave_up\": %lu, \
+\"duplicates\": %lu,\n", stats->puzzles, stats->failures, stats->gaveUp,
+           stats->duplicates);
+   /* With -g auto, gridSize is only the limit                          */
+   if(options->autoGrid)
+      fprintf(fp,"  \"grid\": \"auto\", \"style\": \"%s\",\n",
+              styles[options->style]);
+   else
+      fprintf(fp,"  \"grid\": %d, \"style\": \"%s\",\n", options->gridSize,
+              styles[options->style]);
+
+   fprintf(fp,"  \"search\": {\"words\": %lu, \"placements\": %lu, \
+\"tries_per_word\": %.3f, \"backtracks\": %lu,\n", stats->words,
+           stats->placements,
+           (stats->words ? (double)stats->placements / stats->words : 0.0),
+           stats->backtracks);
+   fprintf(fp,"             \"lines\": %lu, \"conflicts\": %lu, \
+\"out_of_bounds\": %lu,\n", stats->lines, stats->conflicts,
+           stats->outOfBounds);
+   fprintf(fp,"             \"rejected\": {");
+   for(i=0, n=0; i<WS_NDIRECTIONS; i++)
+   {
+      if(options->directions & (1 << i))
+         fprintf(fp,"%s\"%s\": %lu", (n++?", ":""), directions[i],
+                 stats->rejected[i]);
+   }
+   fprintf(fp,"}},\n");
+
+   /* Words longer than WS_MAXSTATLEN are counted with that length      */
+   fprintf(fp,"  \"by_length\": [");
+   for(i=0; i<=WS_MAXSTATLEN; i++)
    {
-      for(j=0; j<gridsize; j++)
+      if(stats->lengthWords[i])
       {
-         fprintf(gOut,"xpos ypos moveto (%c) show \
-/xpos xpos size add def\n",grid[i][j]);
+         fprintf(fp,"%s\n    {\"length\": %d, \"words\": %lu, \
+\"tries_per_word\": %.3f}", (first?"":","), i, stats->lengthWords[i],
+                 (double)stats->lengthTries[i] / stats->lengthWords[i]);
+         first = FALSE;
       }
-      fprintf(gOut,"/ypos ypos size sub def\n");
-      fprintf(gOut,"/xpos xstart def\n");
    }
+   fprintf(fp,"\n  ],\n");
+
+   fprintf(fp,"  \"fill\": {\"rejected\": %lu, \"forced\": %lu},\n",
+           stats->fillRejects, stats->fillForced);
+   fprintf(fp,"  \"cache_hits\": %lu,\n", stats->cacheHits);
+   if(options->autoGrid)
+      fprintf(fp,"  \"auto_grid\": {\"probes\": %lu, \"min_size\": %lu, \
+\"max_size\": %lu,\n                \"mean_size\": %.2f, \"mean_cells\": \
+%.1f},\n", stats->gridProbes, stats->gridMin, stats->gridMax,
+              (built ? (double)stats->gridSizes / built : 0.0),
+              (built ? (double)stats->gridCells / built : 0.0));
+   if(options->deadlineMs > 0)
+      fprintf(fp,"  \"deadline\": {\"timeouts\": %lu, \"dropped\": %lu},\n",
+              stats->timeouts, stats->dropped);
+   fprintf(fp,"  \"time_ms\": {\"read\": %.3f, \"fit\": %.3f, \
+\"fill\": %.3f, \"verify\": %.3f, \"render\": %.3f, \"total\": %.3f},\n",
+           readNs * 1.0e-6, stats->fitNs * 1.0e-6, stats->fillNs * 1.0e-6,
+           stats->verifyNs * 1.0e-6, stats->renderNs * 1.0e-6,
+           totalNs * 1.0e-6);
+   fprintf(fp,"  \"bytes\": {\"%s\": %llu}\n}\n", styles[options->style],
+           (unsigned long long)stats->bytes);
+
+   if(fp != stderr)
+      fclose(fp);
+   return(TRUE);
+}
 
-   if(solution)            /* Finish this page and start another        */
+/************************************************************************/
+/*>BOOL SolveGrid(WSOPTIONS *options, WSWORDLIST *words, FILE *out)
+   ----------------------------------------------------------------
+   Find every word of the list in the grid named by options->solve. For
+   each word a line gives the word, the number of times it was found and
+   for each occurrence the column and row of its first letter, from 1,
+   and its compass direction. A summary goes to stderr. Returns FALSE if
+   the grid could not be read or a word was not found.
+
+   18.10.26 Original    By: agent
+*/
+BOOL SolveGrid(WSOPTIONS *options, WSWORDLIST *words, FILE *out)
+{
+   static char   *directions[] = {"NW", "N", "NE", "W", "", "E",
+                                  "SW", "S", "SE"};
+   const WSMATCH *matches;
+   WSSOLVER      *solver;
+   char          *grid;
+   unsigned long duplicates = 0;
+   int           i, m, count, gridsize, nmatches,
+                 nwords  = wsWordCount(words),
+                 missing = 0,
+                 status;
+
+   if((grid = ReadGrid(options->solve, &gridsize))==NULL)
+      return(FALSE);
+
+   if((solver = wsCreateSolver(words, 0))==NULL ||
+      (status = wsSolve(solver, grid, gridsize, gridsize+1)) != WS_OK)
    {
-      fprintf(gOut,"showpage\n\n");
-      fprintf(gOut,"%%%%Page: 2 2\n");
-      fprintf(gOut,"/xpos xstart def\n");
-      fprintf(gOut,"/ypos ystart def\n");
+      fprintf(stderr,"Unable to allocate memory.\n");
+      wsDestroySolver(solver);
+      free(grid);
+      return(FALSE);
    }
-   else                    /* Print the word list                       */
+
+   nmatches = wsGetMatches(solver, &matches);
+   for(i=0, m=0; i<nwords; i++)
    {
-      /* Leave a blank line                                             */
-      fprintf(gOut,"/ypos ypos size sub def\n");
+      count = wsWordMatches(solver, i);
+      fprintf(out, "%s %d", wsGetWord(words, i), count);
+      for(; m<nmatches && matches[m].word == i; m++)
+         fprintf(out, " %d,%d,%s", matches[m].x + 1, matches[m].y + 1,
+                 directions[(matches[m].dy + 1) * 3 + matches[m].dx + 1]);
+      fprintf(out, "\n");
 
-      /* Reset the font size                                            */
-      FontSize = (gFontSize >= 12) ? gFontSize - 2 : gFontSize;
-      fprintf(gOut,"/Helvetica-Bold findfont %d scalefont setfont\n\n",
-              FontSize);
-       
-      if(WordList)
-      {       
-         /* Display the word list, 3 to a line                          */
-         for(i=0; i<NWords; i+=3)
+      if(count == 0)
+         missing++;
+      else if(m && matches[m-1].word == i)
+         duplicates += count - 1;
+   }
+
+   fprintf(stderr,"Found %d of %d words in a %dx%d grid with %lu \
+duplicate occurrences.\n", nwords - missing, nwords, gridsize, gridsize,
+           duplicates);
+
+   wsDestroySolver(solver);
+   free(grid);
+   return(missing == 0);
+}
+
+/************************************************************************/
+/*>char *ReadGrid(const char *filename, int *gridsize)
+   ---------------------------------------------------
+   Read a square grid from a file, as written by -a: the width of the
+   first non-blank line gives the size and the grid ends at the next 
+   blank line or the end of the file, so a puzzle may be read straight
+   from the output. Letters are made upper case to match the word list.
+   The grid is returned with rows gridsize+1 bytes apart, or NULL if it
+   could not be read.
+
+   18.10.26 Original    By: agent
+*/
+char *ReadGrid(const char *filename, int *gridsize)
+{
+   FILE    *fp;
+   char    *line = NULL,
+           *grid = NULL;
+   size_t  size  = 0;
+   ssize_t length;
+   int     i, rows = 0;
+
+   if((fp = fopen(filename, "r"))==NULL)
+   {
+      fprintf(stderr,"Unable to open grid file: %s\n", filename);
+      return(NULL);
+   }
+
+   *gridsize = 0;
+   while((length = getline(&line, &size, fp)) >= 0)
+   {
+      while(length && (line[length-1] == '\n' || line[length-1] == '\r'))
+         line[--length] = '\0';
+      if(length == 0)
+      {
+         if(rows)
+            break;
+         continue;
+      }
+
+      if(rows == 0)
+      {
+         *gridsize = (int)length;
+         if((grid = (char *)malloc((size_t)length * (length+1)))==NULL)
          {
-            fprintf(gOut,"/xpos xstart def\n");
-            for(j=0; j<3; j++)
-            {
-               if(i+j < NWords)
-               {
-                  fprintf(gOut,"xpos ypos moveto (%s) show\n",
-                          gWords[i+j]);
-                  fprintf(gOut,"/xpos xpos 175 add def\n");
-               }
-            }
-            fprintf(gOut,"/ypos ypos size sub def\n");
+            fprintf(stderr,"Unable to allocate memory.\n");
+            break;
          }
       }
+      if(length != *gridsize || rows == *gridsize)
+      {
+         rows = -1;
+         break;
+      }
+
+      for(i=0; i<length; i++)
+         line[i] = (char)toupper((unsigned char)line[i]);
+      memcpy(grid + (size_t)rows * (length+1), line, length + 1);
+      rows++;
+   }
+   free(line);
+   fclose(fp);
+
+   if(grid != NULL && rows != *gridsize)
+   {
+      fprintf(stderr,"Grid in %s is not square.\n", filename);
+      free(grid);
+      return(NULL);
    }
+   if(grid == NULL && rows == 0)
+      fprintf(stderr,"No grid in %s\n", filename);
+
+   return(grid);
 }
 
 /************************************************************************/
-/*>void DoASCIIOutput(char **grid, int gridsize, BOOL WordList, 
-                      int NWords, BOOL solution)
-   ------------------------------------------------------------
-   Create ASCII output.
-   Input:   char  **grid      The character grid
-            int   gridsize    The size of the grid
-            BOOL  WordList    Should be display the word list if this
-                              isn't the solution display
-            int   NWords      Number of words in the word list
-            BOOL  solution    Is this a solution display
-
-   14.01.94 Original    By: ACRM
-*/
-void DoASCIIOutput(char **grid, int gridsize, BOOL WordList, 
-                   int NWords, BOOL solution)
-{
-   int   i, j, k;
-   
-   if(solution)
-      fprintf(gOut,"Solution:\n");
+/*>WSINDEX *OpenIndex(const char *filename)
+   ----------------------------------------
+   Open a word index written with -mkindex. Returns NULL, having said
+   why, if it cannot be opened.
+
+   18.10.26 Original    By: agent
+*/
+WSINDEX *OpenIndex(const char *filename)
+{
+   WSINDEX *index;
+   FILE    *fp;
+
+   if((fp = fopen(filename, "rb"))==NULL)
+   {
+      fprintf(stderr,"Unable to open word index: %s\n", filename);
+      return(NULL);
+   }
+   if((index = wsOpenIndex(fp))==NULL)
+      fprintf(stderr,"Not a word index: %s\n", filename);
+   fclose(fp);
+
+   return(index);
+}
+
+/************************************************************************/
+/*>BOOL WriteIndex(WSOPTIONS *options, WSWORDLIST *words)
+   ------------------------------------------------------
+   Write the words read to the word index named by -mkindex. The index
+   is written to a file of its own and then renamed into place, since a
+   server may have the old index mapped into memory and would fault if
+   it were cut short. Returns FALSE if it could not be written.
+
+   18.10.26 Original    By: agent
+            Writes a temporary file and renames it
+*/
+BOOL WriteIndex(WSOPTIONS *options, WSWORDLIST *words)
+{
+   FILE *fp;
+   char *temp;
+   int  status;
+
+   if((temp = (char *)malloc(strlen(options->makeIndex) + 32))==NULL)
+   {
+      fprintf(stderr,"%s: %s\n", options->makeIndex,
+              wsErrorString(WS_NOMEMORY));
+      return(FALSE);
+   }
+   sprintf(temp, "%s.%ld.tmp", options->makeIndex, (long)getpid());
+
+   if((fp = fopen(temp, "wb"))==NULL)
+   {
+      fprintf(stderr,"Unable to open word index: %s\n", temp);
+      free(temp);
+      return(FALSE);
+   }
+   status = wsWriteIndex(words, fp);
+   if(fclose(fp) && status == WS_OK)
+      status = WS_WRITEERROR;
+   if(status == WS_OK && rename(temp, options->makeIndex) != 0)
+      status = WS_WRITEERROR;
+
+   if(status != WS_OK)
+   {
+      remove(temp);
+      free(temp);
+      fprintf(stderr,"%s: %s\n", options->makeIndex, 
+              wsErrorString(status));
+      return(FALSE);
+   }
+   free(temp);
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>BOOL RenderPuzzles(WSOPTIONS *options, FILE *in, FILE *out)
+   -----------------------------------------------------------
+   Render every puzzle of the puzzle file given as the input, written
+   with -save, in the style and with the switches given now. The grid
+   size is that of the largest puzzle. With -book they are pages of one
+   book and with -save they are added to another puzzle file. Returns
+   FALSE if the input is not a puzzle file or a puzzle could not be
+   rendered.
 
-   for(i=0; i<gridsize; i++)
-      fprintf(gOut,"%s\n",grid[i]);
-   fprintf(gOut,"\n");
+   18.10.26 Original    By: agent
+*/
+BOOL RenderPuzzles(WSOPTIONS *options, FILE *in, FILE *out)
+{
+   WSPUZZLES *puzzles;
+   WSCONTEXT *ctx;
+   WSBOOK    *book = NULL;
+   WSSINK    sink;
+   RESULT    result;
+   FILE      *page,
+             *answer,
+             *save = NULL;
+   BOOL      ok    = TRUE;
+   int       i, status, npuzzles;
 
-   if(!solution)           /* Print the word list                       */
+   if((puzzles = wsOpenPuzzles(in))==NULL)
    {
-      if(WordList)
+      fprintf(stderr,"Input is not a puzzle file.\n");
+      return(FALSE);
+   }
+   npuzzles          = wsPuzzleCount(puzzles);
+   options->gridSize = wsPuzzleGridSize(puzzles);
+   options->autoGrid = FALSE;
+
+   if(options->save != NULL && (save = fopen(options->save, "ab"))==NULL)
+   {
+      fprintf(stderr,"Unable to open puzzle file: %s\n", options->save);
+      wsClosePuzzles(puzzles);
+      return(FALSE);
+   }
+   if((ctx = wsCreateContext(options))==NULL ||
+      (options->book &&
+       (book = wsCreateBook(options, wsFileSink(&sink, out)))==NULL))
+   {
+      fprintf(stderr,"Unable to allocate memory.\n");
+      return(FALSE);
+   }
+
+   for(i=0; i<npuzzles; i++)
+   {
+      if((status = wsLoadPuzzle(ctx, puzzles, i)) == WS_OK)
       {
-         char buffer[88];
-         
-         /* Display the word list, 3 to a line                          */
-         for(i=0; i<NWords; i+=3)
+         if(book == NULL)
          {
-            for(j=0; j<80; j++) buffer[j] = ' ';
-            buffer[80] = '\0';
-         
-            for(j=0; j<3; j++)
+            status = RenderPuzzle(ctx, out, NULL, save);
+         }
+         else
+         {
+            /* Book pages are rendered into buffers as for a batch      */
+            memset(&result, 0, sizeof(RESULT));
+            result.status = WS_NOMEMORY;
+            if((page = open_memstream(&(result.text), 
+                                      &(result.length))) != NULL)
             {
-               if(i+j < NWords)
+               if((answer = open_memstream(&(result.answer),
+                                           &(result.answerLength))) 
+                  != NULL)
                {
-                  for(k=0; k<strlen(gWords[i+j]); k++)
-                     buffer[j*26 + k] = gWords[i+j][k];
+                  result.status = RenderPuzzle(ctx, page, answer, save);
+                  fclose(answer);
                }
+               fclose(page);
             }
-            fprintf(gOut,"%s\n",buffer);
+            status = WriteResult(&result, book, out, NULL);
          }
       }
+      if(status != WS_OK)
+      {
+         if(npuzzles > 1) fprintf(stderr,"Puzzle %d: ", i+1);
+         fprintf(stderr,"%s.\n", wsErrorString(status));
+         ok = FALSE;
+      }
    }
+
+   if(book != NULL && wsFinishBook(book) != WS_OK)
+   {
+      fprintf(stderr,"%s.\n", wsErrorString(WS_WRITEERROR));
+      ok = FALSE;
+   }
+   if(save != NULL && fclose(save))
+   {
+      fprintf(stderr,"%s: %s.\n", options->save,
+              wsErrorString(WS_WRITEERROR));
+      ok = FALSE;
+   }
+   wsDestroyContext(ctx);
+   wsClosePuzzles(puzzles);
+
+   return(ok);
 }
 
 /************************************************************************/
-/*>void DoLaTeXOutput(char **grid, int gridsize, BOOL WordList, 
-                      int NWords, BOOL solution)
-   ------------------------------------------------------------
-   Create LaTeX output.
-   Input:   char  **grid      The character grid
-            int   gridsize    The size of the grid
-            BOOL  WordList    Should be display the word list if this
-                              isn't the solution display
-            int   NWords      Number of words in the word list
-            BOOL  solution    Is this a solution display
-
-   14.01.94 Original    By: ACRM
-*/
-void DoLaTeXOutput(char **grid, int gridsize, BOOL WordList, 
-                   int NWords, BOOL solution)
-{
-   int   i, j;
-   
-   if(solution)
+/*>uint64_t NowNs(void)
+   --------------------
+   Returns the monotonic clock in ns
+
+   18.10.26 Original    By: agent
+*/
+uint64_t NowNs(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+/************************************************************************/
+/*>BOOL RunServer(WSOPTIONS *options)
+   ----------------------------------
+   Serve puzzle requests until killed, on the Unix domain socket named
+   by options->server or, if that is "-", on stdin and stdout. On a
+   socket, options->nThreads threads (0 for one per CPU) each accept
+   connections and serve them one at a time. Each thread keeps its
+   context, word list and output buffer from one request to the next.
+   Returns FALSE if the server could not be started.
+
+   A request is a line of switches, exactly as they would be given on
+   the command line, then the words one per line and then a line
+   holding only a full stop:
+      -g 15 -a -seed 42
+      CAT
+      DOG
+      .
+   The switches start from those the server was given. Without -seed,
+   each request gets the next seed in a series from the server's seed.
+   If the server was given a word index with -index, every request
+   samples words from it and need give none of its own.
+   The reply is a line "OK <bytes>" followed by that many bytes of
+   output, which is what the command line program would write for the
+   same switches and words, or a line "ERROR <message>". A connection
+   may carry any number of requests. If a deadline passed and words
+   were dropped, the OK line goes on with "DROPPED" and the words.
+
+   A request may not name files, change the server's index or cache, or
+   ask for more than MAXREQUESTPUZZLES puzzles. Nor may it ask for a
+   grid, portfolio, number of threads or number of words beyond the
+   MAXREQUEST limits, unless the server was started with that setting.
+
+   18.10.26 Original    By: agent
+            Opens the word index
+*/
+BOOL RunServer(WSOPTIONS *options)
+{
+   SERVER             server;
+   SERVERWORKER       *workers;
+   struct sockaddr_un address;
+   int                i,
+                      nthreads = options->nThreads;
+
+   server.options   = *options;
+   server.nrequests = 0;
+   server.listenfd  = -1;
+   server.index     = NULL;
+   pthread_mutex_init(&(server.lock), NULL);
+
+   if(options->index != NULL && 
+      (server.index = OpenIndex(options->index))==NULL)
+      return(FALSE);
+
+   /* A client that goes away should not take the server with it        */
+   signal(SIGPIPE, SIG_IGN);
+
+   if(!strcmp(options->server, "-"))
    {
-      fprintf(gOut,"\\noindent Solution:\n\n");
-      fprintf(gOut,"\\vspace{2em}\n\n");
+      if((workers = (SERVERWORKER *)calloc(1, sizeof(SERVERWORKER)))
+         ==NULL)
+      {
+         fprintf(stderr,"Unable to allocate memory.\n");
+         return(FALSE);
+      }
+      workers->server = &server;
+      ServeRequests(workers, stdin, stdout);
+      FreeServerWorker(workers);
+      free(workers);
+      wsCloseIndex(server.index);
+      return(TRUE);
    }
 
-   fprintf(gOut,"\\begin{center}\n");
-   for(i=0; i<gridsize; i++)
+   if(strlen(options->server) >= sizeof(address.sun_path))
    {
-      for(j=0; j<gridsize; j++)
-         fprintf(gOut,"\\s{%c}",grid[i][j]);
-      fprintf(gOut,"\n\n");
+      fprintf(stderr,"Socket name is too long: %s\n", options->server);
+      return(FALSE);
+   }
+   memset(&address, 0, sizeof(address));
+   address.sun_family = AF_UNIX;
+   strcpy(address.sun_path, options->server);
+   unlink(options->server);
+
+   if((server.listenfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+      bind(server.listenfd, (struct sockaddr *)&address, 
+           sizeof(address)) < 0 ||
+      listen(server.listenfd, LISTENQUEUE) < 0)
+   {
+      fprintf(stderr,"Unable to listen on socket: %s\n", 
+              options->server);
+      return(FALSE);
    }
-   fprintf(gOut,"\\end{center}\n");
 
-   if(solution)
+   if(nthreads < 1)
+      nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+   if(nthreads < 1)
+      nthreads = 1;
+   if((workers = (SERVERWORKER *)calloc(nthreads, sizeof(SERVERWORKER)))
+      ==NULL)
    {
-      fprintf(gOut,"\\newpage\n");
+      fprintf(stderr,"Unable to allocate memory.\n");
+      return(FALSE);
    }
-   else                    /* Print the word list                       */
+
+   /* This thread is the first worker                                   */
+   for(i=0; i<nthreads; i++)
    {
-      if(WordList)
+      workers[i].server = &server;
+      if(i && pthread_create(&(workers[i].thread), NULL, ServerWorker,
+                             &(workers[i])))
       {
-         /* Display the word list, 3 to a line                          */
-         fprintf(gOut,"\\vspace{2em}\n");
-         fprintf(gOut,"\\begin{center}\n");
-         fprintf(gOut,"\\begin{tabular}{lll}\n");
-            
-         for(i=0; i<NWords; i+=3)
+         fprintf(stderr,"Unable to start server thread %d\n", i+1);
+         break;
+      }
+   }
+   ServerWorker(&(workers[0]));
+
+   return(FALSE);
+}
+
+/************************************************************************/
+/*>void *ServerWorker(void *arg)
+   -----------------------------
+   Thread function for a server thread. Accepts connections and serves
+   the requests on each in turn.
+
+   18.10.26 Original    By: agent
+*/
+void *ServerWorker(void *arg)
+{
+   SERVERWORKER *worker = (SERVERWORKER *)arg;
+   FILE         *in, *out;
+   int          fd, fd2;
+
+   while((fd = accept(worker->server->listenfd, NULL, NULL)) >= 0 ||
+         errno == EINTR || errno == ECONNABORTED)
+   {
+      if(fd < 0)
+         continue;
+
+      if((fd2 = dup(fd)) < 0 ||
+         (in  = fdopen(fd, "r"))==NULL)
+      {
+         close(fd);
+         if(fd2 >= 0) close(fd2);
+         continue;
+      }
+      if((out = fdopen(fd2, "w"))==NULL)
+      {
+         fclose(in);
+         close(fd2);
+         continue;
+      }
+
+      ServeRequests(worker, in, out);
+      fclose(in);
+      fclose(out);
+   }
+
+   fprintf(stderr,"Server thread stopped: unable to accept \
+connections\n");
+   return(NULL);
+}
+
+/************************************************************************/
+/*>void ServeRequests(SERVERWORKER *worker, FILE *in, FILE *out)
+   -------------------------------------------------------------
+   Read requests from in and write the replies to out until the end of
+   the input
+
+   18.10.26 Original    By: agent
+            Lists dropped words
+*/
+void ServeRequests(SERVERWORKER *worker, FILE *in, FILE *out)
+{
+   char        *line   = NULL,
+               *switches;
+   size_t      size    = 0;
+   ssize_t     length;
+   const char  *error;
+   BOOL        ended;
+
+   while((length = getline(&line, &size, in)) >= 0)
+   {
+      if((switches = strdup(line))==NULL)
+         break;
+      error = StartRequest(worker, switches);
+      free(switches);
+
+      /* Read the words even after an error so the next request is found
+         in the right place
+      */
+      ended = FALSE;
+      while((length = getline(&line, &size, in)) >= 0)
+      {
+         while(length && (line[length-1] == '\n' || 
+                          line[length-1] == '\r'))
+            line[--length] = '\0';
+         if(!strcmp(line, "."))
          {
-            for(j=0; j<3; j++)
-            {
-               if(i+j < NWords)
-                  fprintf(gOut,"%s ",gWords[i+j]);
-               else
-                  fprintf(gOut," ");
-                  
-               fprintf(gOut,"%s",((j<2) ? "&" : "\\\\\n"));
-            }
+            ended = TRUE;
+            break;
          }
+         if(error == NULL && length)
+            wsAddWord(worker->words, line);
+      }
+      if(!ended)
+         break;
 
-         fprintf(gOut,"\\end{tabular}\n");
-         fprintf(gOut,"\\end{center}\n");
+      if(error == NULL)
+         error = FinishRequest(worker);
+
+      if(error != NULL)
+         fprintf(out, "ERROR %s\n", error);
+      else
+      {
+         fprintf(out, "OK %lu%s%.*s\n", (unsigned long)worker->used,
+                 (worker->droppedUsed ? " DROPPED" : ""),
+                 (int)worker->droppedUsed, worker->dropped);
+         fwrite(worker->buffer, 1, worker->used, out);
       }
+      if(fflush(out))
+         break;
    }
+
+   free(line);
 }
 
 /************************************************************************/
-/*>void SortByLength(char **Words, int NWords)
-   -------------------------------------------
-   Sort strings in an array by length (longest first).
-   
-   13.01.94 Framework
+/*>const char *StartRequest(SERVERWORKER *worker, char *switches)
+   --------------------------------------------------------------
+   Set up the worker's options, context and word list for a request from
+   its line of switches. The switches are read by ReadCmdLine() exactly
+   as on the command line. Switches that name files or directories, and
+   those only the command line program uses, are refused, since the
+   server would otherwise read or write wherever a client asked.
+   Returns NULL or an error message. The line is modified.
+
+   18.10.26 Original    By: agent
+            Gives the word list the server's index
+            Refuses the cache, save, solve, render, stats and server
+            switches and too many puzzles
+            Refuses too large a grid, portfolio, -j or -w
+*/
+const char *StartRequest(SERVERWORKER *worker, char *switches)
+{
+   SERVER *server = worker->server;
+   char   *argv[MAXSWITCHES+1],
+          infile[MAXBUFF],
+          outfile[MAXBUFF];
+   int    argc = 0;
+
+   argv[argc++] = "wordsearch";
+   for(argv[argc] = strtok(switches, " \t\r\n");
+       argv[argc] != NULL;
+       argv[argc] = strtok(NULL, " \t\r\n"))
+   {
+      if(++argc > MAXSWITCHES)
+         return("Too many switches");
+   }
+
+   pthread_mutex_lock(&(server->lock));
+   worker->options      = server->options;
+   worker->options.seed = wsPuzzleSeed(server->options.seed, 
+                                       server->nrequests++);
+   pthread_mutex_unlock(&(server->lock));
+
+   infile[0]  = '\0';
+   outfile[0] = '\0';
+   if(!ReadCmdLine(argc, argv, infile, outfile, &(worker->options)))
+      return("Invalid switches");
+   if(infile[0] || outfile[0] ||
+      worker->options.index     != server->options.index     ||
+      worker->options.cache     != server->options.cache     ||
+      worker->options.statsFile != server->options.statsFile ||
+      worker->options.server    != server->options.server    ||
+      worker->options.makeIndex != server->options.makeIndex ||
+      worker->options.save      != server->options.save      ||
+      worker->options.solve     != server->options.solve     ||
+      worker->options.render    != server->options.render)
+      return("Files may not be given in a request");
+   if(worker->options.nPuzzles > MAXREQUESTPUZZLES)
+      return("Too many puzzles in a request");
+   if(OVERLIMIT(worker->options.gridSize, server->options.gridSize,
+                MAXREQUESTGRID))
+      return("Grid too large for a request");
+   if(OVERLIMIT(worker->options.portfolio, server->options.portfolio,
+                MAXREQUESTPORTFOLIO))
+      return("Portfolio too large for a request");
+   if(OVERLIMIT(worker->options.nThreads, server->options.nThreads,
+                MAXREQUESTTHREADS))
+      return("Too many threads for a request");
+   if(OVERLIMIT(worker->options.maxWords, server->options.maxWords,
+                MAXREQUESTWORDS))
+      return("Too many words for a request");
+
+   /* These belong to the server, not to a request                      */
+   worker->options.stats     = FALSE;
+   worker->options.statsFile = NULL;
+   worker->options.server    = NULL;
+
+   if(worker->ctx != NULL && 
+      !wsUpdateContext(worker->ctx, &(worker->options)))
+   {
+      wsDestroyContext(worker->ctx);
+      worker->ctx = NULL;
+   }
+   if(worker->ctx == NULL &&
+      (worker->ctx = wsCreateContext(&(worker->options)))==NULL)
+      return(wsErrorString(WS_NOMEMORY));
+
+   if(worker->words != NULL && 
+      !wsResetWordList(worker->words, &(worker->options)))
+   {
+      wsDestroyWordList(worker->words);
+      worker->words = NULL;
+   }
+   if(worker->words == NULL &&
+      (worker->words = wsCreateWordList(&(worker->options)))==NULL)
+      return(wsErrorString(WS_NOMEMORY));
+   wsSetIndex(worker->words, server->index);
+
+   return(NULL);
+}
+
+/************************************************************************/
+/*>const char *FinishRequest(SERVERWORKER *worker)
+   -----------------------------------------------
+   Build and render the puzzles for a request whose words have been
+   read, into the worker's output buffer. Returns NULL or an error
+   message.
+
+   18.10.26 Original    By: agent
+            A request to a server with an index needs no words
+            Collects dropped words
+*/
+const char *FinishRequest(SERVERWORKER *worker)
+{
+   WSSINK sink;
+   int    i, j, status;
+
+   sink.write          = BufferWrite;
+   sink.handle         = (void *)worker;
+   worker->used        = 0;
+   worker->droppedUsed = 0;
+
+   if(wsWordCount(worker->words) == 0 && worker->server->index == NULL)
+      return("No words");
+
+   for(i=0; i<worker->options.nPuzzles; i++)
+   {
+      if((status = wsGenerate(worker->ctx, worker->words,
+                              wsPuzzleSeed(worker->options.seed, i)))
+         != WS_OK ||
+         (status = wsRender(worker->ctx, &sink)) != WS_OK)
+         return(wsErrorString(status));
+      for(j=0; j<wsDroppedWords(worker->ctx); j++)
+      {
+         if(!AddDropped(worker, wsGetDropped(worker->ctx, j)))
+            return(wsErrorString(WS_NOMEMORY));
+      }
+   }
+
+   return(NULL);
+}
+
+/************************************************************************/
+/*>size_t BufferWrite(void *handle, const char *buffer, size_t length)
+   -------------------------------------------------------------------
+   Sink write function which appends to a server worker's output buffer,
+   growing it as needed
+
+   18.10.26 Original    By: agent
+*/
+size_t BufferWrite(void *handle, const char *buffer, size_t length)
+{
+   SERVERWORKER *worker = (SERVERWORKER *)handle;
+   char         *grown;
+   size_t       size;
+
+   if(worker->used + length > worker->size)
+   {
+      for(size = (worker->size ? worker->size : OUTBLOCK); 
+          size < worker->used + length; 
+          size *= 2);
+      if((grown = (char *)realloc(worker->buffer, size))==NULL)
+         return(0);
+      worker->buffer = grown;
+      worker->size   = size;
+   }
+
+   memcpy(worker->buffer + worker->used, buffer, length);
+   worker->used += length;
+   return(length);
+}
+
+/************************************************************************/
+/*>BOOL AddDropped(SERVERWORKER *worker, const char *word)
+   -------------------------------------------------------
+   Add a dropped word, after a space, to a server worker's list of them,
+   growing it as needed. Returns FALSE if out of memory.
+
+   18.10.26 Original    By: agent
 */
-void SortByLength(char **Words, int NWords)
+BOOL AddDropped(SERVERWORKER *worker, const char *word)
 {
+   size_t length = strlen(word) + 1,
+          size;
+   char   *grown;
+
+   if(worker->droppedUsed + length > worker->droppedSize)
+   {
+      for(size = (worker->droppedSize ? worker->droppedSize : 256);
+          size < worker->droppedUsed + length;
+          size *= 2);
+      if((grown = (char *)realloc(worker->dropped, size))==NULL)
+         return(FALSE);
+      worker->dropped     = grown;
+      worker->droppedSize = size;
+   }
+
+   worker->dropped[worker->droppedUsed] = ' ';
+   memcpy(worker->dropped + worker->droppedUsed + 1, word, length - 1);
+   worker->droppedUsed += length;
+   return(TRUE);
 }
 
+/************************************************************************/
+/*>void FreeServerWorker(SERVERWORKER *worker)
+   ------------------------------------------
+   Free the memory kept by a server thread
+
+   18.10.26 Original    By: agent
+*/
+void FreeServerWorker(SERVERWORKER *worker)
+{
+   wsDestroyContext(worker->ctx);
+   wsDestroyWordList(worker->words);
+   free(worker->buffer);
+   free(worker->dropped);
+}
+
+/************************************************************************/
+/*>void Usage(void)
+   ----------------
+   Print a usage message.
+   
+   13.01.94 Original    By: ACRM
+   14.01.94 Added n,p,l,a and f switches
+   18.10.26 Modified    By: agent
+            Added b and j switches
+            Added -seed
+            Updated descriptions of -w and -m
+            Added -sample, -minlen and -quota
+            Added -portfolio
+            Added -stats
+            Added -server
+            Added -tile
+            Added -verify and -solve
+            Added -unique
+            Added -dirs
+            Added -cache
+            Added -book
+            Added -pdf
+            Added -index, -mkindex, -with and -without
+            Added -dense
+            Added -g auto
+            Added -deadline and -fallback
+            Added -save and render
+            Added -budget
+            The version is WS_VERSION
+            Gives MAXPORTFOLIO
+*/
+void Usage(void)
+{
+   fprintf(stderr,"WordSearch V%s (c) 1994-2026, Dr. Andrew C. R. \
+Martin, SciTech Software\n", WS_VERSION);
+   fprintf(stderr,"Usage: wordsearch [-w maxwords] [-m maxwordlen] \
+[-g gridsize|auto]\n");
+   fprintf(stderr,"                  [-s] [-h] [-n] [-p] [-l] [-a] \
+[-pdf] [-f fontsize]\n");
+   fprintf(stderr,"                  [-b count] [-j threads] \
+[-seed n]\n");
+   fprintf(stderr,"                  [-sample] [-minlen n] \
+[-quota len:count[,...]]\n");
+   fprintf(stderr,"                  [-portfolio n] [-stats file] \
+[-server socket]\n");
+   fprintf(stderr,"                  [-tile n] [-verify] [-solve grid] \
+[-unique]\n");
+   fprintf(stderr,"                  [-dirs list] [-cache dir] [-book] \
+[-mkindex file]\n");
+   fprintf(stderr,"                  [-index file] [-with letters] \
+[-without letters]\n");
+   fprintf(stderr,"                  [-dense] [-deadline ms] \
+[-fallback none|partial|drop|grow]\n");
+   fprintf(stderr,"                  [-budget n] [-save file] [infile] \
+[outfile]\n");
+   fprintf(stderr,"       wordsearch render [-s] [-n] [-p] [-l] [-a] \
+[-pdf] [-f fontsize]\n");
+   fprintf(stderr,"                  [-book] [-save file] puzzlefile \
+[outfile]\n\n");
+   fprintf(stderr,"       -w      Max words in a puzzle (Default: %d)\n",
+           MAXWORDS);
+   fprintf(stderr,"       -m      Max word length; longer words are \
+skipped (Default: %d)\n", MAXWORDLEN);
+   fprintf(stderr,"       -g      Grid size (Default: %d), or auto for \
+the smallest grid the\n",GRIDSIZE);
+   fprintf(stderr,"               words fit in, up to %d\n",MAXAUTOGRID);
+   fprintf(stderr,"       -s      Output solution\n");
+   fprintf(stderr,"       -n      Do not output word list\n");
+   fprintf(stderr,"       -p      Postscript output (default)\n");
+   fprintf(stderr,"       -l      LaTeX output\n");
+   fprintf(stderr,"       -a      ASCII output\n");
+   fprintf(stderr,"       -pdf    PDF output\n");
+   fprintf(stderr,"       -f      PostScript and PDF font size \
+(Default: 18)\n");
+   fprintf(stderr,"       -b      Number of puzzles to build (Default: \
+%d)\n",NPUZZLES);
+   fprintf(stderr,"       -j      Number of threads, 0 for one per CPU \
+(Default: %d)\n",NTHREADS);
+   fprintf(stderr,"               Also used to fill the tiles of a \
+large grid\n");
+   fprintf(stderr,"       -seed   Random number seed (Default: from \
+the time)\n");
+   fprintf(stderr,"       -sample Use a random sample of the words \
+rather than the first\n");
+   fprintf(stderr,"       -minlen Min word length; shorter words are \
+skipped (Default: 1)\n");
+   fprintf(stderr,"       -quota  Number of words of each length in a \
+sample\n");
+   fprintf(stderr,"       -portfolio Race n searches for each puzzle \
+and use the first\n");
+   fprintf(stderr,"               to finish (Default: 1, Max: %d)\n",
+           MAXPORTFOLIO);
+   fprintf(stderr,"       -stats  Write a JSON summary of the work done \
+to file, or to\n");
+   fprintf(stderr,"               standard error if file is -\n");
+   fprintf(stderr,"       -server Serve requests on a Unix domain \
+socket, or on standard\n");
+   fprintf(stderr,"               input and output if socket is -. \
+Each request is a\n");
+   fprintf(stderr,"               line of switches, the words and a \
+line holding \".\"\n");
+   fprintf(stderr,"       -tile   Split grids of at least twice n \
+into tiles of about n\n");
+   fprintf(stderr,"               which are filled in parallel, 0 for \
+never (Default: %d)\n", TILESIZE);
+   fprintf(stderr,"       -verify Search each puzzle for its words and \
+fail if one is missing\n");
+   fprintf(stderr,"       -solve  Find the words of infile in a grid \
+file and list where each\n");
+   fprintf(stderr,"               is as column,row,direction\n");
+   fprintf(stderr,"       -unique Fill blanks without making extra \
+copies of the words\n");
+   fprintf(stderr,"       -dirs   Directions words may run in: a comma \
+separated list of\n");
+   fprintf(stderr,"               N, NE, E, SE, S, SW, W and NW, or all \
+(Default: E,S,SE)\n");
+   fprintf(stderr,"       -cache  Keep puzzles in dir and reuse them when \
+the same words,\n");
+   fprintf(stderr,"               seed and grid options are given again\n");
+   fprintf(stderr,"       -book   Write the puzzles as numbered pages of \
+one document, with\n");
+   fprintf(stderr,"               the solutions (-s) as an answer key at \
+the end\n");
+   fprintf(stderr,"       -mkindex Write the words read to a word index \
+file\n");
+   fprintf(stderr,"       -index  Make up each puzzle's words (-w) with \
+words picked at\n");
+   fprintf(stderr,"               random from a word index, after those \
+of infile if given\n");
+   fprintf(stderr,"       -with   Words picked from an index must have \
+all these letters\n");
+   fprintf(stderr,"       -without and none of these\n");
+   fprintf(stderr,"       -dense  Place words where they share the most \
+letters with those\n");
+   fprintf(stderr,"               already placed, to fit more in small \
+grids\n");
+   fprintf(stderr,"       -deadline Stop placing words after ms \
+milliseconds (Default: no limit)\n");
+   fprintf(stderr,"       -fallback What to do then: fail (none), \
+keep the most words the search\n");
+   fprintf(stderr,"               placed (partial), try the rest once \
+more and drop those\n");
+   fprintf(stderr,"               that do not fit (drop), or also grow \
+the grid for them (grow)\n");
+   fprintf(stderr,"               Dropped words are listed on stderr \
+(Default: none)\n");
+   fprintf(stderr,"       -budget Placements the search may make before \
+it gives up on a\n");
+   fprintf(stderr,"               puzzle (Default: %lu per word plus \
+%lu, or no limit\n", BUDGETPERWORD, BUDGETBASE);
+   fprintf(stderr,"               with -deadline)\n");
+   fprintf(stderr,"       -save   Add each puzzle to the end of a \
+compact binary puzzle file\n");
+   fprintf(stderr,"       render  Render the puzzles of a puzzle file \
+again, in any style\n");
+   fprintf(stderr,"               and font size, rather than build new \
+ones (also -render)\n");
+
+   fprintf(stderr,"       -h      This help message\n");
+   fprintf(stderr,"       infile  Optional input file\n");
+   fprintf(stderr,"       outfile Optional output file\n\n");
+   
+   fprintf(stderr,"WordSearch takes a list of words from standard \
+input or\n");
+   fprintf(stderr,"infile if specified and creates a word search \
+grid.\n");
+   fprintf(stderr,"Output which is in PostScript format by default, \
+goes\n");
+   fprintf(stderr,"to standard output or to outfile if specified.\n");
+   fprintf(stderr,"With -b, the puzzles are written one after another \
+in a\n");
+   fprintf(stderr,"fixed order whatever the number of threads.\n");
+   fprintf(stderr,"The same seed and input always give the same \
+puzzles.\n");
+}
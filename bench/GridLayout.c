@@ -0,0 +1,293 @@
+/*************************************************************************
+
+   Program:    GridLayout
+   File:       GridLayout.c
+
+   Version:    V1.1
+   Date:       18.10.26
+   Function:   Benchmark the old row-pointer grid layout against the
+               flat row-major layout used by libwordsearch
+
+   Copyright:  (c) SciTech Software 1994-2026
+   Author:     agent
+   Address:    SciTech Software
+               23, Stag Leys,
+               Ashtead,
+               Surrey,
+               KT21 2TD.
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Description:
+   ============
+   Each layout goes through the same cycle a batch worker does for each
+   puzzle: get a blank grid, run the fit test for a word at every start
+   position in the horizontal, vertical and diagonal directions, write
+   some words, fill the blanks and read the grid back as output would.
+
+   The old layout is a char** with one malloc() per row, allocated and
+   freed for every puzzle as BuildArrays() used to. The new layout is a
+   single buffer with a stride, allocated once and reset with memset().
+
+**************************************************************************
+
+   Usage:
+   ======
+   Build with:
+      make bench
+   or:
+      cc -O2 -o gridlayout bench/GridLayout.c
+   and run with no arguments. Times are ns per grid cell per puzzle for
+   each phase: getting a blank grid, the fit scan, and fill plus read
+   back.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26 Original   By: agent
+   V1.1  18.10.26 Build notes give the Makefile   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#define _POSIX_C_SOURCE 200809L    /* For clock_gettime()               */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define WORD        "WORDSEARCH"
+#define WORDLEN     10
+#define NPHASES     3    /* Blank grid, fit scan, fill and read back    */
+
+/************************************************************************/
+/* Globals
+*/
+static unsigned long gSink = 0;    /* Stops the work being optimised out */
+
+/************************************************************************/
+/* Prototypes
+*/
+int    main(void);
+double Now(void);
+void   RunRows(int gridsize, int npuzzles, double *ns);
+void   RunFlat(int gridsize, int npuzzles, double *ns);
+
+/************************************************************************/
+/*>int main(void)
+   ---------------
+   Time both layouts on a 20x20 and a 2000x2000 grid
+
+   18.10.26 Original    By: agent
+*/
+int main(void)
+{
+   static int  sizes[]   = {20, 2000},
+               puzzles[] = {20000, 4};
+   static char *phases[] = {"blank", "scan", "fill"};
+   double      rows[NPHASES], flat[NPHASES];
+   int         i, j;
+
+   printf("%-10s %-6s %12s %12s %8s\n",
+          "grid", "phase", "rows ns/cell", "flat ns/cell", "speedup");
+   for(i=0; i<2; i++)
+   {
+      RunRows(sizes[i], puzzles[i], rows);
+      RunFlat(sizes[i], puzzles[i], flat);
+      for(j=0; j<NPHASES; j++)
+      {
+         printf("%4dx%-5d %-6s %12.3f %12.3f %8.2f\n",
+                sizes[i], sizes[i], phases[j], rows[j], flat[j],
+                rows[j]/flat[j]);
+      }
+   }
+
+   return((int)(gSink & 1));
+}
+
+/************************************************************************/
+/*>double Now(void)
+   ----------------
+   Returns the monotonic clock in seconds
+
+   18.10.26 Original    By: agent
+*/
+double Now(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return(ts.tv_sec + ts.tv_nsec * 1.0e-9);
+}
+
+/************************************************************************/
+/*>void RunRows(int gridsize, int npuzzles, double *ns)
+   -----------------------------------------------------
+   Run the cycle with a char** grid allocated per puzzle. Fills in ns[]
+   with the ns per cell per puzzle for each phase.
+
+   18.10.26 Original    By: agent
+*/
+void RunRows(int gridsize, int npuzzles, double *ns)
+{
+   static int dx[] = {1, 0, 1},
+              dy[] = {0, 1, 1};
+   double     t[NPHASES] = {0.0, 0.0, 0.0},
+              start;
+   char       **grid;
+   int        p, d, i, j, x, y;
+   unsigned   r = 1;
+
+   for(p=0; p<npuzzles; p++)
+   {
+      start = Now();
+      grid = (char **)malloc(gridsize * sizeof(char *));
+      for(i=0; i<gridsize; i++)
+      {
+         grid[i] = (char *)malloc(gridsize + 1);
+         for(j=0; j<gridsize; j++)
+            grid[i][j] = ' ';
+         grid[i][gridsize] = '\0';
+      }
+      t[0] += Now() - start;
+
+      /* Plant some words along the diagonal                            */
+      for(i=0; i+WORDLEN<=gridsize; i+=2*WORDLEN)
+         for(j=0; j<WORDLEN; j++)
+            grid[i+j][i+j] = WORD[j];
+
+      /* Fit test at every start in every direction                     */
+      start = Now();
+      for(d=0; d<3; d++)
+      {
+         for(y=0; y+dy[d]*(WORDLEN-1)<gridsize; y++)
+         {
+            for(x=0; x+dx[d]*(WORDLEN-1)<gridsize; x++)
+            {
+               for(i=0; i<WORDLEN; i++)
+               {
+                  char ch = grid[y + i*dy[d]][x + i*dx[d]];
+                  if(ch != ' ' && ch != WORD[i])
+                     break;
+               }
+               gSink += i;
+            }
+         }
+      }
+
+      t[1] += Now() - start;
+
+      /* Fill and read back                                             */
+      start = Now();
+      for(i=0; i<gridsize; i++)
+         for(j=0; j<gridsize; j++)
+            if(grid[i][j] == ' ')
+               grid[i][j] = (char)('A' + (r = r * 1103515245 + 12345) % 26);
+      for(i=0; i<gridsize; i++)
+         gSink += strlen(grid[i]);
+      t[2] += Now() - start;
+
+      /* Freeing is part of getting the next blank grid                 */
+      start = Now();
+      for(i=0; i<gridsize; i++)
+         free(grid[i]);
+      free(grid);
+      t[0] += Now() - start;
+   }
+
+   for(i=0; i<NPHASES; i++)
+      ns[i] = t[i] * 1.0e9 / ((double)gridsize * gridsize) / npuzzles;
+}
+
+/************************************************************************/
+/*>void RunFlat(int gridsize, int npuzzles, double *ns)
+   -----------------------------------------------------
+   Run the cycle with a single row-major buffer allocated once and reset
+   for each puzzle. Fills in ns[] with the ns per cell per puzzle for
+   each phase.
+
+   18.10.26 Original    By: agent
+*/
+void RunFlat(int gridsize, int npuzzles, double *ns)
+{
+   static int dx[] = {1, 0, 1},
+              dy[] = {0, 1, 1};
+   double     t[NPHASES] = {0.0, 0.0, 0.0},
+              start      = Now();
+   int        stride     = gridsize + 1,
+              p, d, i, j, x, y, step;
+   char       *grid      = (char *)malloc((size_t)gridsize * stride),
+              *cell;
+   unsigned   r = 1;
+
+   t[0] += Now() - start;
+   for(p=0; p<npuzzles; p++)
+   {
+      start = Now();
+      for(i=0; i<gridsize; i++)
+      {
+         memset(grid + (size_t)i * stride, ' ', gridsize);
+         grid[(size_t)i * stride + gridsize] = '\0';
+      }
+      t[0] += Now() - start;
+
+      /* Plant some words along the diagonal                            */
+      for(i=0; i+WORDLEN<=gridsize; i+=2*WORDLEN)
+         for(j=0; j<WORDLEN; j++)
+            grid[(size_t)(i+j) * stride + i+j] = WORD[j];
+
+      /* Fit test at every start in every direction                     */
+      start = Now();
+      for(d=0; d<3; d++)
+      {
+         step = dy[d] * stride + dx[d];
+         for(y=0; y+dy[d]*(WORDLEN-1)<gridsize; y++)
+         {
+            for(x=0; x+dx[d]*(WORDLEN-1)<gridsize; x++)
+            {
+               cell = grid + (size_t)y * stride + x;
+               for(i=0; i<WORDLEN; i++, cell+=step)
+               {
+                  if(*cell != ' ' && *cell != WORD[i])
+                     break;
+               }
+               gSink += i;
+            }
+         }
+      }
+
+      t[1] += Now() - start;
+
+      /* Fill and read back                                             */
+      start = Now();
+      for(i=0; i<gridsize; i++)
+      {
+         cell = grid + (size_t)i * stride;
+         for(j=0; j<gridsize; j++)
+            if(cell[j] == ' ')
+               cell[j] = (char)('A' + (r = r * 1103515245 + 12345) % 26);
+         gSink += strlen(cell);
+      }
+      t[2] += Now() - start;
+   }
+   free(grid);
+
+   for(i=0; i<NPHASES; i++)
+      ns[i] = t[i] * 1.0e9 / ((double)gridsize * gridsize) / npuzzles;
+}
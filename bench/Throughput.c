@@ -0,0 +1,378 @@
+/*************************************************************************
+
+   Program:    Throughput
+   File:       Throughput.c
+
+   Version:    V1.2
+   Date:       18.10.26
+   Function:   Benchmark puzzle generation and rendering in libwordsearch
+               and write the results as JSON
+
+   Copyright:  (c) SciTech Software 1994-2026
+   Author:     agent
+   Address:    SciTech Software
+               23, Stag Leys,
+               Ashtead,
+               Surrey,
+               KT21 2TD.
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Description:
+   ============
+   Sweeps grid sizes, word counts and word length distributions. Each
+   case makes a word list of random letters and generates a series of
+   puzzles from fixed seeds, then renders every puzzle that fitted in
+   each output style. Everything is seeded, so two runs do the same
+   work and only the times should differ. Words from the whole alphabet
+   almost never share letters; the "overlap" distribution uses only
+   three letters so that words cross and the search has to backtrack.
+
+   Cases where the words would fill more than MAXDENSITY of the grid are
+   left out. The search's default budget bounds the time each puzzle
+   may take, but almost all such puzzles would be given up on only once
+   the whole budget was spent, and they would take most of the run
+   while measuring nothing but the budget. Puzzles given up on in the
+   cases that are run count as failures.
+
+   For each case the JSON gives:
+      puzzles_per_sec    puzzles generated per second
+      success_rate       fraction of puzzles whose words all fitted
+      gave_up_rate       fraction given up on when the budget was spent
+      attempts_per_word  placements tried per word, from wsGetStats()
+      backtracks         words taken out again, per puzzle
+      ns_per_cell        generation time per grid cell per puzzle
+   and for each output style the bytes per puzzle and ns per cell.
+
+**************************************************************************
+
+   Usage:
+   ======
+   Build with:
+      make bench
+   or:
+      cc -O2 -o throughput bench/Throughput.c libwordsearch.c -lpthread -lz
+   and run as:
+      throughput [out.json]
+   The JSON goes to stdout if no file is given.
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26 Original   By: agent
+   V1.1  18.10.26 Added PDF   By: agent
+   V1.2  18.10.26 Puzzles given up on are reported   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#define _POSIX_C_SOURCE 200809L    /* For clock_gettime()               */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../wordsearch.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define BASESEED    20261018ULL
+#define MAXDENSITY  0.55 /* Largest fraction of cells the words may use */
+#define CELLBUDGET  400000 /* Grid cells generated per case             */
+#define MINPUZZLES  5
+#define MAXPUZZLES  2000
+#define NSTYLES     4
+
+/************************************************************************/
+/* Type definitions
+*/
+typedef struct                     /* A word length distribution        */
+{
+   char *name;
+   int  minLen,
+        maxLen,
+        nLetters;                  /* Letters used from A upwards       */
+}  LENGTHS;
+
+typedef struct                     /* Results for one output style      */
+{
+   double bytes,
+          seconds;
+}  RENDERRESULT;
+
+/************************************************************************/
+/* Prototypes
+*/
+int    main(int argc, char **argv);
+double Now(void);
+size_t CountWrite(void *handle, const char *buffer, size_t length);
+BOOL   MakeWords(WSWORDLIST *list, int nwords, LENGTHS *lengths,
+                 uint64_t seed);
+BOOL   RunCase(FILE *out, int gridsize, int nwords, LENGTHS *lengths,
+               BOOL first);
+
+/************************************************************************/
+/*>int main(int argc, char **argv)
+   -------------------------------
+   Run every case and write the JSON
+
+   18.10.26 Original    By: agent
+*/
+int main(int argc, char **argv)
+{
+   static int     sizes[]   = {12, 20, 40, 80},
+                  counts[]  = {10, 30, 100};
+   static LENGTHS lengths[] = {{"short",   3,  5, 26},
+                               {"mixed",   3, 12, 26},
+                               {"long",    8, 15, 26},
+                               {"overlap", 3, 12,  3}};
+   FILE           *out      = stdout;
+   BOOL           first     = TRUE;
+   int            i, j, k;
+   double         mean;
+
+   if(argc > 1)
+   {
+      if((out=fopen(argv[1], "w"))==NULL)
+      {
+         fprintf(stderr,"Unable to open %s\n", argv[1]);
+         return(1);
+      }
+   }
+
+   fprintf(out, "{\n  \"benchmark\": \"wordsearch-throughput\",\n");
+   fprintf(out, "  \"seed\": %llu,\n", (unsigned long long)BASESEED);
+   fprintf(out, "  \"cases\": [");
+
+   for(i=0; i<(int)(sizeof(sizes)/sizeof(int)); i++)
+   {
+      for(j=0; j<(int)(sizeof(counts)/sizeof(int)); j++)
+      {
+         for(k=0; k<(int)(sizeof(lengths)/sizeof(LENGTHS)); k++)
+         {
+            mean = (lengths[k].minLen + lengths[k].maxLen) / 2.0;
+            if(mean * counts[j] > MAXDENSITY * sizes[i] * sizes[i] ||
+               lengths[k].maxLen > sizes[i])
+               continue;
+
+            if(!RunCase(out, sizes[i], counts[j], &(lengths[k]), first))
+            {
+               fprintf(stderr,"No memory\n");
+               return(1);
+            }
+            first = FALSE;
+         }
+      }
+   }
+
+   fprintf(out, "\n  ]\n}\n");
+   if(out != stdout)
+      fclose(out);
+
+   return(0);
+}
+
+/************************************************************************/
+/*>double Now(void)
+   ----------------
+   Returns the monotonic clock in seconds
+
+   18.10.26 Original    By: agent
+*/
+double Now(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return(ts.tv_sec + ts.tv_nsec * 1.0e-9);
+}
+
+/************************************************************************/
+/*>size_t CountWrite(void *handle, const char *buffer, size_t length)
+   ------------------------------------------------------------------
+   WSSINK write function that throws the output away and adds its
+   length to the size_t at handle
+
+   18.10.26 Original    By: agent
+*/
+size_t CountWrite(void *handle, const char *buffer, size_t length)
+{
+   (void)buffer;
+   *(size_t *)handle += length;
+   return(length);
+}
+
+/************************************************************************/
+/*>BOOL MakeWords(WSWORDLIST *list, int nwords, LENGTHS *lengths,
+                  uint64_t seed)
+   --------------------------------------------------------------
+   Fill a word list with nwords words of random letters with lengths
+   and letters spread evenly over the distribution. Returns FALSE if out
+   of memory.
+
+   18.10.26 Original    By: agent
+*/
+BOOL MakeWords(WSWORDLIST *list, int nwords, LENGTHS *lengths,
+               uint64_t seed)
+{
+   char     word[MAXWORDLEN+1];
+   int      i, j, len,
+            n = 0;
+   uint64_t r;
+
+   for(i=0; i<nwords; i++)
+   {
+      r   = wsPuzzleSeed(seed, n++);
+      len = lengths->minLen +
+            (int)(r % (lengths->maxLen - lengths->minLen + 1));
+      for(j=0; j<len; j++)
+      {
+         r       = wsPuzzleSeed(seed, n++);
+         word[j] = (char)('A' + r % lengths->nLetters);
+      }
+      word[len] = '\0';
+      if(!wsAddWord(list, word))
+         return(FALSE);
+   }
+
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>BOOL RunCase(FILE *out, int gridsize, int nwords, LENGTHS *lengths,
+                BOOL first)
+   -------------------------------------------------------------------
+   Generate and render a series of puzzles for one case and write its
+   JSON object. Each style has its own context; generating from the same
+   seed gives the same puzzle in each, and only the rendering is timed.
+   Returns FALSE if out of memory.
+
+   18.10.26 Original    By: agent
+            Counts puzzles given up on
+*/
+BOOL RunCase(FILE *out, int gridsize, int nwords, LENGTHS *lengths,
+             BOOL first)
+{
+   static int    styles[] = {STYLE_PS, STYLE_LATEX, STYLE_ASCII, 
+                             STYLE_PDF};
+   static char   *names[] = {"ps", "latex", "ascii", "pdf"};
+   WSOPTIONS     options;
+   WSWORDLIST    *words;
+   WSCONTEXT     *ctx[NSTYLES];
+   WSSINK        sink;
+   WSSTATS       stats;
+   RENDERRESULT  render[NSTYLES];
+   size_t        bytes;
+   double        genTime   = 0.0,
+                 attempts  = 0.0,
+                 backtracks = 0.0,
+                 cells, start;
+   int           npuzzles, nfitted = 0,
+                 ngaveup = 0,
+                 i, s, status;
+   uint64_t      seed;
+
+   wsDefaultOptions(&options);
+   options.gridSize   = gridsize;
+   options.maxWords   = nwords;
+   options.maxWordLen = MAXWORDLEN;
+   options.solution   = TRUE;
+   options.wordList   = TRUE;
+
+   npuzzles = CELLBUDGET / (gridsize * gridsize);
+   if(npuzzles < MINPUZZLES) npuzzles = MINPUZZLES;
+   if(npuzzles > MAXPUZZLES) npuzzles = MAXPUZZLES;
+
+   if((words = wsCreateWordList(&options))==NULL)
+      return(FALSE);
+   if(!MakeWords(words, nwords, lengths,
+                 BASESEED ^ ((uint64_t)gridsize << 32) ^ nwords))
+      return(FALSE);
+
+   for(s=0; s<NSTYLES; s++)
+   {
+      options.style = styles[s];
+      if((ctx[s] = wsCreateContext(&options))==NULL)
+         return(FALSE);
+      render[s].bytes   = 0.0;
+      render[s].seconds = 0.0;
+   }
+
+   sink.write  = CountWrite;
+   sink.handle = &bytes;
+
+   for(i=0; i<npuzzles; i++)
+   {
+      seed  = wsPuzzleSeed(BASESEED, i);
+
+      start = Now();
+      status   = wsGenerate(ctx[0], words, seed);
+      genTime += Now() - start;
+      if(status != WS_OK)
+      {
+         if(status == WS_GAVEUP)
+            ngaveup++;
+         continue;
+      }
+      nfitted++;
+
+      wsGetStats(ctx[0], &stats);
+      attempts   += stats.placements;
+      backtracks += stats.backtracks;
+
+      for(s=0; s<NSTYLES; s++)
+      {
+         if(s && wsGenerate(ctx[s], words, seed) != WS_OK)
+            continue;
+         bytes = 0;
+         start = Now();
+         wsRender(ctx[s], &sink);
+         render[s].seconds += Now() - start;
+         render[s].bytes   += bytes;
+      }
+   }
+
+   cells = (double)gridsize * gridsize;
+   fprintf(out, "%s\n    {\"grid\": %d, \"words\": %d, \"lengths\": \"%s\", ",
+           (first?"":","), gridsize, nwords, lengths->name);
+   fprintf(out, "\"puzzles\": %d,\n", npuzzles);
+   fprintf(out, "     \"puzzles_per_sec\": %.1f, \"success_rate\": %.4f, ",
+           npuzzles / genTime, (double)nfitted / npuzzles);
+   fprintf(out, "\"gave_up_rate\": %.4f,\n     ",
+           (double)ngaveup / npuzzles);
+   fprintf(out, "\"attempts_per_word\": %.3f, \"backtracks\": %.2f, ",
+           (nfitted ? attempts / ((double)nfitted * nwords) : 0.0),
+           (nfitted ? backtracks / nfitted : 0.0));
+   fprintf(out, "\"ns_per_cell\": %.2f,\n     \"render\": {",
+           genTime * 1.0e9 / cells / npuzzles);
+   for(s=0; s<NSTYLES; s++)
+   {
+      fprintf(out, "%s\"%s\": {\"bytes\": %.0f, \"ns_per_cell\": %.2f}",
+              (s?", ":""), names[s],
+              (nfitted ? render[s].bytes / nfitted : 0.0),
+              (nfitted ? render[s].seconds * 1.0e9 / cells / nfitted
+                       : 0.0));
+   }
+   fprintf(out, "}}");
+   fflush(out);
+
+   for(s=0; s<NSTYLES; s++)
+      wsDestroyContext(ctx[s]);
+   wsDestroyWordList(words);
+
+   return(TRUE);
+}
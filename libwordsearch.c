@@ -0,0 +1,7858 @@
+/*************************************************************************
+
+   Program:    WordSearch
+   File:       libwordsearch.c
+
+   Version:    V2.30
+   Date:       18.10.26
+   Function:   Build a WordSearch creating PostScript, PDF, LaTeX or
+               ASCII output
+
+   Copyright:  (c) SciTech Software 1994-2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    SciTech Software
+               23, Stag Leys,
+               Ashtead,
+               Surrey,
+               KT21 2TD.
+   Phone:      +44 (0)1372 275775
+   EMail:      andrew@andrew-martin.org
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Description:
+   ============
+   The puzzle generator and renderers from WordSearch.c as a reentrant
+   library. See wordsearch.h for the interface.
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V2.0  18.10.26 Split out of WordSearch.c V1.4. All state is held in
+                  a WSCONTEXT and output goes to a WSSINK   By: agent
+   V2.1  18.10.26 Grids are single row-major buffers and word lists
+                  are single arenas. Search state is kept in the context
+                  and reused between puzzles   By: agent
+   V2.2  18.10.26 Word fit tests use per-line bitboards   By: agent
+   V2.3  18.10.26 Built-in xoshiro256** generator replaces rand_r().
+                  Seeds are 64-bit. Added -seed and wsPuzzleSeed()   By: agent
+   V2.4  18.10.26 PostScript draws each row from a string with a prolog
+                  procedure. Output is collected in a large buffer   By: agent
+   V2.5  18.10.26 Word lists have no size limit. Files are mapped into
+                  memory or read in large blocks and words are views
+                  into those blocks. Long words are skipped, not cut
+                  By: agent
+   V2.6  18.10.26 Word lists may keep a reservoir sample of the words
+                  read, with length bounds and per-length quotas   By: agent
+   V2.7  18.10.26 Added the portfolio option which races several
+                  searches for each puzzle in separate threads   By: agent
+   V2.8  18.10.26 Counts the work done by each search. Added
+                  wsGetStats()   By: agent
+   V2.9  18.10.26 Counts rejected starts by direction and cause, tries
+                  for each word length and bytes rendered. Times each
+                  stage with the stats option. Added wsAddStats()   By: agent
+   V2.10 18.10.26 Added wsUpdateContext() and wsResetWordList() so that
+                  long-running programs can keep their memory between
+                  puzzles. Cleared word lists keep a text block   By: agent
+   V2.11 18.10.26 Large grids are split into tiles which are filled in
+                  parallel. SortByLength() is a merge sort   By: agent
+   V2.12 18.10.26 Added the Aho-Corasick solver and the verify option
+                  By: agent
+   V2.13 18.10.26 Added the unique option which fills blanks without
+                  making extra copies of words   By: agent
+   V2.14 18.10.26 Words may run in any of the eight directions, chosen
+                  with the dirs option. Directions are described by a
+                  table. Up-right diagonals have their own bitboards
+                  By: agent
+   V2.15 18.10.26 Added the cache option which keeps each puzzle in a
+                  content-addressed cache directory   By: agent
+   V2.16 18.10.26 Added books of many puzzles with a single prolog,
+                  numbered pages and an answer key   By: agent
+   V2.17 18.10.26 Added PDF output, with each page's content stream
+                  compressed by zlib as it is written   By: agent
+   V2.18 18.10.26 Added word indexes which hold a large lexicon bucketed
+                  by length with a bitmap of each letter, and sample
+                  words from it for each puzzle   By: agent
+   V2.19 18.10.26 Added the dense option which places words where they
+                  share the most letters, found with a pattern index of
+                  the words   By: agent
+   V2.20 18.10.26 Added -g auto which searches for the smallest grid the
+                  words fit in. A context may be given any grid size up
+                  to the one it was created with   By: agent
+   V2.21 18.10.26 Added -deadline, which limits the time spent placing
+                  the words, and -fallback, which says what to do with
+                  a puzzle whose time has run out   By: agent
+   V2.22 18.10.26 Added puzzle files, which keep puzzles compactly to be
+                  loaded into a context and rendered again later   By: agent
+   V2.23 18.10.26 The search has a budget of placements by default and
+                  tells a puzzle shown to be impossible (WS_NOFIT) from
+                  one it gave up on (WS_GAVEUP). Added -budget. Grid 
+                  sizes below 1 are rejected   By: agent
+   V2.24 18.10.26 A grid grown by the fallback goes back to its size for
+                  the next puzzle   By: agent
+   V2.25 18.10.26 The stats keep the sizes of the grids built. The
+                  smallest grid tried by -g auto allows for words
+                  crossing   By: agent
+   V2.26 18.10.26 The PostScript header gives WS_VERSION   By: agent
+   V2.27 18.10.26 A race is only given up when every search has given up
+                  By: agent
+   V2.28 18.10.26 Where each word is is kept as it is placed and written
+                  to puzzle files and the cache, rather than found again
+                  in the solution   By: agent
+   V2.29 18.10.26 Racers are set up in linear time. The portfolio is at
+                  most MAXPORTFOLIO   By: agent
+   V2.30 18.10.26 A word picked from an index is skipped unless its slot
+                  ends in a NUL   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#define _POSIX_C_SOURCE 200809L    /* For mmap() and fileno()           */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <zlib.h>
+
+#include "wordsearch.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define OUTBUFFSIZE 65536  /* Output is passed to the sink in blocks of
+                              up to this size                           */
+#define PSLINELEN     200  /* Longest PostScript string on one line     */
+#define READBLOCK   1048576 /* Block size for reading word lists        */
+#define WORDBLOCK     65536 /* Block size for words added one at a time */
+
+#define DIR_E         0    /* Placement directions, as the WS_DIR_ bits */
+#define DIR_S         1
+#define DIR_SE        2
+#define DIR_W         3
+#define DIR_N         4
+#define DIR_NW        5
+#define DIR_NE        6
+#define DIR_SW        7
+#define NDIRECTIONS   WS_NDIRECTIONS
+
+#define FAM_ROW       0    /* Families of lines the directions run along*/
+#define FAM_COL       1
+#define FAM_DIAG      2    /* Diagonals running down-right              */
+#define FAM_ANTI      3    /* Diagonals running up-right                */
+#define NFAMILIES     4
+
+/* Lines in all families: rows, columns and both sets of diagonals       */
+#define NLINES(gridsize) (6 * (gridsize) - 2)
+
+/* Cell (x,y) of a row-major grid whose rows are stride bytes apart      */
+#define CELL(grid, stride, x, y) (grid)[(size_t)(y)*(stride) + (x)]
+
+/* Grid offset of the first cell written by a search state's placement  */
+#define PLACEDCELL(state) ((state)->origin + \
+   (state)->starts[(state)->next - 1] * (state)->step)
+
+#define GOLDENGAMMA 0x9e3779b97f4a7c15ULL /* SplitMix64 increment       */
+
+#define RACE_RUNNING (-1)  /* Race winner values besides a racer number  */
+#define RACE_NOFIT   (-2)
+#define RACE_GAVEUP  (-3)
+
+#define BOARDBITS    64    /* Bits in each bitboard word                */
+#define EMPTYPLANE    0    /* Bitboard plane of blank cells             */
+
+#define SORTRUN      16    /* Runs insertion sorted before merging      */
+
+#define DENSETRIES   32    /* Dense placements tried before the search  */
+
+/* Pattern index bitset of the words with plane p at position i          */
+#define POSTING(ctx, i, p) ((ctx)->patterns + \
+   ((size_t)(i) * (ctx)->nplanes + (p)) * (ctx)->patternWords)
+
+#define TILETRIES     4    /* Seeds tried for each tile                 */
+#define TILEBUDGET(n) (64UL * (n) + 4096) /* Placements allowed in one
+                              try at a tile of n words                  */
+#define AUTOBUDGET(n) (64UL * (n) + 4096) /* Placements allowed when
+                              trying a grid size for n words            */
+#define FITBUDGET(n)  (BUDGETPERWORD * (n) + BUDGETBASE) /* Placements
+                              allowed by default for n words            */
+#define DEADLINECHECK 64    /* Search steps between looks at the clock  */
+#define GROWLIMIT(g)  ((g) + (g) / 2) /* Largest grid the grow fallback
+                              may make from one of g                    */
+#define TILE_NOFIT    1    /* Tiling failure values                     */
+#define TILE_NOMEMORY 2
+#define TILE_GAVEUP   3
+
+#define NSOLVEDIRS    8    /* Directions searched by the solver         */
+#define NFILLAXES     4    /* Lines through a cell checked in a fill    */
+#define NLETTERS     26    /* Letters used to fill blanks               */
+
+#define CACHEMAGIC   "WSC2" /* Start of a cache entry                   */
+#define CACHEVERSION  1    /* Changes whenever the same key would give a
+                              different puzzle                          */
+#define FNVOFFSET    0xcbf29ce484222325ULL /* FNV-1a hash constants     */
+#define FNVPRIME     0x100000001b3ULL
+#define MIXPRIME     0x9fb21c651e98df25ULL /* Second lane of the hash   */
+
+#define INDEXMAGIC   "WSI1" /* Start of a word index                    */
+#define PUZZLEMAGIC  "WSP1" /* Start of each puzzle in a puzzle file    */
+#define PUZZLEALIGN     8  /* Puzzles in a file start on this boundary  */
+#define NORANK       UINT64_MAX /* Empty slot in a set of ranks         */
+
+/* Words in each letter's bitmap of an index bucket of n words           */
+#define MAPWORDS(n)  (((size_t)(n) + BOARDBITS - 1) / BOARDBITS)
+
+#define PDFBLOCK     16384 /* Compressed output is passed on in blocks
+                              of this size                              */
+#define PDFLEVEL     Z_BEST_SPEED /* Grids compress well even at the
+                              fastest level, which takes a quarter of
+                              the time of the default for pages 20%
+                              larger                                    */
+#define PDFWIDTH     612   /* Page size in points, as the PostScript    */
+#define PDFHEIGHT    792
+#define PDFXSTART     72   /* Top left of the grid, as xstart and ystart*/
+#define PDFYSTART    720
+#define PDFWORDSEP   175   /* Spacing of the word list columns          */
+#define PDFLABELSIZE  10   /* Font size and height of page labels       */
+#define PDFLABELY     36
+#define PDFFIRSTPAGE   5   /* Object number of the first page. 1 is the
+                              catalog, 2 the page tree, 3 and 4 fonts   */
+#define PDFPAGEOBJS    3   /* Objects per page: the page, its content
+                              stream and the stream's length            */
+#define FIRSTPRINTABLE 32  /* Font width tables run from space to ~     */
+#define NPRINTABLE    95
+
+/* Font widths are in thousandths of the font size                       */
+#define CHARWIDTH(table, ch) \
+   (((unsigned char)(ch) >= FIRSTPRINTABLE &&                     \
+     (unsigned char)(ch) < FIRSTPRINTABLE + NPRINTABLE) ?         \
+    (table)[(unsigned char)(ch) - FIRSTPRINTABLE] : 0)
+
+/* Output is being compressed into a PDF content stream                  */
+#define DEFLATING(out) ((out)->pdf != NULL && (out)->pdf->deflating)
+
+/* The context has a deadline and it has passed                          */
+#define PASTDEADLINE(ctx) ((ctx)->deadline && ClockNs() >= (ctx)->deadline)
+
+/* Whether a grid is split into tiles                                    */
+#define TILED(options) (!(options)->autoGrid && (options)->tileSize > 0 \
+                        && (options)->gridSize >= 2 * (options)->tileSize)
+
+/************************************************************************/
+/* Type definitions
+*/
+typedef struct wsblock     /* A block of word list text                 */
+{
+   struct wsblock *next;
+   char           *data;
+   size_t         size,
+                  used;
+   BOOL           mapped;  /* data is a mapped file                     */
+}  WSBLOCK;
+
+typedef struct             /* One reservoir of a sampled word list      */
+{
+   uint64_t seen;          /* Words offered to this reservoir           */
+   int      start,         /* First slot                                */
+            size,          /* Number of slots                           */
+            count;         /* Slots filled                              */
+}  WSSTRATUM;
+
+typedef struct             /* xoshiro256** generator state              */
+{
+   uint64_t s[4];
+}  WSRNG;
+
+struct wswordlist          /* A word list, shared read-only by contexts */
+{
+   WSBLOCK   *blocks;      /* The text of the words                     */
+   char      **words;      /* Each word, in place in the blocks         */
+   int       *lengths,     /* and its length                            */
+             NWords,
+             maxWords,     /* Size of words[] and lengths[]             */
+             minWordLen,   /* Shorter words are skipped                 */
+             maxWordLen,   /* Longer words are skipped                  */
+             nSkipped;     /* Number of words skipped                   */
+   BOOL      sample;       /* Keep a sample rather than every word      */
+   char      *slots;       /* Sampled words, maxWordLen+1 bytes each    */
+   int       *slotWord;    /* Index in words[] of each slot             */
+   WSSTRATUM strata[WS_MAXQUOTA+1]; /* Reservoir of each quota length,
+                                       with the rest in strata[0]       */
+   WSRNG     rng;          /* Random numbers for sampling               */
+   const WSINDEX *index;   /* Puzzles also have words sampled from this */
+};
+
+typedef struct             /* Start of a word index. It is followed by a
+                              bucket for each length, then the bitmaps
+                              and then the text                         */
+{
+   char     magic[4];
+   uint32_t nbuckets;      /* Buckets of lengths 0 to nbuckets-1        */
+   uint64_t nwords,
+            size;          /* Of the whole file                         */
+}  INDEXHEADER;
+
+typedef struct             /* The words of one length in an index       */
+{
+   uint64_t text,          /* Offset of the words, in alphabetical order
+                              and each in length+1 bytes                */
+            bitmaps;       /* Offset of a bitmap for each letter of the
+                              words containing it                       */
+   uint32_t count,         /* Number of words                           */
+            spare;
+}  INDEXBUCKET;
+
+struct wsindex             /* A word index mapped into memory           */
+{
+   const char        *data;
+   size_t            size;
+   const INDEXBUCKET *buckets;
+   int               nbuckets;
+};
+
+typedef struct             /* Start of a puzzle in a puzzle file. It is
+                              followed by a PUZZLEWORD for each word, in
+                              the order of the word list, then the grid
+                              row by row with nothing between the rows,
+                              padded to PUZZLEALIGN bytes               */
+{
+   char     magic[4];      /* PUZZLEMAGIC                               */
+   uint32_t gridSize,
+            NWords,
+            spare;
+   uint64_t seed;          /* Seed the puzzle was built from            */
+}  PUZZLEHEADER;
+
+typedef struct             /* Where a word is in a puzzle's grid        */
+{
+   uint32_t start;         /* Cell of its first letter, y*gridSize+x    */
+   uint16_t length;
+   uint8_t  direction,     /* DIR_ value                                */
+            spare;
+}  PUZZLEWORD;
+
+struct wspuzzles           /* A puzzle file mapped into memory          */
+{
+   const char *data;
+   size_t     size,
+              *offsets;    /* Where each puzzle starts                  */
+   int        npuzzles,
+              maxGrid;     /* Largest grid of any of them               */
+};
+
+typedef struct             /* Backtracking state for one word           */
+{
+   int   a, b,             /* Affine permutation over all lines         */
+         nlines,           /* Number of lines in all directions         */
+         line,             /* Number of lines visited so far            */
+         *starts,          /* Valid start offsets on the current line   */
+         nstarts,
+         next,             /* Next entry in starts[] to try             */
+         direction,
+         origin,           /* Grid offset of the start of the line      */
+         step,             /* Grid offset between cells on the line     */
+         *filled,          /* Grid offsets set by the current placement */
+         nfilled;
+}  SEARCHSTATE;
+
+typedef struct             /* Where the search put a word               */
+{
+   int  cell,              /* Grid offset of the first cell written     */
+        step;              /* Grid offset between cells                 */
+   BOOL reversed;          /* The word was written backwards            */
+}  PLACEMENT;
+
+typedef struct             /* Where a word is in the finished grid      */
+{
+   int  x, y,              /* Cell of its first letter                  */
+        direction;         /* DIR_ value it reads along                 */
+}  WORDPLACE;
+
+typedef struct             /* Bitboard layout of one line               */
+{
+   size_t base;            /* Planes start at word base*nplanes         */
+   int    length,          /* Cells on the line                         */
+          nwords;          /* Words per plane, including padding        */
+}  BOARDLINE;
+
+typedef struct             /* One of the placement directions           */
+{
+   const char *name;       /* Compass point, for the dirs option        */
+   int        family;      /* Lines it runs along                       */
+   BOOL       reversed;    /* Runs against the order of its lines       */
+   int        dx, dy;      /* Step from each letter to the next         */
+}  DIRECTION;
+
+typedef struct             /* Searches racing to place the same words   */
+{
+   atomic_int winner,      /* Racer that finished first, RACE_RUNNING,
+                              RACE_NOFIT or RACE_GAVEUP                 */
+              running;     /* Searches that have not yet given up       */
+}  WSRACE;
+
+typedef struct wstiles     /* A grid being filled one tile at a time    */
+{
+   struct wscontext *ctx;  /* The context of the whole grid             */
+   char       **words;     /* The words of each tile in turn            */
+   WORDPLACE  *places;     /* and where each is in the grid             */
+   int        *start,      /* Index in words[] of each tile's first word,
+                              with an extra entry for the end           */
+              ntiles,
+              across,      /* Tiles along each side of the grid         */
+              size;        /* Cells along each side of a tile           */
+   uint64_t   seed;        /* Seed of the whole grid                    */
+   atomic_int next,        /* Next tile to be filled                    */
+              failed;      /* 0, TILE_NOFIT, TILE_GAVEUP or
+                              TILE_NOMEMORY                             */
+}  WSTILES;
+
+struct wssolver            /* An Aho-Corasick automaton over some words */
+{
+   int           *delta,   /* Next state from each state on each class  */
+                 *stateInts,/* The per-state arrays below               */
+                 *out,     /* Word ending at each state, or -1          */
+                 *fail,    /* State of the longest proper suffix        */
+                 *dict,    /* Next state along the fail chain with a
+                              word, or 0                                */
+                 *report,  /* The state itself if it has a word, else
+                              dict                                      */
+                 *queue,   /* Breadth first order while building        */
+                 *depth,   /* Length of each state's prefix             */
+                 *wordInts,/* The per-word arrays below                 */
+                 *length,
+                 *first,   /* First word in the list equal to each word */
+                 *count,   /* Occurrences of each first word            */
+                 *copies,  /* and the number of words equal to it       */
+                 *palindrome,
+                 NWords,
+                 maxWords, /* Size of the per-word arrays               */
+                 maxLength,/* Longest word                              */
+                 nstates,
+                 maxStates,/* Size of the per-state arrays              */
+                 nclasses, /* Characters in the words plus one for the
+                              rest                                      */
+                 nmatches,
+                 maxMatches;
+   size_t        maxDelta; /* Size of delta[]                           */
+   WSMATCH       *matches;
+   BOOL          record,   /* Keep matches[] as well as the counts      */
+                 sorted,   /* matches[] is in order                     */
+                 error;    /* Ran out of memory recording matches       */
+   unsigned char class[256];/* Class of each character                  */
+};
+
+typedef struct             /* A PDF document being written              */
+{
+   z_stream      z;        /* Compresses the current content stream     */
+   uint64_t      *offsets, /* Where each object starts, by number       */
+                 streamStart; /* Where the current stream's data starts */
+   int           maxObjects,/* Size of offsets[]                        */
+                 nobjects, /* Highest object number used                */
+                 pages;    /* Pages finished                            */
+   BOOL          deflating;/* Output is going into a content stream     */
+   unsigned char block[PDFBLOCK]; /* Compressed output                  */
+}  PDFDOC;
+
+struct wscontext           /* Everything needed to build one puzzle     */
+{
+   WSOPTIONS     options;
+   char          *cells,   /* The one allocation holding both grids     */
+                 *grid,    /* The character grid                        */
+                 *solution,/* The grid before FillSpaces()              */
+                 *outBuffer,/* Output buffer used by wsRender()         */
+                 **words,  /* Words in placement order                  */
+                 **sortWords,/* Scratch space for SortByLength()        */
+                 **bestWords,/* Word order of the best grid AutoGrid()
+                                has found                               */
+                 *bestGrid;/* and the grid                              */
+   WORDPLACE     *places,  /* Where each of words[] is in the grid      */
+                 *bestPlaces; /* and in AutoGrid()'s best grid          */
+   SEARCHSTATE   *state;   /* Search state for each word                */
+   BOARDLINE     *lines;   /* Bitboard layout of each line              */
+   uint64_t      *boards;  /* Bitboard planes of every line             */
+   size_t        lineWords,/* Words in one plane of all lines           */
+                 maxBoards;/* Size of boards[]                          */
+   int           *stateInts,/* The starts[] and filled[] arrays         */
+                 stride,   /* Bytes between grid rows                   */
+                 NWords,
+                 maxWords, /* Size of words[]                           */
+                 maxStates,/* Size of state[]                           */
+                 nplanes,  /* The blank plane and one per character     */
+                 maxGrid,  /* Grid size the memory is laid out for      */
+                 sizeLimit;/* Largest grid AutoGrid() may use           */
+   uint64_t      seed;     /* Seed of the last puzzle generated         */
+   WSRNG         rng,      /* Random numbers for placing words          */
+                 fillRng;  /* Random numbers for filling blanks         */
+   WSCONTEXT     **racers; /* Contexts for the other searches in a race */
+   pthread_t     *threads; /* and their threads                         */
+   int           nracers,
+                 racer;    /* This context's number in a race           */
+   WSRACE        *race;    /* The race this context is in, or NULL      */
+   WSCONTEXT     **tilers; /* Contexts for filling tiles                */
+   pthread_t     *tileThreads; /* and their threads                     */
+   int           ntilers;
+   WSTILES       *tiling;  /* The grid this context fills tiles of      */
+   unsigned long budget;   /* Placements allowed in FitWords(), 0 for
+                              no limit                                  */
+   uint64_t      deadline; /* ClockNs() time the search must stop by,
+                              0 for none                                */
+   PLACEMENT     *partial; /* The most words the search has placed      */
+   int           npartial, /* and how many                              */
+                 ndropped; /* Words left out by the fallback, which 
+                              follow the NWords in words[]              */
+   int           ndirs,    /* Directions in use                         */
+                 dirs[NDIRECTIONS], /* and their numbers                */
+                 dirBase[NDIRECTIONS],  /* First line of each one's
+                                           family                       */
+                 dirLines[NDIRECTIONS], /* and the number of lines      */
+                 nvisits,  /* Lines visited by a search, over all the
+                              directions in use                         */
+                 families; /* Bits of the line families in use          */
+   WSSOLVER      *solver;  /* Used by the verify option                 */
+   PDFDOC        *pdf;     /* Used by wsRender() for PDF output         */
+   WSWORDLIST    *picked;  /* Words of a list with an index and those
+                              sampled from it                           */
+   uint64_t      *patterns,/* Pattern index used by the dense option    */
+                 *live,    /* Words of the length being placed which are
+                              not yet placed                            */
+                 *match;   /* Scratch set of words matching a pattern   */
+   size_t        maxPatterns; /* Size of patterns[]                     */
+   int           *letters, /* Letters before each cell of a line        */
+                 maxLetters;  /* Size of letters[]                      */
+   int           patternWords, /* 64-bit words in each set of words     */
+                 patternLen;   /* Word positions in the index           */
+   char          *text;    /* Words of a puzzle from wsLoadPuzzle()     */
+   size_t        maxText;  /* Size of text[]                            */
+   WSSTATS       stats;    /* Work done by the last search              */
+   unsigned char plane[256];/* Bitboard plane of each character         */
+   BOOL          generated;
+};
+
+typedef struct             /* Header of a page held in a book's spool   */
+{
+   size_t length;          /* Bytes of the page that follow             */
+   int    page;            /* Page of the puzzle it is the solution to  */
+}  SPOOLPAGE;
+
+typedef struct             /* Start of a cache entry. It is followed by
+                              the index in the word list of each word in
+                              placement order (uint32_t), a PUZZLEWORD
+                              for each saying where it is, the grid row
+                              by row, a bit per cell set for the 
+                              solution and a uint64_t checksum of all 
+                              that came before                          */
+{
+   char     magic[4];      /* CACHEMAGIC                                */
+   uint32_t gridSize,
+            NWords;
+   uint64_t key[2];        /* The entry's key, as in its file name      */
+}  CACHEHEADER;
+
+typedef struct             /* A sink and whether it has failed          */
+{
+   WSSINK   *sink;
+   char     *buffer;       /* Output waiting to go to the sink          */
+   size_t   used,
+            size;
+   uint64_t written;       /* Output passed to the sink so far          */
+   PDFDOC   *pdf;          /* The PDF document being written, or NULL   */
+   BOOL     error;
+}  WSOUT;
+
+struct wsbook              /* A document of many puzzles                */
+{
+   int   style,
+         fontSize,
+         pages;            /* Pages written so far                      */
+   WSOUT out;
+   FILE  *spool;           /* Solution pages held for the answer key    */
+   BOOL  error;            /* The spool could not be written            */
+};
+
+/************************************************************************/
+/* Constant tables. These are the only data outside a context or a word
+   list, so the library still keeps no global state
+*/
+static const DIRECTION gDirections[NDIRECTIONS] =
+{  /* In the order of DIR_E ... DIR_SW                                   */
+   {"E",  FAM_ROW,  FALSE,  1,  0},
+   {"S",  FAM_COL,  FALSE,  0,  1},
+   {"SE", FAM_DIAG, FALSE,  1,  1},
+   {"W",  FAM_ROW,  TRUE,  -1,  0},
+   {"N",  FAM_COL,  TRUE,   0, -1},
+   {"NW", FAM_DIAG, TRUE,  -1, -1},
+   {"NE", FAM_ANTI, FALSE,  1, -1},
+   {"SW", FAM_ANTI, TRUE,  -1,  1}
+};
+
+/* Widths of the WinAnsiEncoding characters from space to ~ in the two
+   standard fonts used for PDF output
+*/
+static const short gHelvetica[NPRINTABLE] =
+{  278, 278, 355, 556, 556, 889, 667, 191, 333, 333, 389, 584, 278, 333,
+   278, 278, 556, 556, 556, 556, 556, 556, 556, 556, 556, 556, 278, 278,
+   584, 584, 584, 556,1015, 667, 667, 722, 722, 667, 611, 778, 722, 278,
+   500, 667, 556, 833, 722, 778, 667, 778, 722, 667, 611, 722, 667, 944,
+   667, 667, 611, 278, 278, 278, 469, 556, 333, 556, 556, 500, 556, 556,
+   278, 556, 556, 222, 222, 500, 222, 833, 556, 556, 556, 556, 333, 500,
+   278, 556, 500, 722, 500, 500, 500, 334, 260, 334, 584
+};
+
+static const short gHelveticaBold[NPRINTABLE] =
+{  278, 333, 474, 556, 556, 889, 722, 238, 333, 333, 389, 584, 278, 333,
+   278, 278, 556, 556, 556, 556, 556, 556, 556, 556, 556, 556, 333, 333,
+   584, 584, 584, 611, 975, 722, 722, 722, 722, 667, 611, 778, 722, 278,
+   556, 722, 611, 833, 722, 778, 667, 778, 722, 667, 611, 722, 667, 944,
+   667, 667, 611, 333, 278, 333, 584, 556, 333, 556, 611, 556, 611, 556,
+   333, 611, 611, 278, 278, 556, 278, 889, 611, 611, 611, 611, 389, 556,
+   333, 611, 556, 778, 556, 556, 500, 389, 280, 389, 584
+};
+
+/************************************************************************/
+/* Prototypes
+*/
+static WSBLOCK *NewBlock(WSWORDLIST *list, size_t size);
+static BOOL AddView(WSWORDLIST *list, char *word, int length);
+static BOOL InitSample(WSWORDLIST *list, const WSOPTIONS *options);
+static void SampleWord(WSWORDLIST *list, const char *word, int length);
+static void FreeBlock(WSWORDLIST *list, WSBLOCK *block);
+static BOOL ParseWords(WSWORDLIST *list, char *text, size_t length,
+                       BOOL final, size_t *used);
+static void Normalise(char *text, size_t length);
+static int  MapWordList(WSWORDLIST *list, FILE *fp);
+static BOOL StreamWordList(WSWORDLIST *list, FILE *fp);
+static BOOL ReserveWords(WSCONTEXT *ctx, int NWords, BOOL search);
+static BOOL ResizeGrid(WSCONTEXT *ctx, int gridsize);
+static BOOL BuildBoardLines(WSCONTEXT *ctx);
+static BOOL ReserveBoards(WSCONTEXT *ctx);
+static void ClearBoards(WSCONTEXT *ctx);
+static void SetBoardCell(WSCONTEXT *ctx, int offset, char ch, BOOL set);
+static void SetDirections(WSCONTEXT *ctx);
+static int  FamilyLines(int gridsize, int family, int *first);
+static int  VisitLine(WSCONTEXT *ctx, int visit, int *direction);
+static int  ValidStarts(WSCONTEXT *ctx, int line, const char *word,
+                        int len, BOOL reversed, int *starts);
+static int  LowestBit(uint64_t bits);
+static BOOL PrepareSearch(WSCONTEXT *ctx, char **words, int NWords,
+                          uint64_t seed, BOOL search);
+static int  PlaceTiles(WSCONTEXT *ctx, const WSWORDLIST *list,
+                       uint64_t seed);
+static BOOL ReserveTilers(WSCONTEXT *ctx, int ntilers, int size);
+static void *TileWorker(void *arg);
+static int  AutoGrid(WSCONTEXT *ctx, const WSWORDLIST *list, int NWords,
+                     uint64_t seed);
+static int  TryGrid(WSCONTEXT *ctx, const WSWORDLIST *list, int NWords,
+                    uint64_t seed, int gridsize);
+static int  RaceWords(WSCONTEXT *ctx, const WSWORDLIST *list,
+                      uint64_t seed);
+static BOOL ReserveRacers(WSCONTEXT *ctx, int nracers);
+static void *RaceWorker(void *arg);
+static void RacerGaveUp(WSRACE *race);
+static void ShuffleWords(WSCONTEXT *ctx);
+static int  FitWords(WSCONTEXT *ctx);
+static void KeepPlace(WSCONTEXT *ctx, int i, int len, int cell, int step,
+                      BOOL reversed);
+static void KeepPartial(WSCONTEXT *ctx, int depth);
+static int  DegradePuzzle(WSCONTEXT *ctx);
+static BOOL GrowGrid(WSCONTEXT *ctx);
+static BOOL ReservePatterns(WSCONTEXT *ctx);
+static void IndexPatterns(WSCONTEXT *ctx);
+static BOOL DenseWords(WSCONTEXT *ctx);
+static int  BestOverlap(WSCONTEXT *ctx, int len, int *word, int *start,
+                        int *step);
+static void FillSpaces(WSCONTEXT *ctx);
+static int  FillUnique(WSCONTEXT *ctx);
+static BOOL WordThrough(const WSSOLVER *solver, int state,
+                        const unsigned char *text, int length);
+static void SortByLength(char **Words, int NWords, char **scratch);
+static void SeedRandom(WSRNG *rng, uint64_t seed);
+static uint64_t SplitMix64(uint64_t *state);
+static uint64_t NextRandom(WSRNG *rng);
+static void JumpRandom(WSRNG *rng);
+static int  RandomNum(WSRNG *rng, int maxran);
+static uint64_t RandomBelow(WSRNG *rng, uint64_t n);
+static BOOL ParseQuota(WSOPTIONS *options, const char *value);
+static BOOL ParseDirections(WSOPTIONS *options, const char *value);
+static BOOL IsLongOption(const char *name, const char *option);
+static BOOL PlaceWord(WSCONTEXT *ctx, SEARCHSTATE *state, char *word);
+static void ResetSearch(WSCONTEXT *ctx, SEARCHSTATE *state);
+static int  GetLine(int gridsize, int index, int *direction, int *x0,
+                    int *y0, int *xstep, int *ystep);
+static void UndoWord(WSCONTEXT *ctx, SEARCHSTATE *state);
+static void PrintSolution(WSOUT *out, WSCONTEXT *ctx);
+static void PrintPuzzle(WSOUT *out, WSCONTEXT *ctx);
+static void InitOutput(WSOUT *out, int style, int fontsize, BOOL book);
+static void EndOutput(WSOUT *out, int style);
+static void NextPage(WSOUT *out, int style);
+static void StartPage(WSOUT *out, int style, int fontsize, int page);
+static void EndPage(WSOUT *out, int style, int page, int answerTo);
+static void OpenOutput(WSOUT *out, WSSINK *sink, char *buffer);
+static void DoPSOutput(WSOUT *out, char *grid, int gridsize, int stride,
+                       char **words, BOOL WordList, int NWords,
+                       BOOL solution, int fontsize);
+static void DoLaTeXOutput(WSOUT *out, char *grid, int gridsize,
+                          int stride, char **words, BOOL WordList,
+                          int NWords, BOOL solution);
+static void DoASCIIOutput(WSOUT *out, char *grid, int gridsize,
+                          int stride, char **words, BOOL WordList,
+                          int NWords, BOOL solution);
+static void OutPrintf(WSOUT *out, const char *format, ...);
+static void OutWrite(WSOUT *out, const char *text, size_t length);
+static void OutPSString(WSOUT *out, const char *text, int length);
+static void OutFlush(WSOUT *out);
+static PDFDOC *CreatePDF(void);
+static void FreePDF(PDFDOC *pdf);
+static void StartPDF(WSOUT *out);
+static void EndPDF(WSOUT *out);
+static void PDFObject(WSOUT *out, int number);
+static void StartPDFPage(WSOUT *out);
+static void EndPDFPage(WSOUT *out);
+static void PDFDeflate(WSOUT *out, int flush);
+static void PDFLabel(WSOUT *out, const char *label);
+static void DoPDFOutput(WSOUT *out, char *grid, int gridsize, int stride,
+                        char **words, BOOL WordList, int NWords,
+                        BOOL solution, int fontsize);
+static size_t FileWrite(void *handle, const char *buffer, size_t length);
+static BOOL BuildSolver(WSSOLVER *solver, char **words, int NWords);
+static void ScanLine(WSSOLVER *solver, const char *grid, int gridsize,
+                     int stride, int x0, int y0, int dx, int dy);
+static void AddMatch(WSSOLVER *solver, int word, int x, int y, int dx,
+                     int dy);
+static int  CompareMatches(const void *a, const void *b);
+static int  PrepareSolver(WSCONTEXT *ctx);
+static int  VerifyPuzzle(WSCONTEXT *ctx);
+static void CacheKey(WSCONTEXT *ctx, const WSWORDLIST *list, int NWords,
+                     uint64_t seed, uint64_t *key);
+static char *CachePath(const WSCONTEXT *ctx, const uint64_t *key,
+                       BOOL temporary);
+static size_t CacheSize(int gridsize, int NWords);
+static BOOL LoadPuzzle(WSCONTEXT *ctx, const WSWORDLIST *list, 
+                       int NWords, uint64_t seed, const uint64_t *key);
+static BOOL StorePuzzle(WSCONTEXT *ctx, const WSWORDLIST *list,
+                        const uint64_t *key);
+static void HashBytes(uint64_t *hash, const void *data, size_t length);
+static int  CompareWordRefs(const void *a, const void *b);
+static BOOL ParseLetters(uint32_t *letters, const char *value);
+static size_t PuzzleSize(int gridsize, int NWords);
+static void MakeRecords(const WSCONTEXT *ctx, PUZZLEWORD *records);
+static BOOL RecordInGrid(const PUZZLEWORD *record, int gridsize);
+static BOOL ValidPuzzle(const char *data, size_t size);
+static int  PickWords(WSCONTEXT *ctx, const WSWORDLIST *list,
+                      uint64_t seed);
+static int  SampleBuckets(const WSINDEX *index, WSWORDLIST *list,
+                          const WSOPTIONS *options, int first, int last,
+                          BOOL pooled, int want, WSRNG *rng);
+static int  AddPicked(WSWORDLIST *list, const char *word, int length);
+static int  LetterMaps(const WSINDEX *index, int length, 
+                       uint32_t letters, const uint64_t **maps);
+static uint64_t MatchBits(const INDEXBUCKET *bucket, 
+                          const uint64_t **maps, int nwith, int nmaps,
+                          size_t word);
+static uint64_t *ChooseRanks(uint64_t n, int k, WSRNG *rng);
+static BOOL AddRank(uint64_t *set, size_t size, uint64_t rank);
+static int  CompareRanks(const void *a, const void *b);
+static int  CompareIndexWords(const void *a, const void *b);
+static int  CountBits(uint64_t bits);
+static uint64_t ClockNs(void);
+static int  StatLength(int length);
+
+/************************************************************************/
+/*>void wsDefaultOptions(WSOPTIONS *options)
+   -----------------------------------------
+   Set the options to their defaults
+
+   13.01.94 Original    By: ACRM (as part of Initialise())
+   18.10.26 Modified    By: agent
+            Split out
+*/
+void wsDefaultOptions(WSOPTIONS *options)
+{
+   options->solution   = FALSE;
+   options->wordList   = TRUE;
+   options->maxWords   = MAXWORDS;
+   options->maxWordLen = MAXWORDLEN;
+   options->gridSize   = GRIDSIZE;
+   options->style      = STYLE_PS;
+   options->fontSize   = FONTSIZE;
+   options->nPuzzles   = NPUZZLES;
+   options->nThreads   = NTHREADS;
+   options->seed       = 0;
+   options->sample     = FALSE;
+   options->minWordLen = 1;
+   memset(options->quota, 0, sizeof(options->quota));
+   options->portfolio  = 1;
+   options->stats      = FALSE;
+   options->statsFile  = NULL;
+   options->server     = NULL;
+   options->tileSize   = TILESIZE;
+   options->directions = WS_DIRECTIONS;
+   options->verify     = FALSE;
+   options->unique     = FALSE;
+   options->solve      = NULL;
+   options->cache      = NULL;
+   options->book       = FALSE;
+   options->index      = NULL;
+   options->makeIndex  = NULL;
+   options->withLetters    = 0;
+   options->withoutLetters = 0;
+   options->dense      = FALSE;
+   options->autoGrid   = FALSE;
+   options->deadlineMs = 0;
+   options->fallback   = WS_FALLBACK_NONE;
+   options->save       = NULL;
+   options->render     = FALSE;
+   options->budget     = 0;
+}
+
+/************************************************************************/
+/*>int wsSetOption(WSOPTIONS *options, const char *name,
+                   const char *value, BOOL *usedValue)
+   --------------------------------------------------------
+   Input:   const char *name      The switch, e.g. "-g"
+            const char *value     The following argument (or NULL)
+   Output:  BOOL       *usedValue Set if value was taken by the switch
+   I/O:     WSOPTIONS  *options   The options to update
+   Returns: int                   WS_OK, WS_BADOPTION, WS_NOVALUE,
+                                  WS_BADVALUE or WS_HELP
+
+   Apply a single command line switch. Every program built on the
+   library shares these switch meanings. Long switches are checked
+   first as they may start with the same letter as a short one.
+
+   13.01.94 Original    By: ACRM (as part of ReadCmdLine())
+   14.01.94 Added p,l,a,f and n switches
+   18.10.26 Modified    By: agent
+            Added b and j switches
+            Split out of ReadCmdLine()
+            Added -seed
+            Added -sample, -minlen and -quota
+            Added -portfolio
+            Added -stats
+            Added -server
+            Added -tile
+            Added -verify and -solve
+            Added -unique
+            Added -pdf
+            Added -index, -mkindex, -with and -without
+            Added -dense
+            Added -g auto
+            Added -deadline and -fallback
+            Added -save and -render
+            Added -budget. Rejects grid sizes below 1
+            The portfolio is at most MAXPORTFOLIO
+*/
+int wsSetOption(WSOPTIONS *options, const char *name, const char *value,
+                BOOL *usedValue)
+{
+   int *target = NULL;
+
+   *usedValue = FALSE;
+   if(name[0] != '-')
+      return(WS_BADOPTION);
+
+   if(IsLongOption(name, "seed"))
+   {
+      if(value == NULL)
+         return(WS_NOVALUE);
+      options->seed = (uint64_t)strtoull(value, NULL, 0);
+      *usedValue    = TRUE;
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "sample"))
+   {
+      options->sample = TRUE;
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "minlen"))
+   {
+      if(value == NULL)
+         return(WS_NOVALUE);
+      sscanf(value,"%d",&(options->minWordLen));
+      *usedValue = TRUE;
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "portfolio"))
+   {
+      if(value == NULL)
+         return(WS_NOVALUE);
+      sscanf(value,"%d",&(options->portfolio));
+      if(options->portfolio < 1)
+         options->portfolio = 1;
+      if(options->portfolio > MAXPORTFOLIO)
+         options->portfolio = MAXPORTFOLIO;
+      *usedValue = TRUE;
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "stats"))
+   {
+      if(value == NULL)
+         return(WS_NOVALUE);
+      options->stats     = TRUE;
+      options->statsFile = value;
+      *usedValue         = TRUE;
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "server"))
+   {
+      if(value == NULL)
+         return(WS_NOVALUE);
+      options->server = value;
+      *usedValue      = TRUE;
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "tile"))
+   {
+      if(value == NULL)
+         return(WS_NOVALUE);
+      sscanf(value,"%d",&(options->tileSize));
+      if(options->tileSize < 0)
+         options->tileSize = 0;
+      *usedValue = TRUE;
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "verify"))
+   {
+      options->verify = TRUE;
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "dirs"))
+   {
+      if(value == NULL)
+         return(WS_NOVALUE);
+      *usedValue = TRUE;
+      return(ParseDirections(options, value) ? WS_OK : WS_BADVALUE);
+   }
+   if(IsLongOption(name, "unique"))
+   {
+      options->unique = TRUE;
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "dense"))
+   {
+      options->dense = TRUE;
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "pdf"))
+   {
+      options->style = STYLE_PDF;
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "book"))
+   {
+      options->book = TRUE;
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "cache"))
+   {
+      if(value == NULL)
+         return(WS_NOVALUE);
+      options->cache = value;
+      *usedValue     = TRUE;
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "index"))
+   {
+      if(value == NULL)
+         return(WS_NOVALUE);
+      options->index = value;
+      *usedValue     = TRUE;
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "mkindex"))
+   {
+      if(value == NULL)
+         return(WS_NOVALUE);
+      options->makeIndex = value;
+      *usedValue         = TRUE;
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "with") || IsLongOption(name, "without"))
+   {
+      if(value == NULL)
+         return(WS_NOVALUE);
+      *usedValue = TRUE;
+      return(ParseLetters(IsLongOption(name, "with") ? 
+                          &(options->withLetters) :
+                          &(options->withoutLetters), value) ? 
+             WS_OK : WS_BADVALUE);
+   }
+   if(IsLongOption(name, "deadline") || IsLongOption(name, "deadline-ms"))
+   {
+      if(value == NULL)
+         return(WS_NOVALUE);
+      *usedValue = TRUE;
+      if(sscanf(value,"%d",&(options->deadlineMs)) != 1 ||
+         options->deadlineMs < 0)
+         return(WS_BADVALUE);
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "fallback"))
+   {
+      if(value == NULL)
+         return(WS_NOVALUE);
+      *usedValue = TRUE;
+      if(!strcmp(value, "none"))
+         options->fallback = WS_FALLBACK_NONE;
+      else if(!strcmp(value, "partial"))
+         options->fallback = WS_FALLBACK_PARTIAL;
+      else if(!strcmp(value, "drop"))
+         options->fallback = WS_FALLBACK_DROP;
+      else if(!strcmp(value, "grow"))
+         options->fallback = WS_FALLBACK_GROW;
+      else
+         return(WS_BADVALUE);
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "budget"))
+   {
+      if(value == NULL)
+         return(WS_NOVALUE);
+      *usedValue = TRUE;
+      if(sscanf(value,"%lu",&(options->budget)) != 1)
+         return(WS_BADVALUE);
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "save"))
+   {
+      if(value == NULL)
+         return(WS_NOVALUE);
+      options->save = value;
+      *usedValue    = TRUE;
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "render"))
+   {
+      options->render = TRUE;
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "solve"))
+   {
+      if(value == NULL)
+         return(WS_NOVALUE);
+      options->solve = value;
+      *usedValue     = TRUE;
+      return(WS_OK);
+   }
+   if(IsLongOption(name, "quota"))
+   {
+      if(value == NULL)
+         return(WS_NOVALUE);
+      *usedValue = TRUE;
+      return(ParseQuota(options, value) ? WS_OK : WS_BADVALUE);
+   }
+
+   if((name[1] == 'g' || name[1] == 'G') && name[2] == '\0' &&
+      value != NULL && !strcmp(value, "auto"))
+   {
+      options->autoGrid = TRUE;
+      options->gridSize = MAXAUTOGRID;
+      *usedValue        = TRUE;
+      return(WS_OK);
+   }
+
+   switch(name[1])
+   {
+   case 'w': case 'W':
+      target = &(options->maxWords);
+      break;
+   case 'm': case 'M':
+      target = &(options->maxWordLen);
+      break;
+   case 'g': case 'G':
+      target = &(options->gridSize);
+      options->autoGrid = FALSE;
+      break;
+   case 'f': case 'F':
+      target = &(options->fontSize);
+      break;
+   case 'b': case 'B':
+      target = &(options->nPuzzles);
+      break;
+   case 'j': case 'J':
+      target = &(options->nThreads);
+      break;
+   case 's': case 'S':
+      options->solution = TRUE;
+      return(WS_OK);
+   case '?': case 'h': case 'H':
+      return(WS_HELP);
+   case 'n': case 'N':
+      options->wordList = FALSE;
+      return(WS_OK);
+   case 'p': case 'P':
+      options->style = STYLE_PS;
+      return(WS_OK);
+   case 'l': case 'L':
+      options->style = STYLE_LATEX;
+      return(WS_OK);
+   case 'a': case 'A':
+      options->style = STYLE_ASCII;
+      return(WS_OK);
+   default:
+      return(WS_BADOPTION);
+   }
+
+   /* The remaining switches all take a number                          */
+   if(value == NULL)
+      return(WS_NOVALUE);
+   sscanf(value,"%d",target);
+   *usedValue = TRUE;
+
+   /* A grid with no cells has no lines to search                       */
+   if(options->gridSize < 1)
+      return(WS_BADVALUE);
+
+   if(options->fontSize < 1 || options->fontSize > 48)
+      options->fontSize = FONTSIZE;
+   if(options->nPuzzles < 1)
+      options->nPuzzles = 1;
+
+   return(WS_OK);
+}
+
+/************************************************************************/
+/*>WSWORDLIST *wsCreateWordList(const WSOPTIONS *options)
+   ------------------------------------------------------
+   Create an empty word list. Words shorter than options->minWordLen or
+   longer than options->maxWordLen are skipped. Normally the list grows
+   as words are added, but with options->sample it keeps a uniform
+   random sample of options->maxWords of them, drawn from
+   options->seed. Returns NULL if memory allocation failed.
+
+   13.01.94 Original    By: ACRM (as part of BuildArrays())
+   18.10.26 Modified    By: agent
+            Split out
+            Words are stored in one arena
+            No limit on the number of words
+            Added sampling and the minimum length
+*/
+WSWORDLIST *wsCreateWordList(const WSOPTIONS *options)
+{
+   WSWORDLIST *list;
+
+   if((list = (WSWORDLIST *)calloc(1, sizeof(WSWORDLIST)))==NULL)
+      return(NULL);
+
+   list->minWordLen = options->minWordLen;
+   list->maxWordLen = options->maxWordLen;
+
+   if(options->sample && !InitSample(list, options))
+   {
+      wsDestroyWordList(list);
+      return(NULL);
+   }
+
+   return(list);
+}
+
+/************************************************************************/
+/*>void wsClearWordList(WSWORDLIST *list)
+   --------------------------------------
+   Empty a word list so that it may be reused. The word text is freed
+   but the arrays of words are kept. A sampled list starts a new sample.
+   The first allocated text block is kept for words added afterwards
+   unless it is a mapped file.
+
+   18.10.26 Original    By: agent
+            Frees the text blocks
+            Keeps one allocated block
+*/
+void wsClearWordList(WSWORDLIST *list)
+{
+   int i;
+
+   while(list->blocks != NULL && 
+         (list->blocks->next != NULL || list->blocks->mapped))
+      FreeBlock(list, list->blocks);
+   if(list->blocks != NULL)
+      list->blocks->used = 0;
+
+   for(i=0; i<=WS_MAXQUOTA; i++)
+   {
+      list->strata[i].seen  = 0;
+      list->strata[i].count = 0;
+   }
+
+   list->NWords   = 0;
+   list->nSkipped = 0;
+}
+
+/************************************************************************/
+/*>BOOL wsAddWord(WSWORDLIST *list, const char *word)
+   --------------------------------------------------
+   Add a word to the list, converting to upper case. Returns FALSE if
+   the word is outside the length limits, and so was skipped, or if
+   memory allocation failed. A sampled list may or may not keep the
+   word.
+
+   18.10.26 Original    By: agent
+            Skips rather than truncates long words
+*/
+BOOL wsAddWord(WSWORDLIST *list, const char *word)
+{
+   WSBLOCK *block = list->blocks;
+   size_t  length = strlen(word);
+   char    *copy;
+
+   if(length > (size_t)list->maxWordLen || 
+      length < (size_t)list->minWordLen)
+   {
+      list->nSkipped++;
+      return(FALSE);
+   }
+
+   if(block == NULL || block->mapped || 
+      block->used + length + 1 > block->size)
+   {
+      if((block = NewBlock(list, (length < WORDBLOCK) ? WORDBLOCK :
+                                 length + 1))==NULL)
+         return(FALSE);
+   }
+
+   copy = block->data + block->used;
+   memcpy(copy, word, length + 1);
+   Normalise(copy, length);
+
+   /* A sample keeps its own copy so the space may be used again        */
+   if(!list->sample)
+      block->used += length + 1;
+
+   return(AddView(list, copy, (int)length));
+}
+
+/************************************************************************/
+/*>int wsReadWordList(WSWORDLIST *list, FILE *fp)
+   ----------------------------------------------
+   Read words from a file, one per line, to the end of the file. Words
+   are converted to upper case and leading and trailing white space is
+   removed. Blank lines and words longer than the maximum word length
+   are skipped. Returns the number of words in the list or -1 if memory
+   allocation failed.
+
+   A regular file is mapped into memory and the words are left where
+   they are in the mapping. Anything else is read in large blocks. A
+   sampled list copies the words it keeps and frees the text as it
+   goes, so it needs memory only for the sample.
+
+   13.01.94 Original    By: ACRM (as ReadInputData())
+   14.01.94 Terminates word in word list
+   18.10.26 Modified    By: agent
+            Reads into a WSWORDLIST
+            Maps or streams the file and reads to the end
+*/
+int wsReadWordList(WSWORDLIST *list, FILE *fp)
+{
+   int status = MapWordList(list, fp);
+
+   if(status == 0 && !StreamWordList(list, fp))
+      status = -1;
+
+   if(list->sample)
+   {
+      while(list->blocks != NULL)
+         FreeBlock(list, list->blocks);
+   }
+
+   return((status < 0) ? -1 : list->NWords);
+}
+
+/************************************************************************/
+/*>BOOL wsResetWordList(WSWORDLIST *list, const WSOPTIONS *options)
+   ----------------------------------------------------------------
+   Empty a word list as wsClearWordList() does and apply new options, as
+   though it had just been made by wsCreateWordList(). Returns FALSE if
+   memory allocation failed.
+
+   18.10.26 Original    By: agent
+            Drops the index
+*/
+BOOL wsResetWordList(WSWORDLIST *list, const WSOPTIONS *options)
+{
+   wsClearWordList(list);
+   list->minWordLen = options->minWordLen;
+   list->maxWordLen = options->maxWordLen;
+   list->index      = NULL;
+
+   if(list->sample)
+   {
+      /* The sample's arrays are sized for its old options              */
+      free(list->words);
+      free(list->lengths);
+      free(list->slots);
+      free(list->slotWord);
+      list->words    = NULL;
+      list->lengths  = NULL;
+      list->slots    = NULL;
+      list->slotWord = NULL;
+      list->maxWords = 0;
+      list->sample   = FALSE;
+      memset(list->strata, 0, sizeof(list->strata));
+   }
+
+   if(options->sample)
+      return(InitSample(list, options));
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>int wsWordCount(const WSWORDLIST *list)
+   ---------------------------------------
+   Returns the number of words in a word list
+
+   18.10.26 Original    By: agent
+*/
+int wsWordCount(const WSWORDLIST *list)
+{
+   return(list->NWords);
+}
+
+/************************************************************************/
+/*>int wsSkippedWords(const WSWORDLIST *list)
+   ------------------------------------------
+   Returns the number of words skipped as outside the length limits
+
+   18.10.26 Original    By: agent
+*/
+int wsSkippedWords(const WSWORDLIST *list)
+{
+   return(list->nSkipped);
+}
+
+/************************************************************************/
+/*>const char *wsGetWord(const WSWORDLIST *list, int index)
+   --------------------------------------------------------
+   Returns a word from a list, or NULL if index is out of range
+
+   18.10.26 Original    By: agent
+*/
+const char *wsGetWord(const WSWORDLIST *list, int index)
+{
+   if(index < 0 || index >= list->NWords)
+      return(NULL);
+   return(list->words[index]);
+}
+
+/************************************************************************/
+/*>void wsDestroyWordList(WSWORDLIST *list)
+   ----------------------------------------
+   Free a word list
+
+   18.10.26 Original    By: agent
+*/
+void wsDestroyWordList(WSWORDLIST *list)
+{
+   if(list == NULL)
+      return;
+
+   while(list->blocks != NULL)
+      FreeBlock(list, list->blocks);
+   free(list->words);
+   free(list->lengths);
+   free(list->slots);
+   free(list->slotWord);
+   free(list);
+}
+
+/************************************************************************/
+/*>int wsWriteIndex(const WSWORDLIST *list, FILE *fp)
+   --------------------------------------------------
+   Write the words of a list to a file as a word index which may be
+   opened with wsOpenIndex(). The words are put in a bucket for each
+   length, in alphabetical order and with repeats dropped, and each
+   bucket has a bitmap for each letter of the words that contain it.
+   The text comes last with each word in a slot of its length plus its
+   terminator so that a word is found from its number alone. Returns
+   WS_OK, WS_NOMEMORY or WS_WRITEERROR.
+
+   18.10.26 Original    By: agent
+*/
+int wsWriteIndex(const WSWORDLIST *list, FILE *fp)
+{
+   INDEXHEADER header;
+   INDEXBUCKET *buckets;
+   char        **words;
+   uint64_t    *maps     = NULL,
+               offset;
+   size_t      nmap,
+               maxMap    = 0;
+   int         i, j, k,
+               n         = 0,
+               first     = 0,
+               longest   = 0,
+               nbuckets;
+   const char  *ch;
+
+   if((words = (char **)malloc((list->NWords ? list->NWords : 1) *
+                               sizeof(char *)))==NULL)
+      return(WS_NOMEMORY);
+   if(list->NWords)
+      memcpy(words, list->words, list->NWords * sizeof(char *));
+   qsort(words, list->NWords, sizeof(char *), CompareIndexWords);
+
+   for(i=0; i<list->NWords; i++)
+   {
+      if(n == 0 || strcmp(words[i], words[n-1]))
+         words[n++] = words[i];
+      if((int)strlen(words[i]) > longest)
+         longest = (int)strlen(words[i]);
+   }
+
+   nbuckets = longest + 1;
+   if((buckets = (INDEXBUCKET *)calloc(nbuckets, sizeof(INDEXBUCKET)))
+      ==NULL)
+   {
+      free(words);
+      return(WS_NOMEMORY);
+   }
+   for(i=0; i<n; i++)
+      buckets[strlen(words[i])].count++;
+
+   offset = sizeof(INDEXHEADER) + nbuckets * sizeof(INDEXBUCKET);
+   for(j=0; j<nbuckets; j++)
+   {
+      buckets[j].bitmaps = offset;
+      offset += NLETTERS * MAPWORDS(buckets[j].count) * sizeof(uint64_t);
+   }
+   for(j=0; j<nbuckets; j++)
+   {
+      buckets[j].text = offset;
+      offset += (uint64_t)buckets[j].count * (j + 1);
+   }
+
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, INDEXMAGIC, sizeof(header.magic));
+   header.nbuckets = (uint32_t)nbuckets;
+   header.nwords   = (uint64_t)n;
+   header.size     = offset;
+   fwrite(&header, sizeof(header), 1, fp);
+   fwrite(buckets, sizeof(INDEXBUCKET), nbuckets, fp);
+
+   /* The words of each length follow on from the last                  */
+   for(j=0; j<nbuckets; j++)
+   {
+      if((nmap = MAPWORDS(buckets[j].count)) == 0)
+         continue;
+      if(NLETTERS * nmap > maxMap)
+      {
+         free(maps);
+         maxMap = NLETTERS * nmap;
+         if((maps = (uint64_t *)malloc(maxMap * sizeof(uint64_t)))==NULL)
+         {
+            free(buckets);
+            free(words);
+            return(WS_NOMEMORY);
+         }
+      }
+      memset(maps, 0, NLETTERS * nmap * sizeof(uint64_t));
+
+      for(k=0; k<(int)buckets[j].count; k++)
+      {
+         for(ch=words[first+k]; *ch; ch++)
+         {
+            if(*ch >= 'A' && *ch <= 'Z')
+               maps[(*ch - 'A') * nmap + k / BOARDBITS] |= 
+                  (uint64_t)1 << (k % BOARDBITS);
+         }
+      }
+      fwrite(maps, sizeof(uint64_t), NLETTERS * nmap, fp);
+      first += buckets[j].count;
+   }
+
+   for(i=0; i<n; i++)
+      fwrite(words[i], 1, strlen(words[i]) + 1, fp);
+
+   free(maps);
+   free(buckets);
+   free(words);
+
+   return((fflush(fp) || ferror(fp)) ? WS_WRITEERROR : WS_OK);
+}
+
+/************************************************************************/
+/*>WSINDEX *wsOpenIndex(FILE *fp)
+   ------------------------------
+   Map a word index written by wsWriteIndex() into memory. The file may
+   be closed afterwards. The layout is checked so that nothing outside
+   the mapping is ever read, but the words themselves are not, which
+   would mean reading the whole file; AddPicked() checks each word as it
+   is picked instead. Returns NULL if the file is not a word index or
+   memory allocation failed.
+
+   18.10.26 Original    By: agent
+*/
+WSINDEX *wsOpenIndex(FILE *fp)
+{
+   struct stat       st;
+   WSINDEX           *index;
+   const INDEXHEADER *header;
+   const INDEXBUCKET *bucket;
+   size_t            size;
+   char              *data;
+   int               j;
+   BOOL              valid;
+
+   if(fstat(fileno(fp), &st) || !S_ISREG(st.st_mode) ||
+      (size_t)st.st_size < sizeof(INDEXHEADER))
+      return(NULL);
+   size = (size_t)st.st_size;
+
+   data = (char *)mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(fp), 0);
+   if(data == MAP_FAILED)
+      return(NULL);
+
+   header = (const INDEXHEADER *)data;
+   valid  = !memcmp(header->magic, INDEXMAGIC, sizeof(header->magic)) &&
+            header->size == (uint64_t)size &&
+            header->nbuckets > 0 &&
+            header->nbuckets <= (size - sizeof(INDEXHEADER)) /
+                                sizeof(INDEXBUCKET);
+
+   bucket = (const INDEXBUCKET *)(data + sizeof(INDEXHEADER));
+   for(j=0; valid && j<(int)header->nbuckets; j++, bucket++)
+   {
+      valid = (bucket->bitmaps % sizeof(uint64_t)) == 0 &&
+              bucket->bitmaps <= size &&
+              NLETTERS * MAPWORDS(bucket->count) <= 
+                 (size - bucket->bitmaps) / sizeof(uint64_t) &&
+              bucket->text <= size &&
+              bucket->count <= (size - bucket->text) / (j + 1);
+   }
+
+   if(!valid || (index = (WSINDEX *)malloc(sizeof(WSINDEX)))==NULL)
+   {
+      munmap(data, size);
+      return(NULL);
+   }
+
+   index->data     = data;
+   index->size     = size;
+   index->buckets  = (const INDEXBUCKET *)(data + sizeof(INDEXHEADER));
+   index->nbuckets = (int)header->nbuckets;
+
+   return(index);
+}
+
+/************************************************************************/
+/*>void wsSetIndex(WSWORDLIST *list, const WSINDEX *index)
+   --------------------------------------------------------
+   Give a word list an index, or none if index is NULL. wsGenerate()
+   then makes each puzzle from the list's words and words sampled from
+   the index. The index must stay open while the list is in use.
+
+   18.10.26 Original    By: agent
+*/
+void wsSetIndex(WSWORDLIST *list, const WSINDEX *index)
+{
+   list->index = index;
+}
+
+/************************************************************************/
+/*>int wsSampleIndex(const WSINDEX *index, WSWORDLIST *list,
+                     const WSOPTIONS *options, uint64_t seed)
+   ----------------------------------------------------------
+   Add words picked at random from an index to a list until it has
+   options->maxWords words, or as many as match. Words must be within
+   the length limits and have all of options->withLetters and none of
+   options->withoutLetters. As for a sampled list, each length with a
+   quota has that many words picked from it alone and the rest are
+   picked from the other lengths together. Words already in the list
+   are not picked again, so a few less may be added. The same seed
+   always picks the same words, in order of length and then
+   alphabetically.
+
+   The words are found from the bitmaps, never from the text, and are
+   added as views into the index so nothing is copied. Returns the
+   number of words in the list or -1 if memory allocation failed.
+
+   18.10.26 Original    By: agent
+*/
+int wsSampleIndex(const WSINDEX *index, WSWORDLIST *list,
+                  const WSOPTIONS *options, uint64_t seed)
+{
+   WSRNG rng;
+   int   length, got,
+         want  = options->maxWords - list->NWords,
+         first = (options->minWordLen > 1) ? options->minWordLen : 1,
+         last  = (options->maxWordLen < index->nbuckets - 1) ?
+                 options->maxWordLen : index->nbuckets - 1;
+
+   /* A stream well away from those placing words and filling blanks    */
+   SeedRandom(&rng, seed);
+   JumpRandom(&rng);
+   JumpRandom(&rng);
+
+   for(length=first; length<=last && length<=WS_MAXQUOTA; length++)
+   {
+      if(want > 0 && options->quota[length] > 0)
+      {
+         got = SampleBuckets(index, list, options, length, length, FALSE,
+                             (options->quota[length] < want) ?
+                             options->quota[length] : want, &rng);
+         if(got < 0)
+            return(-1);
+         want -= got;
+      }
+   }
+
+   if(want > 0 && first <= last &&
+      SampleBuckets(index, list, options, first, last, TRUE, want, 
+                    &rng) < 0)
+      return(-1);
+
+   return(list->NWords);
+}
+
+/************************************************************************/
+/*>void wsCloseIndex(WSINDEX *index)
+   ---------------------------------
+   Unmap a word index
+
+   18.10.26 Original    By: agent
+*/
+void wsCloseIndex(WSINDEX *index)
+{
+   if(index == NULL)
+      return;
+
+   munmap((void *)index->data, index->size);
+   free(index);
+}
+
+/************************************************************************/
+/*>WSCONTEXT *wsCreateContext(const WSOPTIONS *options)
+   ----------------------------------------------------
+   Create a context for building puzzles with the given options and
+   assign memory for its grids. Both grids are row-major in a single
+   buffer with each row terminated so it may be printed as a string.
+   The memory is laid out for options->gridSize, which is the largest
+   grid the context may be given later, or for GROWLIMIT() of it if the
+   grow fallback may be needed. Returns NULL if memory allocation
+   failed.
+
+   13.01.94 Original    By: ACRM (as BuildArrays())
+   18.10.26 Modified    By: agent
+            Builds a WSCONTEXT
+            Grids are a single allocation
+            Lays out the bitboard lines
+            Allocates the output buffer
+            No search state for a tiled grid
+            Grids are set up by ResizeGrid()
+            Room to grow with the grow fallback
+            Rejects grid sizes below 1
+*/
+WSCONTEXT *wsCreateContext(const WSOPTIONS *options)
+{
+   WSCONTEXT *ctx;
+
+   if(options->gridSize < 1)
+      return(NULL);
+   if((ctx = (WSCONTEXT *)calloc(1, sizeof(WSCONTEXT)))==NULL)
+      return(NULL);
+
+   ctx->options   = *options;
+   ctx->maxGrid   = options->gridSize;
+   ctx->sizeLimit = options->gridSize;
+   if(options->deadlineMs > 0 && options->fallback == WS_FALLBACK_GROW &&
+      !TILED(options))
+      ctx->maxGrid = GROWLIMIT(options->gridSize);
+
+   if((ctx->cells = (char *)malloc(2 * (size_t)ctx->maxGrid *
+                                   (ctx->maxGrid + 1)))==NULL ||
+      (ctx->outBuffer = (char *)malloc(OUTBUFFSIZE))==NULL ||
+      !ReserveWords(ctx, options->maxWords, !TILED(options)) ||
+      !ResizeGrid(ctx, options->gridSize))
+   {
+      wsDestroyContext(ctx);
+      return(NULL);
+   }
+
+   return(ctx);
+}
+
+/************************************************************************/
+/*>BOOL wsUpdateContext(WSCONTEXT *ctx, const WSOPTIONS *options)
+   --------------------------------------------------------------
+   Give a context new options, keeping its memory. The memory is laid
+   out for the grid size the context was created with, so this returns
+   FALSE, leaving the context unchanged, if options->gridSize is larger
+   (a new context is needed then) or below 1. Any puzzle generated is
+   forgotten.
+
+   18.10.26 Original    By: agent
+            Smaller grids are allowed
+*/
+BOOL wsUpdateContext(WSCONTEXT *ctx, const WSOPTIONS *options)
+{
+   int i;
+
+   if(options->gridSize > ctx->maxGrid || options->gridSize < 1)
+      return(FALSE);
+
+   ctx->options   = *options;
+   ctx->sizeLimit = options->gridSize;
+   ResizeGrid(ctx, options->gridSize);
+   for(i=0; i<ctx->nracers; i++)
+   {
+      ctx->racers[i]->options           = *options;
+      ctx->racers[i]->options.portfolio = 1;
+   }
+
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>void wsDestroyContext(WSCONTEXT *ctx)
+   -------------------------------------
+   Free a context and its grids
+
+   18.10.26 Original    By: agent
+*/
+void wsDestroyContext(WSCONTEXT *ctx)
+{
+   int i;
+
+   if(ctx == NULL)
+      return;
+
+   free(ctx->cells);
+   free(ctx->outBuffer);
+   free(ctx->words);
+   free(ctx->sortWords);
+   free(ctx->bestWords);
+   free(ctx->bestGrid);
+   free(ctx->places);
+   free(ctx->bestPlaces);
+   free(ctx->state);
+   free(ctx->stateInts);
+   free(ctx->partial);
+   free(ctx->lines);
+   free(ctx->boards);
+   for(i=0; i<ctx->nracers; i++)
+      wsDestroyContext(ctx->racers[i]);
+   free(ctx->racers);
+   free(ctx->threads);
+   for(i=0; i<ctx->ntilers; i++)
+      wsDestroyContext(ctx->tilers[i]);
+   free(ctx->tilers);
+   free(ctx->tileThreads);
+   wsDestroySolver(ctx->solver);
+   FreePDF(ctx->pdf);
+   wsDestroyWordList(ctx->picked);
+   free(ctx->patterns);
+   free(ctx->letters);
+   free(ctx->text);
+   free(ctx);
+}
+
+/************************************************************************/
+/*>void wsGetStats(const WSCONTEXT *ctx, WSSTATS *stats)
+   -----------------------------------------------------
+   Get the counts of work done by the last wsGenerate() and wsRender()
+   on a context. In a race the counts cover all the searches. The times
+   are only measured if options->stats is set, so that the clock is not
+   read when nobody is looking.
+
+   18.10.26 Original    By: agent
+            Describes wsRender() and the times
+*/
+void wsGetStats(const WSCONTEXT *ctx, WSSTATS *stats)
+{
+   *stats = ctx->stats;
+}
+
+/************************************************************************/
+/*>void wsAddStats(WSSTATS *total, const WSSTATS *stats)
+   -----------------------------------------------------
+   Add one set of stats into a running total. The smallest and largest
+   grid sizes are kept rather than added.
+
+   18.10.26 Original    By: agent
+            Keeps the smallest and largest grid
+*/
+void wsAddStats(WSSTATS *total, const WSSTATS *stats)
+{
+   int i;
+
+   total->puzzles     += stats->puzzles;
+   total->failures    += stats->failures;
+   total->gaveUp      += stats->gaveUp;
+   total->words       += stats->words;
+   total->placements  += stats->placements;
+   total->backtracks  += stats->backtracks;
+   total->lines       += stats->lines;
+   total->conflicts   += stats->conflicts;
+   total->outOfBounds += stats->outOfBounds;
+   total->duplicates  += stats->duplicates;
+   total->fillRejects += stats->fillRejects;
+   total->fillForced  += stats->fillForced;
+   total->cacheHits   += stats->cacheHits;
+   total->gridProbes  += stats->gridProbes;
+   total->gridCells   += stats->gridCells;
+   total->gridSizes   += stats->gridSizes;
+   if(stats->gridMin && (!total->gridMin || stats->gridMin < total->gridMin))
+      total->gridMin = stats->gridMin;
+   if(stats->gridMax > total->gridMax)
+      total->gridMax = stats->gridMax;
+   total->timeouts    += stats->timeouts;
+   total->dropped     += stats->dropped;
+   for(i=0; i<WS_NDIRECTIONS; i++)
+      total->rejected[i] += stats->rejected[i];
+   for(i=0; i<=WS_MAXSTATLEN; i++)
+   {
+      total->lengthWords[i] += stats->lengthWords[i];
+      total->lengthTries[i] += stats->lengthTries[i];
+   }
+   total->bytes       += stats->bytes;
+   total->fitNs       += stats->fitNs;
+   total->fillNs      += stats->fillNs;
+   total->verifyNs    += stats->verifyNs;
+   total->renderNs    += stats->renderNs;
+}
+
+/************************************************************************/
+/*>int wsDroppedWords(const WSCONTEXT *ctx)
+   ----------------------------------------
+   Returns the number of words the fallback left out of the puzzle last
+   generated
+
+   18.10.26 Original    By: agent
+*/
+int wsDroppedWords(const WSCONTEXT *ctx)
+{
+   return(ctx->generated ? ctx->ndropped : 0);
+}
+
+/************************************************************************/
+/*>const char *wsGetDropped(const WSCONTEXT *ctx, int index)
+   ---------------------------------------------------------
+   Returns a word the fallback left out of the puzzle last generated, or
+   NULL if index is out of range
+
+   18.10.26 Original    By: agent
+*/
+const char *wsGetDropped(const WSCONTEXT *ctx, int index)
+{
+   if(index < 0 || index >= wsDroppedWords(ctx))
+      return(NULL);
+   return(ctx->words[ctx->NWords + index]);
+}
+
+/************************************************************************/
+/*>int wsGenerate(WSCONTEXT *ctx, const WSWORDLIST *list, uint64_t seed)
+   -----------------------------------------------------------------------
+   Build a puzzle from the first options->maxWords words of a word list.
+   The same seed, options and word list always give the same puzzle. The
+   context's memory is reused so there is no allocation unless the word
+   list is longer than any before. Returns WS_OK, WS_NOFIT if the words
+   cannot be fitted, WS_GAVEUP if the search used up its budget first
+   or WS_NOMEMORY.
+
+   The search is allowed options->budget placements or, if that is 0,
+   FITBUDGET() of the number of words. With a deadline and no budget
+   given, the deadline alone limits it.
+
+   The blanks are filled from a stream 2^128 numbers further on from the
+   one used to place the words, so the fill does not depend on how much
+   searching the placement took.
+
+   With options->portfolio above 1, that many searches race to place the
+   words and the first to finish is used. The puzzle then depends on
+   which search wins as well as on the seed.
+
+   A grid at least twice options->tileSize is split into tiles which are
+   filled in parallel by PlaceTiles() instead.
+
+   With options->unique the blanks are filled by FillUnique() so as not
+   to make extra copies of the words.
+
+   With options->verify the finished puzzle is searched for every word
+   and WS_BADPUZZLE is returned if one is missing. Extra occurrences are
+   counted in the stats.
+
+   With options->cache the puzzle is read from the cache directory if it
+   is there, and nothing else is done; otherwise it is added once it has
+   been built. A puzzle that cannot be added is still returned.
+
+   A list with an index has words sampled from it by PickWords() to make
+   up options->maxWords, and WS_NOWORDS is returned if there are none.
+
+   With options->autoGrid, AutoGrid() finds the smallest grid up to
+   options->gridSize that the words fit in, and the puzzle is built in
+   that.
+
+   With options->deadlineMs, the search stops when that time has passed
+   since the start and DegradePuzzle() applies options->fallback. The
+   words it leaves out are given by wsGetDropped(). A puzzle whose time
+   ran out is not cached. Tiled grids have no deadline.
+
+   18.10.26 Original    By: agent
+            Takes a 64-bit seed for the built-in generator
+            Uses at most options->maxWords words
+            Races searches with options->portfolio
+            Counts words and times the stages
+            Tiles large grids
+            Added verification
+            Added the unique fill
+            Added the cache
+            Samples words from an index
+            Added the automatic grid size
+            Added the deadline
+            Has a budget by default and tells giving up from no fit
+            Starts from the grid size of the options after growing
+*/
+int wsGenerate(WSCONTEXT *ctx, const WSWORDLIST *list, uint64_t seed)
+{
+   int      i,
+            status = WS_OK,
+            NWords;
+   size_t   size;
+   uint64_t start  = ctx->options.stats ? ClockNs() : 0,
+            mid,
+            key[2] = {0, 0};
+   BOOL     cached = FALSE;
+
+   ctx->generated = FALSE;
+   ctx->ndropped  = 0;
+   ctx->deadline  = 0;
+
+   /* The grow fallback leaves the grid larger than the options asked
+      for, so each puzzle starts again from their size
+   */
+   if(ctx->options.gridSize != ctx->sizeLimit &&
+      !ResizeGrid(ctx, ctx->sizeLimit))
+      return(WS_NOMEMORY);
+   if(ctx->options.deadlineMs > 0 && !TILED(&(ctx->options)))
+      ctx->deadline = ClockNs() + (uint64_t)ctx->options.deadlineMs * 
+                                  1000000;
+   if(list->index != NULL)
+   {
+      if((status = PickWords(ctx, list, seed)) != WS_OK)
+         return(status);
+      list = ctx->picked;
+   }
+
+   NWords = list->NWords;
+   if(NWords > ctx->options.maxWords)
+      NWords = ctx->options.maxWords;
+   if(ctx->options.budget)
+      ctx->budget = ctx->options.budget;
+   else
+      ctx->budget = ctx->deadline ? 0 : FITBUDGET(NWords);
+
+   if(ctx->options.cache)
+   {
+      CacheKey(ctx, list, NWords, seed, key);
+      cached = LoadPuzzle(ctx, list, NWords, seed, key);
+   }
+
+   if(cached)
+   {
+      ctx->stats.cacheHits = 1;
+   }
+   else if(TILED(&(ctx->options)))
+   {
+      status = PlaceTiles(ctx, list, seed);
+   }
+   else if(ctx->options.autoGrid)
+   {
+      status = AutoGrid(ctx, list, NWords, seed);
+   }
+   else
+   {
+      if(!PrepareSearch(ctx, list->words, NWords, seed, TRUE))
+         return(WS_NOMEMORY);
+
+      if(ctx->options.portfolio > 1)
+         status = RaceWords(ctx, list, seed);
+      else
+         status = FitWords(ctx);
+   }
+   if(status == WS_GAVEUP && PASTDEADLINE(ctx))
+   {
+      ctx->stats.timeouts = 1;
+      status = DegradePuzzle(ctx);
+   }
+
+   ctx->stats.puzzles = 1;
+   ctx->stats.words   = NWords;
+   ctx->stats.dropped = ctx->ndropped;
+   for(i=0; i<NWords; i++)
+      ctx->stats.lengthWords[StatLength(list->lengths[i])]++;
+
+   mid = ctx->options.stats ? ClockNs() : 0;
+   ctx->stats.fitNs = mid - start;
+   if(status != WS_OK)
+   {
+      ctx->stats.failures = 1;
+      ctx->stats.gaveUp   = (status == WS_GAVEUP);
+      return(status);
+   }
+   ctx->stats.gridCells = (unsigned long)ctx->options.gridSize *
+                          ctx->options.gridSize;
+   ctx->stats.gridSizes = ctx->options.gridSize;
+   ctx->stats.gridMin   = ctx->options.gridSize;
+   ctx->stats.gridMax   = ctx->options.gridSize;
+   if(cached)
+   {
+      ctx->generated = TRUE;
+      return(WS_OK);
+   }
+
+   /* The fill and the verification share the solver                   */
+   if((ctx->options.unique || ctx->options.verify) &&
+      (status = PrepareSolver(ctx)) != WS_OK)
+      return(status);
+
+   size = (size_t)ctx->options.gridSize * ctx->stride;
+   memcpy(ctx->solution, ctx->grid, size);
+   if(ctx->options.unique)
+   {
+      if((status = FillUnique(ctx)) != WS_OK)
+         return(status);
+   }
+   else
+   {
+      FillSpaces(ctx);
+   }
+   if(ctx->options.stats)
+      ctx->stats.fillNs = ClockNs() - mid;
+
+   if(ctx->options.verify)
+   {
+      mid    = ctx->options.stats ? ClockNs() : 0;
+      status = VerifyPuzzle(ctx);
+      if(ctx->options.stats)
+         ctx->stats.verifyNs = ClockNs() - mid;
+      if(status != WS_OK)
+      {
+         ctx->stats.failures = 1;
+         return(status);
+      }
+   }
+   ctx->generated = TRUE;
+
+   if(ctx->options.cache && !ctx->stats.timeouts)
+      StorePuzzle(ctx, list, key);
+
+   return(WS_OK);
+}
+
+/************************************************************************/
+/*>int wsRender(WSCONTEXT *ctx, WSSINK *sink)
+   ------------------------------------------
+   Write the puzzle last generated, and the solution if requested, in the
+   context's output style. Returns WS_OK, WS_NOPUZZLE, WS_NOMEMORY or
+   WS_WRITEERROR. The output is collected in the context's buffer and
+   passed to the sink in large blocks.
+
+   13.01.94 Original    By: ACRM (as part of main())
+   18.10.26 Modified    By: agent
+            Split out
+            Output is buffered
+            Records the bytes written and the time taken
+            The page break after the solution is made here
+            Added PDF
+*/
+int wsRender(WSCONTEXT *ctx, WSSINK *sink)
+{
+   WSOUT    out;
+   uint64_t start;
+
+   if(!ctx->generated)
+      return(WS_NOPUZZLE);
+
+   start = ctx->options.stats ? ClockNs() : 0;
+   OpenOutput(&out, sink, ctx->outBuffer);
+   if(ctx->options.style == STYLE_PDF)
+   {
+      if(ctx->pdf == NULL && (ctx->pdf = CreatePDF())==NULL)
+         return(WS_NOMEMORY);
+      out.pdf = ctx->pdf;
+   }
+
+   InitOutput(&out, ctx->options.style, ctx->options.fontSize, FALSE);
+   if(ctx->options.solution)
+   {
+      PrintSolution(&out, ctx);
+      NextPage(&out, ctx->options.style);
+   }
+   PrintPuzzle(&out, ctx);
+   EndOutput(&out, ctx->options.style);
+   OutFlush(&out);
+
+   ctx->stats.bytes = out.written;
+   if(ctx->options.stats)
+      ctx->stats.renderNs = ClockNs() - start;
+
+   return(out.error ? WS_WRITEERROR : WS_OK);
+}
+
+/************************************************************************/
+/*>int wsRenderPage(WSCONTEXT *ctx, WSSINK *sink, BOOL solution)
+   -------------------------------------------------------------
+   Write one page of the puzzle last generated for wsBookPage(): the
+   puzzle and its word list or, with solution set, the solution. Only
+   the contents of the page are written; the book adds the prolog, page
+   comments and page numbers. Nothing is written for the solution
+   unless options->solution is set. Returns WS_OK, WS_NOPUZZLE or
+   WS_WRITEERROR.
+
+   18.10.26 Original    By: agent
+*/
+int wsRenderPage(WSCONTEXT *ctx, WSSINK *sink, BOOL solution)
+{
+   WSOUT    out;
+   uint64_t start;
+
+   if(!ctx->generated)
+      return(WS_NOPUZZLE);
+
+   start = ctx->options.stats ? ClockNs() : 0;
+   OpenOutput(&out, sink, ctx->outBuffer);
+
+   if(!solution)
+      PrintPuzzle(&out, ctx);
+   else if(ctx->options.solution)
+      PrintSolution(&out, ctx);
+   OutFlush(&out);
+
+   ctx->stats.bytes += out.written;
+   if(ctx->options.stats)
+      ctx->stats.renderNs += ClockNs() - start;
+
+   return(out.error ? WS_WRITEERROR : WS_OK);
+}
+
+/************************************************************************/
+/*>WSBOOK *wsCreateBook(const WSOPTIONS *options, WSSINK *sink)
+   ------------------------------------------------------------
+   Start a book in the output style of the options and write its
+   prolog to the sink. Returns NULL if out of memory.
+
+   18.10.26 Original    By: agent
+            Added PDF
+*/
+WSBOOK *wsCreateBook(const WSOPTIONS *options, WSSINK *sink)
+{
+   WSBOOK *book;
+   char   *buffer;
+   PDFDOC *pdf = NULL;
+
+   if((book = (WSBOOK *)malloc(sizeof(WSBOOK)))==NULL)
+      return(NULL);
+   if((buffer = (char *)malloc(OUTBUFFSIZE))==NULL ||
+      (options->style == STYLE_PDF && (pdf = CreatePDF())==NULL))
+   {
+      free(buffer);
+      free(book);
+      return(NULL);
+   }
+
+   book->style    = options->style;
+   book->fontSize = options->fontSize;
+   book->pages    = 0;
+   book->spool    = NULL;
+   book->error    = FALSE;
+   OpenOutput(&(book->out), sink, buffer);
+   book->out.pdf  = pdf;
+
+   InitOutput(&(book->out), book->style, book->fontSize, TRUE);
+   OutFlush(&(book->out));
+
+   return(book);
+}
+
+/************************************************************************/
+/*>int wsBookPage(WSBOOK *book, const char *page, size_t length,
+                  BOOL solution)
+   -------------------------------------------------------------
+   Input:   WSBOOK     *book      The book
+            const char *page      A page from wsRenderPage()
+            size_t     length     Its length; empty pages are skipped
+            BOOL       solution   It is the solution to the last puzzle
+
+   Add a page to a book. A puzzle is numbered and passed straight to
+   the sink. A solution is added to the end of the temporary file that
+   becomes the answer key. Returns WS_OK or WS_WRITEERROR.
+
+   18.10.26 Original    By: agent
+*/
+int wsBookPage(WSBOOK *book, const char *page, size_t length,
+               BOOL solution)
+{
+   SPOOLPAGE header;
+
+   if(length == 0)
+      return(WS_OK);
+
+   if(solution)
+   {
+      header.length = length;
+      header.page   = book->pages;
+      if((book->spool == NULL && (book->spool = tmpfile())==NULL) ||
+         fwrite(&header, sizeof(SPOOLPAGE), 1, book->spool) != 1 ||
+         fwrite(page, 1, length, book->spool) != length)
+         book->error = TRUE;
+      return(book->error ? WS_WRITEERROR : WS_OK);
+   }
+
+   book->pages++;
+   StartPage(&(book->out), book->style, book->fontSize, book->pages);
+   OutWrite(&(book->out), page, length);
+   EndPage(&(book->out), book->style, book->pages, 0);
+   OutFlush(&(book->out));
+
+   return(book->out.error ? WS_WRITEERROR : WS_OK);
+}
+
+/************************************************************************/
+/*>int wsFinishBook(WSBOOK *book)
+   ------------------------------
+   Write the answer key, if there are any solutions, and end the book.
+   The answer key is copied from the spool a block at a time. The book 
+   is freed. Returns WS_OK or WS_WRITEERROR.
+
+   18.10.26 Original    By: agent
+            Added PDF
+*/
+int wsFinishBook(WSBOOK *book)
+{
+   SPOOLPAGE header;
+   char      block[BUFSIZ];
+   size_t    n;
+   BOOL      error;
+
+   if(book->spool != NULL && !book->error)
+   {
+      rewind(book->spool);
+      while(fread(&header, sizeof(SPOOLPAGE), 1, book->spool) == 1)
+      {
+         book->pages++;
+         StartPage(&(book->out), book->style, book->fontSize, 
+                   book->pages);
+         for(; header.length; header.length -= n)
+         {
+            n = (header.length < sizeof(block)) ? header.length 
+                                                : sizeof(block);
+            if(fread(block, 1, n, book->spool) != n)
+            {
+               book->error = TRUE;
+               break;
+            }
+            OutWrite(&(book->out), block, n);
+         }
+         EndPage(&(book->out), book->style, book->pages, header.page);
+         if(book->error)
+            break;
+      }
+   }
+
+   switch(book->style)
+   {
+   case STYLE_PS:
+      OutPrintf(&(book->out),"%%%%Trailer\n");
+      OutPrintf(&(book->out),"%%%%Pages: %d\n", book->pages);
+      OutPrintf(&(book->out),"%%%%EOF\n");
+      break;
+   case STYLE_LATEX:
+      OutPrintf(&(book->out),"\\end{document}\n");
+      break;
+   case STYLE_PDF:
+      EndPDF(&(book->out));
+      break;
+   }
+   OutFlush(&(book->out));
+
+   error = book->error || book->out.error;
+   if(book->spool != NULL)
+      fclose(book->spool);
+   FreePDF(book->out.pdf);
+   free(book->out.buffer);
+   free(book);
+
+   return(error ? WS_WRITEERROR : WS_OK);
+}
+
+/************************************************************************/
+/*>int wsWritePuzzle(WSCONTEXT *ctx, FILE *fp)
+   -------------------------------------------
+   Add the puzzle last generated, or loaded, to a puzzle file so that it
+   may be rendered again later with wsLoadPuzzle(). Only the grid and
+   where each word is, as recorded when it was placed, are kept; the 
+   style, font size and whether the solution and word list are shown 
+   are those of the context that renders it. Puzzles are simply written
+   one after another, so fp may be opened for appending to add to an
+   existing file. Returns WS_OK, WS_NOPUZZLE, WS_NOMEMORY or 
+   WS_WRITEERROR.
+
+   18.10.26 Original    By: agent
+            Writes the places recorded for the words
+*/
+int wsWritePuzzle(WSCONTEXT *ctx, FILE *fp)
+{
+   PUZZLEHEADER header;
+   PUZZLEWORD   *records;
+   char         *buffer,
+                *cells;
+   size_t       size;
+   int          y,
+                status   = WS_OK,
+                gridsize = ctx->options.gridSize;
+
+   if(!ctx->generated)
+      return(WS_NOPUZZLE);
+
+   size = PuzzleSize(gridsize, ctx->NWords);
+   if((buffer = (char *)calloc(size, 1))==NULL)
+      return(WS_NOMEMORY);
+   records = (PUZZLEWORD *)(buffer + sizeof(PUZZLEHEADER));
+   cells   = (char *)(records + ctx->NWords);
+
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, PUZZLEMAGIC, sizeof(header.magic));
+   header.gridSize = (uint32_t)gridsize;
+   header.NWords   = (uint32_t)ctx->NWords;
+   header.seed     = ctx->seed;
+   memcpy(buffer, &header, sizeof(header));
+   MakeRecords(ctx, records);
+   for(y=0; y<gridsize; y++)
+      memcpy(cells + (size_t)y * gridsize, 
+             ctx->grid + (size_t)y * ctx->stride, gridsize);
+
+   if(fwrite(buffer, 1, size, fp) != size)
+      status = WS_WRITEERROR;
+
+   free(buffer);
+   return(status);
+}
+
+/************************************************************************/
+/*>WSPUZZLES *wsOpenPuzzles(FILE *fp)
+   ----------------------------------
+   Map a puzzle file written by wsWritePuzzle() into memory and find
+   where each puzzle starts. The file may be closed afterwards. Every
+   word record is checked to lie within its grid, so a damaged file can
+   never make wsLoadPuzzle() read outside the mapping; the grids
+   themselves are not read. Returns NULL if the file is not a puzzle
+   file or memory allocation failed.
+
+   18.10.26 Original    By: agent
+*/
+WSPUZZLES *wsOpenPuzzles(FILE *fp)
+{
+   struct stat        st;
+   WSPUZZLES          *puzzles;
+   const PUZZLEHEADER *header;
+   size_t             size,
+                      offset,
+                      *offsets;
+   char               *data;
+   int                maxPuzzles = 0;
+
+   if(fstat(fileno(fp), &st) || !S_ISREG(st.st_mode) ||
+      (size_t)st.st_size < sizeof(PUZZLEHEADER))
+      return(NULL);
+   size = (size_t)st.st_size;
+
+   data = (char *)mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(fp), 0);
+   if(data == MAP_FAILED)
+      return(NULL);
+   if((puzzles = (WSPUZZLES *)calloc(1, sizeof(WSPUZZLES)))==NULL)
+   {
+      munmap(data, size);
+      return(NULL);
+   }
+   puzzles->data = data;
+   puzzles->size = size;
+
+   for(offset=0; offset<size && ValidPuzzle(data + offset, size - offset);
+       offset+=PuzzleSize((int)header->gridSize, (int)header->NWords))
+   {
+      header = (const PUZZLEHEADER *)(data + offset);
+
+      if(puzzles->npuzzles == maxPuzzles)
+      {
+         maxPuzzles = maxPuzzles ? 2 * maxPuzzles : 64;
+         if((offsets = (size_t *)realloc(puzzles->offsets, maxPuzzles *
+                                         sizeof(size_t)))==NULL)
+            break;
+         puzzles->offsets = offsets;
+      }
+      puzzles->offsets[puzzles->npuzzles++] = offset;
+      if((int)header->gridSize > puzzles->maxGrid)
+         puzzles->maxGrid = (int)header->gridSize;
+   }
+
+   if(offset != size)
+   {
+      wsClosePuzzles(puzzles);
+      return(NULL);
+   }
+
+   return(puzzles);
+}
+
+/************************************************************************/
+/*>int wsPuzzleCount(const WSPUZZLES *puzzles)
+   -------------------------------------------
+   Returns the number of puzzles in a puzzle file
+
+   18.10.26 Original    By: agent
+*/
+int wsPuzzleCount(const WSPUZZLES *puzzles)
+{
+   return(puzzles->npuzzles);
+}
+
+/************************************************************************/
+/*>int wsPuzzleGridSize(const WSPUZZLES *puzzles)
+   ----------------------------------------------
+   Returns the largest grid size of the puzzles in a puzzle file. A
+   context created with this grid size can load any of them.
+
+   18.10.26 Original    By: agent
+*/
+int wsPuzzleGridSize(const WSPUZZLES *puzzles)
+{
+   return(puzzles->maxGrid);
+}
+
+/************************************************************************/
+/*>int wsLoadPuzzle(WSCONTEXT *ctx, const WSPUZZLES *puzzles, int index)
+   ---------------------------------------------------------------------
+   Put puzzle number index, from 0, of a puzzle file in a context as if
+   it had just been generated, so that wsRender() or wsRenderPage() 
+   writes it with the context's options. The grid is copied from the
+   file as it is and each word and its place in the solution are read
+   off the grid along its record. The grid size becomes that of the
+   puzzle. Returns WS_OK, WS_NOPUZZLE if there is no such puzzle,
+   WS_TOOLARGE if its grid is larger than the context was created for,
+   or WS_NOMEMORY.
+
+   18.10.26 Original    By: agent
+            Keeps where each word is
+*/
+int wsLoadPuzzle(WSCONTEXT *ctx, const WSPUZZLES *puzzles, int index)
+{
+   const PUZZLEHEADER *header;
+   const PUZZLEWORD   *records;
+   const char         *cells;
+   const DIRECTION    *dir;
+   char               *text;
+   size_t             length = 0;
+   int                i, j, y, s, step, gridsize, NWords;
+
+   if(index < 0 || index >= puzzles->npuzzles)
+      return(WS_NOPUZZLE);
+
+   header   = (const PUZZLEHEADER *)(puzzles->data + 
+                                     puzzles->offsets[index]);
+   records  = (const PUZZLEWORD *)(header + 1);
+   gridsize = (int)header->gridSize;
+   NWords   = (int)header->NWords;
+   cells    = (const char *)(records + NWords);
+   if(gridsize > ctx->maxGrid)
+      return(WS_TOOLARGE);
+
+   for(i=0; i<NWords; i++)
+      length += records[i].length + 1;
+   if(length > ctx->maxText)
+   {
+      if((text = (char *)realloc(ctx->text, length))==NULL)
+         return(WS_NOMEMORY);
+      ctx->text    = text;
+      ctx->maxText = length;
+   }
+   if(!ReserveWords(ctx, NWords, FALSE) || !ResizeGrid(ctx, gridsize))
+      return(WS_NOMEMORY);
+
+   for(y=0; y<gridsize; y++)
+      memcpy(ctx->grid + (size_t)y * ctx->stride, 
+             cells + (size_t)y * gridsize, gridsize);
+
+   for(i=0, text=ctx->text; i<NWords; i++)
+   {
+      dir  = &(gDirections[records[i].direction]);
+      step = dir->dy * ctx->stride + dir->dx;
+      s    = (int)(records[i].start / gridsize) * ctx->stride +
+             (int)(records[i].start % gridsize);
+      ctx->words[i] = text;
+      for(j=0; j<records[i].length; j++, s+=step)
+         *(text++) = ctx->solution[s] = ctx->grid[s];
+      *(text++) = '\0';
+      ctx->places[i].x         = (int)(records[i].start % gridsize);
+      ctx->places[i].y         = (int)(records[i].start / gridsize);
+      ctx->places[i].direction = records[i].direction;
+   }
+
+   memset(&(ctx->stats), 0, sizeof(WSSTATS));
+   ctx->NWords    = NWords;
+   ctx->ndropped  = 0;
+   ctx->seed      = header->seed;
+   ctx->generated = TRUE;
+
+   return(WS_OK);
+}
+
+/************************************************************************/
+/*>void wsClosePuzzles(WSPUZZLES *puzzles)
+   ---------------------------------------
+   Unmap a puzzle file
+
+   18.10.26 Original    By: agent
+*/
+void wsClosePuzzles(WSPUZZLES *puzzles)
+{
+   if(puzzles == NULL)
+      return;
+
+   munmap((void *)puzzles->data, puzzles->size);
+   free(puzzles->offsets);
+   free(puzzles);
+}
+
+/************************************************************************/
+/*>WSSINK *wsFileSink(WSSINK *sink, FILE *fp)
+   ------------------------------------------
+   Set up a sink which writes to a stdio file. Returns the sink.
+
+   18.10.26 Original    By: agent
+*/
+WSSINK *wsFileSink(WSSINK *sink, FILE *fp)
+{
+   sink->write  = FileWrite;
+   sink->handle = (void *)fp;
+   return(sink);
+}
+
+/************************************************************************/
+/*>uint64_t wsPuzzleSeed(uint64_t base, int index)
+   ------------------------------------------------
+   Returns the seed for puzzle number index of a run with the given base
+   seed. This is the index'th output of a SplitMix64 generator seeded
+   with base, so any puzzle's seed may be found directly and a batch
+   gives the same puzzles however it is divided between threads.
+
+   18.10.26 Original    By: agent
+*/
+uint64_t wsPuzzleSeed(uint64_t base, int index)
+{
+   uint64_t state = base + (uint64_t)index * GOLDENGAMMA;
+
+   return(SplitMix64(&state));
+}
+
+/************************************************************************/
+/*>const char *wsErrorString(int code)
+   -----------------------------------
+   Returns a message describing a return code
+
+   18.10.26 Original    By: agent
+*/
+const char *wsErrorString(int code)
+{
+   switch(code)
+   {
+   case WS_OK:
+      return("No error");
+   case WS_NOMEMORY:
+      return("Unable to allocate memory");
+   case WS_NOFIT:
+      return("Unable to build puzzle: the words cannot all be fitted in \
+the grid");
+   case WS_WRITEERROR:
+      return("Unable to write output");
+   case WS_BADOPTION:
+      return("Unknown switch");
+   case WS_NOVALUE:
+      return("Switch requires a value");
+   case WS_HELP:
+      return("Help requested");
+   case WS_NOPUZZLE:
+      return("No puzzle has been generated");
+   case WS_BADVALUE:
+      return("Invalid value for switch");
+   case WS_BADPUZZLE:
+      return("Verification failed: a word is missing from the puzzle");
+   case WS_NOWORDS:
+      return("No words in the index match the options");
+   case WS_TIMEOUT:
+      return("Unable to build puzzle: the deadline passed before the \
+words were placed");
+   case WS_TOOLARGE:
+      return("The puzzle's grid is too large for the context");
+   case WS_GAVEUP:
+      return("Unable to build puzzle: the search gave up before the \
+words were placed");
+   }
+   return("Unknown error");
+}
+
+/************************************************************************/
+/*>WSSOLVER *wsCreateSolver(const WSWORDLIST *list, int NWords)
+   ------------------------------------------------------------
+   Create a solver for the first NWords words of a list, or all of them
+   if NWords is 0 or more than there are. The words are compiled into an
+   Aho-Corasick automaton so that wsSolve() need only pass each line of
+   a grid through it once in each direction, however many words there
+   are. The solver keeps no pointers into the list. Returns NULL if
+   memory allocation failed.
+
+   18.10.26 Original    By: agent
+*/
+WSSOLVER *wsCreateSolver(const WSWORDLIST *list, int NWords)
+{
+   WSSOLVER *solver;
+
+   if(NWords <= 0 || NWords > list->NWords)
+      NWords = list->NWords;
+
+   if((solver = (WSSOLVER *)calloc(1, sizeof(WSSOLVER)))==NULL)
+      return(NULL);
+   solver->record = TRUE;
+   if(!BuildSolver(solver, list->words, NWords))
+   {
+      wsDestroySolver(solver);
+      return(NULL);
+   }
+
+   return(solver);
+}
+
+/************************************************************************/
+/*>int wsSolve(WSSOLVER *solver, const char *grid, int gridsize,
+               int stride)
+   -------------------------------------------------------------
+   Find every occurrence of the solver's words in a square grid of
+   gridsize rows stride bytes apart, in all eight directions. Each
+   occurrence is counted once: a palindrome is not found again 
+   backwards and a single letter word is only found across. Returns 
+   WS_OK or WS_NOMEMORY.
+
+   18.10.26 Original    By: agent
+*/
+int wsSolve(WSSOLVER *solver, const char *grid, int gridsize, int stride)
+{
+   static int dxs[NSOLVEDIRS] = {1, -1, 0,  0, 1, -1,  1, -1},
+              dys[NSOLVEDIRS] = {0,  0, 1, -1, 1, -1, -1,  1};
+   int        d, i,
+              dx, dy, x0, y0;
+
+   solver->nmatches = 0;
+   solver->sorted   = FALSE;
+   solver->error    = FALSE;
+   if(solver->NWords)
+      memset(solver->count, 0, solver->NWords * sizeof(int));
+
+   /* Each line starts on the edge of the grid that the direction leads
+      away from. A diagonal line may start on either of two edges, which
+      share one corner
+   */
+   for(d=0; d<NSOLVEDIRS; d++)
+   {
+      dx = dxs[d];
+      dy = dys[d];
+      x0 = (dx > 0) ? 0 : gridsize - 1;
+      y0 = (dy > 0) ? 0 : gridsize - 1;
+      for(i=0; i<gridsize; i++)
+      {
+         if(dx)
+            ScanLine(solver, grid, gridsize, stride, x0, i, dx, dy);
+         if(dy && !(dx && i == x0))
+            ScanLine(solver, grid, gridsize, stride, i, y0, dx, dy);
+      }
+   }
+
+   return(solver->error ? WS_NOMEMORY : WS_OK);
+}
+
+/************************************************************************/
+/*>int wsGetMatches(WSSOLVER *solver, const WSMATCH **matches)
+   -----------------------------------------------------------
+   Get the occurrences found by the last wsSolve(), sorted by word and
+   then by position. A word that is in the list more than once has its
+   occurrences under its first entry. Returns the number of
+   occurrences.
+
+   18.10.26 Original    By: agent
+*/
+int wsGetMatches(WSSOLVER *solver, const WSMATCH **matches)
+{
+   if(!solver->sorted && solver->nmatches > 1)
+      qsort(solver->matches, solver->nmatches, sizeof(WSMATCH),
+            CompareMatches);
+   solver->sorted = TRUE;
+
+   *matches = solver->matches;
+   return(solver->nmatches);
+}
+
+/************************************************************************/
+/*>int wsWordMatches(const WSSOLVER *solver, int word)
+   ---------------------------------------------------
+   Returns the number of occurrences of a word found by the last 
+   wsSolve(). Every entry of a word that is in the list more than once
+   gives the same count.
+
+   18.10.26 Original    By: agent
+*/
+int wsWordMatches(const WSSOLVER *solver, int word)
+{
+   if(word < 0 || word >= solver->NWords)
+      return(0);
+   return(solver->count[solver->first[word]]);
+}
+
+/************************************************************************/
+/*>void wsDestroySolver(WSSOLVER *solver)
+   --------------------------------------
+   Free a solver
+
+   18.10.26 Original    By: agent
+*/
+void wsDestroySolver(WSSOLVER *solver)
+{
+   if(solver == NULL)
+      return;
+
+   free(solver->delta);
+   free(solver->stateInts);
+   free(solver->wordInts);
+   free(solver->matches);
+   free(solver);
+}
+
+/************************************************************************/
+/*>static WSBLOCK *NewBlock(WSWORDLIST *list, size_t size)
+   -------------------------------------------------------
+   Allocate a block of word text and put it at the head of a word list's
+   blocks. Returns NULL if memory allocation failed.
+
+   18.10.26 Original    By: agent
+*/
+static WSBLOCK *NewBlock(WSWORDLIST *list, size_t size)
+{
+   WSBLOCK *block;
+
+   if((block = (WSBLOCK *)malloc(sizeof(WSBLOCK)))==NULL)
+      return(NULL);
+   if((block->data = (char *)malloc(size))==NULL)
+   {
+      free(block);
+      return(NULL);
+   }
+
+   block->size   = size;
+   block->used   = 0;
+   block->mapped = FALSE;
+   block->next   = list->blocks;
+   list->blocks  = block;
+
+   return(block);
+}
+
+/************************************************************************/
+/*>static BOOL AddView(WSWORDLIST *list, char *word, int length)
+   -------------------------------------------------------------
+   Add a word which is already in one of the list's blocks, terminated
+   and normalised. Words outside the length limits are counted and
+   skipped. Returns FALSE if memory allocation failed.
+
+   18.10.26 Original    By: agent
+*/
+static BOOL AddView(WSWORDLIST *list, char *word, int length)
+{
+   char **words;
+   int  *lengths,
+        size;
+
+   if(length > list->maxWordLen || length < list->minWordLen)
+   {
+      list->nSkipped++;
+      return(TRUE);
+   }
+
+   if(list->sample)
+   {
+      SampleWord(list, word, length);
+      return(TRUE);
+   }
+
+   if(list->NWords >= list->maxWords)
+   {
+      size    = (list->maxWords < MAXWORDS) ? MAXWORDS : 
+                2 * list->maxWords;
+      words   = (char **)realloc(list->words, size * sizeof(char *));
+      if(words != NULL) list->words = words;
+      lengths = (int *)realloc(list->lengths, size * sizeof(int));
+      if(lengths != NULL) list->lengths = lengths;
+      if(words == NULL || lengths == NULL)
+         return(FALSE);
+      list->maxWords = size;
+   }
+
+   list->words[list->NWords]     = word;
+   list->lengths[list->NWords++] = length;
+
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>static BOOL InitSample(WSWORDLIST *list, const WSOPTIONS *options)
+   ------------------------------------------------------------------
+   Set up a word list to keep a sample of options->maxWords words. Each
+   length with a quota has a reservoir of that many slots, taken in
+   order of length while slots remain, and all other lengths share a
+   reservoir of the slots left over. Returns FALSE if memory allocation
+   failed.
+
+   18.10.26 Original    By: agent
+*/
+static BOOL InitSample(WSWORDLIST *list, const WSOPTIONS *options)
+{
+   int i,
+       size  = (options->maxWords > 0) ? options->maxWords : 0,
+       left  = size,
+       start = 0;
+
+   list->sample   = TRUE;
+   list->maxWords = size;
+
+   for(i=1; i<=WS_MAXQUOTA; i++)
+   {
+      if(options->quota[i] > 0 && i >= list->minWordLen && 
+         i <= list->maxWordLen)
+      {
+         list->strata[i].start = start;
+         list->strata[i].size  = (options->quota[i] < left) ? 
+                                 options->quota[i] : left;
+         start += list->strata[i].size;
+         left  -= list->strata[i].size;
+      }
+   }
+   list->strata[0].start = start;
+   list->strata[0].size  = left;
+
+   SeedRandom(&(list->rng), options->seed);
+   JumpRandom(&(list->rng));
+
+   if(size == 0)
+      return(TRUE);
+
+   list->words    = (char **)malloc(size * sizeof(char *));
+   list->lengths  = (int *)malloc(size * sizeof(int));
+   list->slotWord = (int *)malloc(size * sizeof(int));
+   list->slots    = (char *)malloc((size_t)size * (list->maxWordLen + 1));
+
+   return(list->words != NULL && list->lengths != NULL &&
+          list->slotWord != NULL && list->slots != NULL);
+}
+
+/************************************************************************/
+/*>static void SampleWord(WSWORDLIST *list, const char *word, int length)
+   ----------------------------------------------------------------------
+   Offer a word to a sampled list. This is reservoir sampling: the n'th
+   word of a length goes into its reservoir while there is room and
+   otherwise replaces a random one of the reservoir's words with 
+   probability size/n, so the reservoir is always a uniform sample of
+   the words seen.
+
+   18.10.26 Original    By: agent
+*/
+static void SampleWord(WSWORDLIST *list, const char *word, int length)
+{
+   WSSTRATUM *stratum = &(list->strata[0]);
+   uint64_t  j;
+   int       slot;
+
+   if(length <= WS_MAXQUOTA && list->strata[length].size)
+      stratum = &(list->strata[length]);
+
+   stratum->seen++;
+   if(stratum->count < stratum->size)
+   {
+      slot = stratum->start + stratum->count++;
+      list->slotWord[slot] = list->NWords;
+      list->words[list->NWords++] = list->slots + 
+                                    (size_t)slot * (list->maxWordLen+1);
+   }
+   else
+   {
+      if((j = RandomBelow(&(list->rng), stratum->seen)) >= 
+         (uint64_t)stratum->size)
+         return;
+      slot = stratum->start + (int)j;
+   }
+
+   memcpy(list->words[list->slotWord[slot]], word, length + 1);
+   list->lengths[list->slotWord[slot]] = length;
+}
+
+/************************************************************************/
+/*>static void FreeBlock(WSWORDLIST *list, WSBLOCK *block)
+   -------------------------------------------------------
+   Unlink a block of word text from a list and free or unmap it
+
+   18.10.26 Original    By: agent
+*/
+static void FreeBlock(WSWORDLIST *list, WSBLOCK *block)
+{
+   WSBLOCK **link;
+
+   for(link=&(list->blocks); *link!=NULL; link=&((*link)->next))
+   {
+      if(*link == block)
+      {
+         *link = block->next;
+         break;
+      }
+   }
+
+   if(block->mapped)
+      munmap(block->data, block->size);
+   else
+      free(block->data);
+   free(block);
+}
+
+/************************************************************************/
+/*>static BOOL ParseWords(WSWORDLIST *list, char *text, size_t length,
+                          BOOL final, size_t *used)
+   -------------------------------------------------------------------
+   Input:   char   *text    Text from a word list file
+            size_t length   Its length
+            BOOL   final    This is the end of the file
+   Output:  size_t *used    Bytes used
+   Returns: BOOL            FALSE if memory allocation failed
+
+   Normalise a block of text and add each line of it to the list as a
+   word. Each word is terminated in place, so no text is copied. An
+   unfinished last line is left for the next block unless this is the
+   end of the file, in which case text[length] must be writable.
+
+   18.10.26 Original    By: agent
+*/
+static BOOL ParseWords(WSWORDLIST *list, char *text, size_t length,
+                       BOOL final, size_t *used)
+{
+   char *line = text,
+        *end  = text + length,
+        *eol,
+        *last;
+
+   Normalise(text, length);
+
+   while(line < end)
+   {
+      if((eol = (char *)memchr(line, '\n', end - line))==NULL)
+      {
+         if(!final)
+            break;
+         eol = end;
+      }
+
+      /* Trim white space from both ends                                */
+      while(line < eol && (*line == ' ' || *line == '\t'))
+         line++;
+      for(last=eol; last > line && isspace((unsigned char)last[-1]); 
+          last--);
+      *last = '\0';
+
+      if(last > line && !AddView(list, line, (int)(last - line)))
+         return(FALSE);
+
+      line = eol + 1;
+   }
+
+   *used = (line < end) ? (size_t)(line - text) : length;
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>static void Normalise(char *text, size_t length)
+   ------------------------------------------------
+   Convert text to upper case. This is written without branches or
+   table lookups so that the compiler can vectorise it.
+
+   18.10.26 Original    By: agent
+*/
+static void Normalise(char *text, size_t length)
+{
+   unsigned char *ch = (unsigned char *)text;
+   size_t        i;
+
+   for(i=0; i<length; i++)
+      ch[i] -= (unsigned char)(((unsigned char)(ch[i] - 'a') < 26) << 5);
+}
+
+/************************************************************************/
+/*>static int MapWordList(WSWORDLIST *list, FILE *fp)
+   --------------------------------------------------
+   Read a word list by mapping the rest of a regular file into memory.
+   The mapping is private so the words can be normalised and terminated
+   in place. Returns 1 if the file was read, 0 if it cannot be mapped
+   and should be read with StreamWordList(), or -1 if memory allocation
+   failed.
+
+   18.10.26 Original    By: agent
+*/
+static int MapWordList(WSWORDLIST *list, FILE *fp)
+{
+   struct stat st;
+   WSBLOCK     *block,
+               *tail;
+   off_t       offset;
+   size_t      used,
+               length;
+   char        *data;
+
+   if(fstat(fileno(fp), &st) || !S_ISREG(st.st_mode) ||
+      (offset = ftello(fp)) < 0 || offset >= st.st_size)
+      return(0);
+
+   data = (char *)mmap(NULL, (size_t)st.st_size, PROT_READ|PROT_WRITE,
+                       MAP_PRIVATE, fileno(fp), 0);
+   if(data == MAP_FAILED)
+      return(0);
+
+   if((block = (WSBLOCK *)malloc(sizeof(WSBLOCK)))==NULL)
+   {
+      munmap(data, (size_t)st.st_size);
+      return(-1);
+   }
+   block->data   = data;
+   block->size   = (size_t)st.st_size;
+   block->used   = block->size;
+   block->mapped = TRUE;
+   block->next   = list->blocks;
+   list->blocks  = block;
+
+   /* Everything up to the last newline is read in place. The last line,
+      if unterminated, is copied so there is room to terminate it
+   */
+   length = block->size - (size_t)offset;
+   if(!ParseWords(list, data + offset, length, FALSE, &used))
+      return(-1);
+   if(used < length)
+   {
+      if((tail = NewBlock(list, length - used + 1))==NULL)
+         return(-1);
+      memcpy(tail->data, data + offset + used, length - used);
+      tail->used = length - used + 1;
+      if(!ParseWords(list, tail->data, length - used, TRUE, &used))
+         return(-1);
+   }
+
+   fseeko(fp, 0, SEEK_END);
+   return(1);
+}
+
+/************************************************************************/
+/*>static BOOL StreamWordList(WSWORDLIST *list, FILE *fp)
+   ------------------------------------------------------
+   Read a word list from a stream in large blocks. The words stay where
+   they were read and an unfinished line at the end of a block is moved
+   to the start of the next. A sampled list has no use for a block once
+   it has been read so only one is kept. Returns FALSE if memory 
+   allocation failed.
+
+   18.10.26 Original    By: agent
+*/
+static BOOL StreamWordList(WSWORDLIST *list, FILE *fp)
+{
+   WSBLOCK *block = NULL,
+           *last;
+   char    *carry = NULL;
+   size_t  ncarry = 0,
+           size,
+           want,
+           nread,
+           used;
+
+   for(;;)
+   {
+      /* Start a new block with the unfinished line from the last one.
+         The block is always at least twice the carried text so that
+         every read adds a useful amount and a final byte is free
+      */
+      size = (ncarry < READBLOCK / 2) ? READBLOCK : 2 * ncarry + 1;
+      last = block;
+      if((block = NewBlock(list, size))==NULL)
+         return(FALSE);
+      if(ncarry)
+         memcpy(block->data, carry, ncarry);
+      if(list->sample && last != NULL)
+         FreeBlock(list, last);
+
+      want  = size - ncarry - 1;
+      nread = fread(block->data + ncarry, 1, want, fp);
+      block->used = ncarry + nread;
+
+      /* A short read is the end of the file                            */
+      if(nread < want)
+         return(ParseWords(list, block->data, block->used, TRUE, &used));
+
+      if(!ParseWords(list, block->data, block->used, FALSE, &used))
+         return(FALSE);
+      carry  = block->data + used;
+      ncarry = block->used - used;
+   }
+}
+
+/************************************************************************/
+/*>static BOOL ReserveWords(WSCONTEXT *ctx, int NWords, BOOL search)
+   ------------------------------------------------------------------
+   Make sure a context has room for the word order of NWords words and,
+   if search is set, their search state. The starts[] and filled[]
+   arrays of every word's search state share one arena, laid out for
+   the largest grid the context may have. A tiled grid needs no search
+   state of its own, which would be large. Returns FALSE if memory
+   allocation failed.
+
+   18.10.26 Original    By: agent
+            Added search
+            Laid out for the largest grid
+            Added bestWords[]
+            Added partial[]
+            Added places[] and bestPlaces[]
+*/
+static BOOL ReserveWords(WSCONTEXT *ctx, int NWords, BOOL search)
+{
+   char        **words;
+   WORDPLACE   *places;
+   SEARCHSTATE *state;
+   PLACEMENT   *partial;
+   int         *ints,
+               i,
+               gridsize = ctx->maxGrid;
+
+   if(NWords < 1)
+      NWords = 1;
+
+   if(ctx->words == NULL || NWords > ctx->maxWords)
+   {
+      words = (char **)realloc(ctx->words, NWords * sizeof(char *));
+      if(words != NULL) ctx->words = words;
+      words = (char **)realloc(ctx->sortWords, NWords * sizeof(char *));
+      if(words != NULL) ctx->sortWords = words;
+      if(ctx->words == NULL || words == NULL)
+         return(FALSE);
+      words = (char **)realloc(ctx->bestWords, NWords * sizeof(char *));
+      if(words == NULL)
+         return(FALSE);
+      ctx->bestWords = words;
+      places = (WORDPLACE *)realloc(ctx->places, 
+                                    NWords * sizeof(WORDPLACE));
+      if(places != NULL) ctx->places = places;
+      places = (WORDPLACE *)realloc(ctx->bestPlaces, 
+                                    NWords * sizeof(WORDPLACE));
+      if(places != NULL) ctx->bestPlaces = places;
+      if(ctx->places == NULL || places == NULL)
+         return(FALSE);
+      ctx->maxWords  = NWords;
+   }
+
+   if(!search || (ctx->state != NULL && NWords <= ctx->maxStates))
+      return(TRUE);
+
+   state = (SEARCHSTATE *)realloc(ctx->state, 
+                                  NWords * sizeof(SEARCHSTATE));
+   if(state != NULL) ctx->state = state;
+   ints  = (int *)realloc(ctx->stateInts, 
+                          (size_t)NWords * 2 * gridsize * sizeof(int));
+   if(ints != NULL) ctx->stateInts = ints;
+   partial = (PLACEMENT *)realloc(ctx->partial, 
+                                  NWords * sizeof(PLACEMENT));
+   if(partial != NULL) ctx->partial = partial;
+
+   if(state == NULL || ints == NULL || partial == NULL)
+      return(FALSE);
+
+   for(i=0; i<NWords; i++)
+   {
+      state[i].starts = ints + (size_t)i * 2 * gridsize;
+      state[i].filled = state[i].starts + gridsize;
+   }
+   ctx->maxStates = NWords;
+
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>static BOOL ResizeGrid(WSCONTEXT *ctx, int gridsize)
+   ----------------------------------------------------
+   Give a context a blank grid of gridsize, no larger than the one its
+   memory is laid out for, and lay out its bitboard lines to match.
+   Returns FALSE if the grid is too large or memory allocation failed.
+
+   18.10.26 Original    By: agent (split out of wsCreateContext())
+*/
+static BOOL ResizeGrid(WSCONTEXT *ctx, int gridsize)
+{
+   size_t size;
+   int    i;
+
+   if(gridsize > ctx->maxGrid)
+      return(FALSE);
+
+   ctx->options.gridSize = gridsize;
+   ctx->stride           = gridsize + 1;
+   size                  = (size_t)gridsize * ctx->stride;
+   ctx->grid             = ctx->cells;
+   ctx->solution         = ctx->cells + size;
+   ctx->generated        = FALSE;
+
+   memset(ctx->cells, ' ', 2 * size);
+   for(i=0; i<2*gridsize; i++)
+      ctx->cells[(size_t)i * ctx->stride + gridsize] = '\0';
+
+   return(BuildBoardLines(ctx));
+}
+
+/************************************************************************/
+/*>static void FillSpaces(WSCONTEXT *ctx)
+   --------------------------------------
+   Fill in spaces in the grid with random letters
+
+   13.01.94 Original    By: ACRM
+   18.10.26 Modified    By: agent
+            Works on a WSCONTEXT with a flat grid
+*/
+static void FillSpaces(WSCONTEXT *ctx)
+{
+   int i, j;
+
+   for(i=0; i<ctx->options.gridSize; i++)
+   {
+      char *row = ctx->grid + (size_t)i * ctx->stride;
+      
+      for(j=0; j<ctx->options.gridSize; j++)
+      {
+         if(row[j] == ' ')
+         {
+            /* If it's a space, put in a random letter                  */
+            row[j] = (char)(65 + RandomNum(&(ctx->fillRng), 26));
+         }
+      }
+   }
+}
+
+/************************************************************************/
+/*>static int FillUnique(WSCONTEXT *ctx)
+   -------------------------------------
+   Fill in spaces in the grid with random letters, avoiding letters that
+   would spell one of the words. The cells are filled in order, so a new
+   occurrence of a word must run through the cell being filled and
+   otherwise only over letters already there.
+
+   Each of the four lines through a cell is read both ways by the 
+   solver's automaton. Reading across, down and diagonally down from
+   either side, everything before the cell has been filled, so the
+   automaton's state along each such line is carried from cell to cell
+   as the grid is filled. Reading the other way, only the letters
+   already placed beyond the cell come before it, and there are rarely
+   any. Each letter tried is then run on from those states over the
+   letters after it, stopping as soon as no word could still reach back
+   to the cell, so each cell costs a few steps per letter of the longest
+   word rather than a search of the grid.
+
+   The letters are tried in a random order, so each cell gets any of the
+   letters that make no word with equal chance. If every letter makes a
+   word, the first tried is used and the cell counted as forced. The 
+   context's solver must have been built by PrepareSolver(). Returns 
+   WS_OK or WS_NOMEMORY.
+
+   18.10.26 Original    By: agent
+*/
+static int FillUnique(WSCONTEXT *ctx)
+{
+   static int    dxs[NFILLAXES] = {1, 0, 1, -1},
+                 dys[NFILLAXES] = {0, 1, 1,  1};
+   WSSOLVER      *solver   = ctx->solver;
+   const int     *delta    = solver->delta;
+   unsigned char *lines,
+                 *line,
+                 *back,
+                 letters[NLETTERS],
+                 ch;
+   int           *states,
+                 *carried[NFILLAXES],
+                 gridsize  = ctx->options.gridSize,
+                 nclasses  = solver->nclasses,
+                 reach     = solver->maxLength - 1,
+                 span      = solver->maxLength,
+                 length[NFILLAXES][2],
+                 start[NFILLAXES][2],
+                 x, y, a, i, j, k, n, xx, yy;
+   BOOL          made;
+   char          *row;
+
+   if(reach < 0)
+   {
+      FillSpaces(ctx);
+      return(WS_OK);
+   }
+
+   /* The state carried along each row, column and diagonal             */
+   if((states = (int *)calloc((size_t)6 * gridsize, sizeof(int)))==NULL)
+      return(WS_NOMEMORY);
+   carried[0] = states;                 /* Across, one row at a time    */
+   carried[1] = states + gridsize;      /* Down, by column              */
+   carried[2] = states + 2 * gridsize;  /* Down and right, by x-y       */
+   carried[3] = states + 4 * gridsize;  /* Down and left, by x+y        */
+
+   /* Each axis has the letters from the cell on, both ways             */
+   if((lines = (unsigned char *)malloc((size_t)2 * NFILLAXES * span))
+      ==NULL)
+   {
+      free(states);
+      return(WS_NOMEMORY);
+   }
+   for(i=0; i<NLETTERS; i++)
+      letters[i] = (unsigned char)('A' + i);
+
+   for(y=0; y<gridsize; y++)
+   {
+      row = ctx->grid + (size_t)y * ctx->stride;
+      carried[0][0] = 0;
+      for(x=0; x<gridsize; x++)
+      {
+         if(row[x] == ' ')
+         {
+            for(a=0; a<NFILLAXES; a++)
+            {
+               line = lines + (size_t)2 * a * span;
+               back = line + span;
+
+               /* Letters already placed after the cell                 */
+               for(n=1; n<=reach; n++)
+               {
+                  xx = x + n * dxs[a];
+                  yy = y + n * dys[a];
+                  if(xx < 0 || xx >= gridsize || yy >= gridsize ||
+                     CELL(ctx->grid, ctx->stride, xx, yy) == ' ')
+                     break;
+                  line[n] = (unsigned char)
+                     CELL(ctx->grid, ctx->stride, xx, yy);
+               }
+               length[a][0] = n;
+
+               /* Letters before it, read backwards                     */
+               for(n=1; n<=reach; n++)
+               {
+                  xx = x - n * dxs[a];
+                  yy = y - n * dys[a];
+                  if(xx < 0 || xx >= gridsize || yy < 0 ||
+                     CELL(ctx->grid, ctx->stride, xx, yy) == ' ')
+                     break;
+                  back[n] = (unsigned char)
+                     CELL(ctx->grid, ctx->stride, xx, yy);
+               }
+               length[a][1] = n;
+
+               start[a][0] = carried[a][(a == 2) ? x - y + gridsize - 1 :
+                                        (a == 3) ? x + y : 
+                                        (a == 1) ? x : 0];
+               start[a][1] = 0;
+               for(i=length[a][0]-1; i>0; i--)
+                  start[a][1] = delta[(size_t)start[a][1] * nclasses +
+                                      solver->class[line[i]]];
+            }
+
+            /* Try the letters in a random order                        */
+            for(k=0; k<NLETTERS; k++)
+            {
+               j          = k + RandomNum(&(ctx->fillRng), NLETTERS - k);
+               ch         = letters[j];
+               letters[j] = letters[k];
+               letters[k] = ch;
+
+               made = FALSE;
+               for(a=0; a<NFILLAXES && !made; a++)
+               {
+                  line    = lines + (size_t)2 * a * span;
+                  back    = line + span;
+                  line[0] = ch;
+                  back[0] = ch;
+                  made = WordThrough(solver, start[a][0], line,
+                                     length[a][0]) ||
+                         WordThrough(solver, start[a][1], back,
+                                     length[a][1]);
+               }
+               if(!made)
+                  break;
+               ctx->stats.fillRejects++;
+            }
+
+            if(k == NLETTERS)
+            {
+               ctx->stats.fillForced++;
+               k = 0;
+            }
+            row[x] = (char)letters[k];
+         }
+
+         /* Carry the states on over this cell                          */
+         ch = solver->class[(unsigned char)row[x]];
+         carried[0][0] = delta[(size_t)carried[0][0] * nclasses + ch];
+         carried[1][x] = delta[(size_t)carried[1][x] * nclasses + ch];
+         i = x - y + gridsize - 1;
+         carried[2][i] = delta[(size_t)carried[2][i] * nclasses + ch];
+         i = x + y;
+         carried[3][i] = delta[(size_t)carried[3][i] * nclasses + ch];
+      }
+   }
+
+   free(lines);
+   free(states);
+   return(WS_OK);
+}
+
+/************************************************************************/
+/*>static BOOL WordThrough(const WSSOLVER *solver, int state,
+                           const unsigned char *text, int length)
+   -------------------------------------------------------------
+   Returns TRUE if, going on from state, a word of the solver's ends
+   somewhere in text having started at or before its first letter. The
+   automaton's state after each letter stands for the longest word
+   prefix ending there, so once that no longer reaches back to the
+   first letter no later word can either.
+
+   18.10.26 Original    By: agent
+*/
+static BOOL WordThrough(const WSSOLVER *solver, int state,
+                        const unsigned char *text, int length)
+{
+   int i, r,
+       s = state;
+
+   for(i=0; i<length; i++)
+   {
+      s = solver->delta[(size_t)s * solver->nclasses + 
+                        solver->class[text[i]]];
+      if(solver->depth[s] <= i)
+         return(FALSE);
+      if((r = solver->report[s]) != 0 &&
+         solver->length[solver->out[r]] > i)
+         return(TRUE);
+   }
+
+   return(FALSE);
+}
+
+/************************************************************************/
+/*>static void SeedRandom(WSRNG *rng, uint64_t seed)
+   -------------------------------------------------
+   Seed a generator. The state is filled from SplitMix64 so that similar
+   seeds give unrelated streams and the state is never all zero.
+
+   18.10.26 Original    By: agent
+*/
+static void SeedRandom(WSRNG *rng, uint64_t seed)
+{
+   int i;
+
+   for(i=0; i<4; i++)
+      rng->s[i] = SplitMix64(&seed);
+}
+
+/************************************************************************/
+/*>static uint64_t SplitMix64(uint64_t *state)
+   -------------------------------------------
+   Returns the next output of a SplitMix64 generator
+
+   18.10.26 Original    By: agent
+*/
+static uint64_t SplitMix64(uint64_t *state)
+{
+   uint64_t z = (*state += GOLDENGAMMA);
+
+   z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+   z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+   return(z ^ (z >> 31));
+}
+
+/************************************************************************/
+/*>static uint64_t NextRandom(WSRNG *rng)
+   --------------------------------------
+   Returns the next 64 random bits from a xoshiro256** generator
+
+   18.10.26 Original    By: agent
+*/
+static uint64_t NextRandom(WSRNG *rng)
+{
+   uint64_t *s     = rng->s,
+            result = s[1] * 5,
+            t      = s[1] << 17;
+
+   result = ((result << 7) | (result >> 57)) * 9;
+
+   s[2] ^= s[0];
+   s[3] ^= s[1];
+   s[1] ^= s[2];
+   s[0] ^= s[3];
+   s[2] ^= t;
+   s[3]  = (s[3] << 45) | (s[3] >> 19);
+
+   return(result);
+}
+
+/************************************************************************/
+/*>static void JumpRandom(WSRNG *rng)
+   ----------------------------------
+   Move a generator on by 2^128 numbers. Streams jumped from the same
+   state do not overlap for any practical number of draws.
+
+   18.10.26 Original    By: agent
+*/
+static void JumpRandom(WSRNG *rng)
+{
+   static const uint64_t jump[] = {0x180ec6d33cfd0abaULL,
+                                   0xd5a61266f0c9392cULL,
+                                   0xa9582618e03fc9aaULL,
+                                   0x39abdc4529b1661cULL};
+   uint64_t t[4] = {0, 0, 0, 0};
+   int      i, b, j;
+
+   for(i=0; i<4; i++)
+   {
+      for(b=0; b<64; b++)
+      {
+         if(jump[i] & ((uint64_t)1 << b))
+         {
+            for(j=0; j<4; j++)
+               t[j] ^= rng->s[j];
+         }
+         NextRandom(rng);
+      }
+   }
+
+   for(j=0; j<4; j++)
+      rng->s[j] = t[j];
+}
+
+/************************************************************************/
+/*>static int RandomNum(WSRNG *rng, int maxran)
+   --------------------------------------------
+   Return a random integer between 0 and maxran-1. Uses Lemire's
+   multiply-and-shift with rejection of the few values that would bias
+   the result.
+
+   13.01.94 Original    By: ACRM
+   18.10.26 Modified    By: agent
+            Never returns maxran (used to when rand()==RAND_MAX)
+            Uses rand_r() with a per-context seed
+            Uses the built-in generator and is unbiased
+*/
+static int RandomNum(WSRNG *rng, int maxran)
+{
+   uint32_t range = (uint32_t)maxran,
+            threshold;
+   uint64_t m;
+
+   m = (NextRandom(rng) >> 32) * range;
+   if((uint32_t)m < range)
+   {
+      threshold = (uint32_t)(-range) % range;
+      while((uint32_t)m < threshold)
+         m = (NextRandom(rng) >> 32) * range;
+   }
+
+   return((int)(m >> 32));
+}
+
+/************************************************************************/
+/*>static uint64_t RandomBelow(WSRNG *rng, uint64_t n)
+   ---------------------------------------------------
+   Return a random integer between 0 and n-1 for any 64-bit n, rejecting
+   the few values that would bias the result
+
+   18.10.26 Original    By: agent
+*/
+static uint64_t RandomBelow(WSRNG *rng, uint64_t n)
+{
+   uint64_t threshold = (-n) % n,
+            x;
+
+   do
+   {
+      x = NextRandom(rng);
+   }  while(x < threshold);
+
+   return(x % n);
+}
+
+/************************************************************************/
+/*>static BOOL ParseQuota(WSOPTIONS *options, const char *value)
+   -------------------------------------------------------------
+   Read quotas of the form length:count[,length:count...]. Returns FALSE
+   if the value is not of that form or a length is out of range.
+
+   18.10.26 Original    By: agent
+*/
+static BOOL ParseQuota(WSOPTIONS *options, const char *value)
+{
+   int length, count, used;
+
+   for(;;)
+   {
+      if(sscanf(value, "%d:%d%n", &length, &count, &used) != 2 ||
+         length < 1 || length > WS_MAXQUOTA || count < 0)
+         return(FALSE);
+      options->quota[length] = count;
+
+      value += used;
+      if(*value == '\0')
+         return(TRUE);
+      if(*value++ != ',')
+         return(FALSE);
+   }
+}
+
+/************************************************************************/
+/*>static BOOL ParseDirections(WSOPTIONS *options, const char *value)
+   ------------------------------------------------------------------
+   Set options->directions from a comma-separated list of compass
+   points (N, NE, E ...) in either case, or "all". Returns FALSE if a
+   name is not recognised.
+
+   18.10.26 Original    By: agent
+*/
+static BOOL ParseDirections(WSOPTIONS *options, const char *value)
+{
+   char name[4];
+   int  i, len,
+        directions = 0;
+
+   for(;;)
+   {
+      for(len=0; value[len] && value[len] != ','; len++)
+      {
+         if(len == 3)
+            return(FALSE);
+         name[len] = (char)toupper((unsigned char)value[len]);
+      }
+      name[len] = '\0';
+
+      if(!strcmp(name, "ALL"))
+      {
+         directions = WS_DIR_ALL;
+      }
+      else
+      {
+         for(i=0; i<NDIRECTIONS; i++)
+         {
+            if(!strcmp(name, gDirections[i].name))
+               break;
+         }
+         if(i == NDIRECTIONS)
+            return(FALSE);
+         directions |= 1 << i;
+      }
+
+      if(value[len] == '\0')
+         break;
+      value += len + 1;
+   }
+
+   options->directions = directions;
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>static BOOL IsLongOption(const char *name, const char *option)
+   --------------------------------------------------------------
+   Returns TRUE if a switch is the long option given, with one or two
+   leading dashes
+
+   18.10.26 Original    By: agent
+*/
+static BOOL IsLongOption(const char *name, const char *option)
+{
+   if(*name == '-') name++;
+   if(*name == '-') name++;
+
+   return(!strcmp(name, option));
+}
+
+/************************************************************************/
+/*>static BOOL PrepareSearch(WSCONTEXT *ctx, char **words, int NWords,
+                             uint64_t seed, BOOL search)
+   ---------------------------------------------------------------------
+   Clear the grid and set up the words and random number streams for a
+   search and, if search is set, the search state and bitboards. 
+   Returns FALSE if memory allocation failed.
+
+   18.10.26 Original    By: agent (split out of wsGenerate())
+            Takes an array of words
+            Added search
+            Sets up the directions
+            Builds the pattern index for the dense option
+*/
+static BOOL PrepareSearch(WSCONTEXT *ctx, char **words, int NWords,
+                          uint64_t seed, BOOL search)
+{
+   int i;
+
+   memset(&(ctx->stats), 0, sizeof(WSSTATS));
+   if(!ReserveWords(ctx, NWords, search))
+      return(FALSE);
+
+   for(i=0; i<ctx->options.gridSize; i++)
+      memset(ctx->grid + (size_t)i * ctx->stride, ' ', 
+             ctx->options.gridSize);
+   for(i=0; i<NWords; i++)
+      ctx->words[i] = words[i];
+   ctx->NWords = NWords;
+   if(search && !ReserveBoards(ctx))
+      return(FALSE);
+   if(search && ctx->options.dense && !ReservePatterns(ctx))
+      return(FALSE);
+   SetDirections(ctx);
+
+   ctx->seed   = seed;
+   SeedRandom(&(ctx->rng), seed);
+   ctx->fillRng = ctx->rng;
+   JumpRandom(&(ctx->fillRng));
+
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>static int PlaceTiles(WSCONTEXT *ctx, const WSWORDLIST *list,
+                         uint64_t seed)
+   -------------------------------------------------------------
+   Place the words in a large grid by splitting it into square tiles of
+   about options->tileSize cells (never smaller than the longest word)
+   and filling each tile with its own search. The words are sorted by
+   length and dealt to the tiles in snake order so that each tile gets
+   a like share of long and short words. A word never crosses the edge
+   of a tile. Cells beyond the last whole tile are left blank for
+   FillSpaces().
+
+   The tiles are filled by options->nThreads threads (0 for one per
+   CPU), one of them this thread. Each tile's search has its own seed
+   and a budget of placements; if the budget runs out the tile is tried
+   again with another seed, up to TILETRIES times. A tile depends only
+   on the grid's seed and its words, so the puzzle is the same for any
+   number of threads. The portfolio option is not used.
+
+   Returns WS_OK, WS_NOFIT if a tile's words cannot be fitted in it,
+   WS_GAVEUP if a tile could not be filled within its budgets or 
+   WS_NOMEMORY.
+
+   18.10.26 Original    By: agent
+            Keeps where the words are
+*/
+static int PlaceTiles(WSCONTEXT *ctx, const WSWORDLIST *list,
+                      uint64_t seed)
+{
+   WSTILES tiles;
+   int     *count,
+           i, t, row, maxLen,
+           nthreads = ctx->options.nThreads,
+           gridsize = ctx->options.gridSize,
+           NWords   = list->NWords;
+
+   if(NWords > ctx->options.maxWords)
+      NWords = ctx->options.maxWords;
+   if(!PrepareSearch(ctx, list->words, NWords, seed, FALSE))
+      return(WS_NOMEMORY);
+   SortByLength(ctx->words, NWords, ctx->sortWords);
+
+   maxLen       = NWords ? (int)strlen(ctx->words[0]) : 1;
+   tiles.across = gridsize / ctx->options.tileSize;
+   while(tiles.across > 1 && gridsize / tiles.across < maxLen)
+      tiles.across--;
+   tiles.size   = gridsize / tiles.across;
+   tiles.ntiles = tiles.across * tiles.across;
+   tiles.ctx    = ctx;
+   tiles.seed   = seed;
+   atomic_init(&(tiles.next), 0);
+   atomic_init(&(tiles.failed), 0);
+
+   i            = NWords ? NWords : 1;
+   tiles.words  = (char **)malloc(i * sizeof(char *));
+   tiles.places = (WORDPLACE *)malloc(i * sizeof(WORDPLACE));
+   tiles.start  = (int *)calloc(tiles.ntiles + 1, sizeof(int));
+   count        = (int *)calloc(tiles.ntiles, sizeof(int));
+   if(tiles.words == NULL || tiles.places == NULL || tiles.start == NULL ||
+      count == NULL)
+   {
+      free(tiles.words);
+      free(tiles.places);
+      free(tiles.start);
+      free(count);
+      return(WS_NOMEMORY);
+   }
+
+   /* Deal the words: the first ntiles go to tiles 0, 1, 2..., the next
+      ntiles back the other way, and so on
+   */
+   for(i=0; i<NWords; i++)
+   {
+      row = i / tiles.ntiles;
+      t   = i % tiles.ntiles;
+      if(row % 2)
+         t = tiles.ntiles - 1 - t;
+      count[t]++;
+   }
+   for(t=0; t<tiles.ntiles; t++)
+   {
+      tiles.start[t+1] = tiles.start[t] + count[t];
+      count[t]         = tiles.start[t];
+   }
+   for(i=0; i<NWords; i++)
+   {
+      row = i / tiles.ntiles;
+      t   = i % tiles.ntiles;
+      if(row % 2)
+         t = tiles.ntiles - 1 - t;
+      tiles.words[count[t]++] = ctx->words[i];
+   }
+   free(count);
+
+   if(nthreads < 1)
+      nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+   if(nthreads > tiles.ntiles) nthreads = tiles.ntiles;
+   if(nthreads < 1)            nthreads = 1;
+
+   if(!ReserveTilers(ctx, nthreads, tiles.size))
+   {
+      free(tiles.words);
+      free(tiles.places);
+      free(tiles.start);
+      return(WS_NOMEMORY);
+   }
+
+   /* If a thread can't be started the others fill its tiles            */
+   for(i=0; i<nthreads; i++)
+      ctx->tilers[i]->tiling = &tiles;
+   for(i=1; i<nthreads; i++)
+   {
+      if(pthread_create(&(ctx->tileThreads[i]), NULL, TileWorker,
+                        (void *)ctx->tilers[i]))
+         ctx->tilers[i]->tiling = NULL;
+   }
+   TileWorker((void *)ctx->tilers[0]);
+
+   for(i=0; i<nthreads; i++)
+   {
+      if(i && ctx->tilers[i]->tiling != NULL)
+         pthread_join(ctx->tileThreads[i], NULL);
+      if(i == 0 || ctx->tilers[i]->tiling != NULL)
+         wsAddStats(&(ctx->stats), &(ctx->tilers[i]->stats));
+      ctx->tilers[i]->tiling = NULL;
+   }
+   free(tiles.start);
+
+   /* Leave the words in the order they were placed, tile by tile        */
+   memcpy(ctx->words, tiles.words, NWords * sizeof(char *));
+   memcpy(ctx->places, tiles.places, NWords * sizeof(WORDPLACE));
+   free(tiles.words);
+   free(tiles.places);
+
+   switch(atomic_load(&(tiles.failed)))
+   {
+   case TILE_NOFIT:
+      return(WS_NOFIT);
+   case TILE_GAVEUP:
+      return(WS_GAVEUP);
+   case TILE_NOMEMORY:
+      return(WS_NOMEMORY);
+   }
+   return(WS_OK);
+}
+
+/************************************************************************/
+/*>static BOOL ReserveTilers(WSCONTEXT *ctx, int ntilers, int size)
+   ----------------------------------------------------------------
+   Make sure a context has ntilers contexts for filling tiles of size
+   cells. They are kept for the next puzzle, but are made again if the
+   tile size changes. Their options follow the context's. Returns FALSE
+   if memory allocation failed.
+
+   18.10.26 Original    By: agent
+*/
+static BOOL ReserveTilers(WSCONTEXT *ctx, int ntilers, int size)
+{
+   WSCONTEXT **tilers;
+   pthread_t *threads;
+   WSOPTIONS options;
+   int       i;
+
+   options           = ctx->options;
+   options.gridSize  = size;
+   options.maxWords  = 1;
+   options.portfolio = 1;
+   options.tileSize  = 0;
+   options.stats     = FALSE;
+
+   if(ctx->ntilers && ctx->tilers[0]->options.gridSize != size)
+   {
+      for(i=0; i<ctx->ntilers; i++)
+         wsDestroyContext(ctx->tilers[i]);
+      ctx->ntilers = 0;
+   }
+   for(i=0; i<ctx->ntilers; i++)
+      wsUpdateContext(ctx->tilers[i], &options);
+   if(ntilers <= ctx->ntilers)
+      return(TRUE);
+
+   if((tilers = (WSCONTEXT **)realloc(ctx->tilers, 
+                                      ntilers * sizeof(WSCONTEXT *)))
+      ==NULL)
+      return(FALSE);
+   ctx->tilers = tilers;
+   if((threads = (pthread_t *)realloc(ctx->tileThreads,
+                                      ntilers * sizeof(pthread_t)))==NULL)
+      return(FALSE);
+   ctx->tileThreads = threads;
+
+   while(ctx->ntilers < ntilers)
+   {
+      if((ctx->tilers[ctx->ntilers] = wsCreateContext(&options))==NULL)
+         return(FALSE);
+      ctx->ntilers++;
+   }
+
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>static void *TileWorker(void *arg)
+   ----------------------------------
+   Fill tiles of a grid until there are none left or one has failed,
+   copying each into the grid. The work done for all its tiles is left
+   in the context's stats. A tile whose search gives up is tried again
+   with another seed, but one shown to be impossible is not.
+
+   18.10.26 Original    By: agent
+            Tells a tile that cannot be filled from one given up on
+            Copies where the words are into the grid's places
+*/
+static void *TileWorker(void *arg)
+{
+   WSCONTEXT *ctx   = (WSCONTEXT *)arg;
+   WSTILES   *tiles = ctx->tiling;
+   WSCONTEXT *grid  = tiles->ctx;
+   WSSTATS   total;
+   WORDPLACE *place;
+   uint64_t  seed;
+   int       t, attempt, i, y, status,
+             NWords,
+             x0, y0;
+
+   memset(&total, 0, sizeof(WSSTATS));
+
+   while(!atomic_load_explicit(&(tiles->failed), memory_order_relaxed) &&
+         (t = atomic_fetch_add(&(tiles->next), 1)) < tiles->ntiles)
+   {
+      NWords = tiles->start[t+1] - tiles->start[t];
+      status = WS_GAVEUP;
+      for(attempt=0; attempt<TILETRIES && status==WS_GAVEUP; attempt++)
+      {
+         seed = wsPuzzleSeed(wsPuzzleSeed(tiles->seed, t), attempt);
+         if(!PrepareSearch(ctx, tiles->words + tiles->start[t], NWords,
+                           seed, TRUE))
+         {
+            atomic_store(&(tiles->failed), TILE_NOMEMORY);
+            ctx->stats = total;
+            return(NULL);
+         }
+         ctx->budget = TILEBUDGET(NWords);
+         status      = FitWords(ctx);
+         wsAddStats(&total, &(ctx->stats));
+      }
+
+      if(status != WS_OK)
+      {
+         atomic_store(&(tiles->failed), (status == WS_NOFIT) ? 
+                                        TILE_NOFIT : TILE_GAVEUP);
+         break;
+      }
+
+      /* Tiles don't overlap so no lock is needed to copy them in       */
+      x0 = (t % tiles->across) * tiles->size;
+      y0 = (t / tiles->across) * tiles->size;
+      for(y=0; y<tiles->size; y++)
+         memcpy(&CELL(grid->grid, grid->stride, x0, y0 + y),
+                &CELL(ctx->grid, ctx->stride, 0, y), tiles->size);
+      memcpy(tiles->words + tiles->start[t], ctx->words,
+             NWords * sizeof(char *));
+      for(i=0; i<NWords; i++)
+      {
+         place     = &(tiles->places[tiles->start[t] + i]);
+         *place    = ctx->places[i];
+         place->x += x0;
+         place->y += y0;
+      }
+   }
+
+   ctx->stats = total;
+   return(NULL);
+}
+
+/************************************************************************/
+/*>static int AutoGrid(WSCONTEXT *ctx, const WSWORDLIST *list, 
+                       int NWords, uint64_t seed)
+   ---------------------------------------------------------------
+   Build the puzzle in the smallest grid, no larger than the context's
+   size limit, that the words can be fitted in. Every line is at most
+   the grid size long in any direction, so the longest word is a lower
+   bound. However much the words cross, a cell holds one letter, so the
+   grid also needs as many cells of each letter as any one word uses;
+   the sum of these over the letters is a second lower bound. 
+
+   Words seldom cross, so unless options->dense is set no size is tried
+   that lacks a cell for every letter. This is a guess, not a bound: a
+   smaller grid may hold the words if they cross enough, but trying the
+   sizes below it costs far more than it finds. With options->dense
+   only the true bounds are used. From there the grid grows by steps
+   that double until the words fit, then the sizes between the largest
+   that failed and the smallest that fitted are bisected. 
+
+   Each size tried has a budget of AUTOBUDGET() placements, so a size
+   that is too tight fails quickly rather than being searched
+   exhaustively. The grid is resized in the context's own memory, and
+   the best grid found so far is kept aside so it need not be built
+   again. The stats cover every size tried.
+
+   Once the context's deadline has passed no more sizes are tried. 
+
+   Returns WS_OK, WS_NOFIT or WS_GAVEUP, as for the last size tried, if
+   no size up to the limit worked, or WS_NOMEMORY.
+
+   18.10.26 Original    By: agent
+            The lower bounds allow for words crossing and the
+            letter count is only used as a guess
+            Keeps where the words are in the best grid
+*/
+static int AutoGrid(WSCONTEXT *ctx, const WSWORDLIST *list, int NWords,
+                    uint64_t seed)
+{
+   WSSTATS       total;
+   unsigned long budget  = ctx->budget;
+   size_t        cells   = 0,
+                 letters = 0;
+   int           most[256],
+                 count[256],
+                 i, j, lo, hi, gridsize,
+                 step    = 1,
+                 best    = 0,
+                 longest = 1,
+                 status  = WS_NOFIT;
+   const unsigned char *word;
+
+   if(ctx->bestGrid == NULL &&
+      (ctx->bestGrid = (char *)malloc((size_t)ctx->maxGrid * 
+                                      (ctx->maxGrid + 1)))==NULL)
+      return(WS_NOMEMORY);
+
+   memset(most, 0, sizeof(most));
+   memset(count, 0, sizeof(count));
+   for(i=0; i<NWords; i++)
+   {
+      if(list->lengths[i] > longest)
+         longest = list->lengths[i];
+      letters += list->lengths[i];
+      word = (const unsigned char *)list->words[i];
+      for(j=0; j<list->lengths[i]; j++)
+      {
+         if(++count[word[j]] > most[word[j]])
+            most[word[j]] = count[word[j]];
+      }
+      for(j=0; j<list->lengths[i]; j++)
+         count[word[j]] = 0;
+   }
+   for(i=0; i<256; i++)
+      cells += most[i];
+
+   lo = longest;
+   while((size_t)lo * lo < cells)
+      lo++;
+   if(!ctx->options.dense)
+   {
+      while((size_t)lo * lo < letters)
+         lo++;
+   }
+   hi = ctx->sizeLimit;
+
+   memset(&total, 0, sizeof(WSSTATS));
+   ctx->budget = AUTOBUDGET(NWords);
+
+   /* lo is kept one above the largest size that failed and best is the
+      smallest that fitted
+   */
+   for(gridsize=lo; lo<=hi; )
+   {
+      status = TryGrid(ctx, list, NWords, seed, gridsize);
+      wsAddStats(&total, &(ctx->stats));
+      total.gridProbes++;
+
+      if(status == WS_OK)
+      {
+         best = gridsize;
+         hi   = gridsize - 1;
+         memcpy(ctx->bestGrid, ctx->grid, 
+                (size_t)gridsize * ctx->stride);
+         memcpy(ctx->bestWords, ctx->words, NWords * sizeof(char *));
+         memcpy(ctx->bestPlaces, ctx->places, 
+                NWords * sizeof(WORDPLACE));
+      }
+      else if(status == WS_NOFIT || status == WS_GAVEUP)
+      {
+         lo = gridsize + 1;
+      }
+      else
+      {
+         break;
+      }
+
+      if(PASTDEADLINE(ctx))
+         break;
+
+      if(best)
+      {
+         gridsize = (lo + hi) / 2;
+      }
+      else
+      {
+         gridsize = (gridsize + step < hi) ? gridsize + step : hi;
+         step    *= 2;
+      }
+   }
+
+   ctx->budget = budget;
+   if(best && status != WS_NOMEMORY)
+   {
+      status = WS_OK;
+      if(ctx->options.gridSize != best)
+      {
+         ResizeGrid(ctx, best);
+         memcpy(ctx->grid, ctx->bestGrid, (size_t)best * ctx->stride);
+         memcpy(ctx->words, ctx->bestWords, NWords * sizeof(char *));
+         memcpy(ctx->places, ctx->bestPlaces, 
+                NWords * sizeof(WORDPLACE));
+      }
+   }
+   ctx->stats = total;
+
+   return(status);
+}
+
+/************************************************************************/
+/*>static int TryGrid(WSCONTEXT *ctx, const WSWORDLIST *list, 
+                      int NWords, uint64_t seed, int gridsize)
+   -------------------------------------------------------------
+   Try to place the words in a grid of gridsize within the context's
+   budget. Returns WS_OK, WS_NOFIT, WS_GAVEUP or WS_NOMEMORY.
+
+   18.10.26 Original    By: agent
+*/
+static int TryGrid(WSCONTEXT *ctx, const WSWORDLIST *list, int NWords,
+                   uint64_t seed, int gridsize)
+{
+   if(!ResizeGrid(ctx, gridsize) ||
+      !PrepareSearch(ctx, list->words, NWords, seed, TRUE))
+      return(WS_NOMEMORY);
+
+   if(ctx->options.portfolio > 1)
+      return(RaceWords(ctx, list, seed));
+
+   return(FitWords(ctx));
+}
+
+/************************************************************************/
+/*>static int RaceWords(WSCONTEXT *ctx, const WSWORDLIST *list,
+                        uint64_t seed)
+   ------------------------------------------------------------
+   Race options->portfolio searches to place the words. This context
+   runs the same search as it would alone, in this thread. Each of the
+   others runs in its own thread with its own context, a random number
+   stream jumped ahead of the one before's and a different order for
+   words of the same length. The first to finish stops the rest and, if it
+   was not this context, its grid, word order and the places of its
+   words are copied here. The work done by all the searches is added to
+   this context's stats.
+   
+   Each search is exhaustive, so the first to try every arrangement has
+   shown that the words cannot be fitted and the race is over. The other
+   searches are given this context's grid size, budget and deadline. One
+   that uses up its budget or reaches the deadline drops out and leaves
+   the rest running; the race is only given up when all have dropped
+   out.
+
+   Returns WS_OK, WS_NOFIT, WS_GAVEUP or WS_NOMEMORY.
+
+   18.10.26 Original    By: agent
+            Searches share the grid size, budget and deadline
+            Tells giving up from no fit
+            Gives up only when every search has
+            Copies where the winner's words are
+            Each racer's stream is one jump on from the last racer's
+*/
+static int RaceWords(WSCONTEXT *ctx, const WSWORDLIST *list,
+                     uint64_t seed)
+{
+   WSRACE    race;
+   WSCONTEXT *racer;
+   WSRNG     rng;
+   BOOL      *started;
+   int       i, winner,
+             nracers = ctx->options.portfolio - 1;
+
+   if(!ReserveRacers(ctx, nracers) ||
+      (started = (BOOL *)calloc(nracers, sizeof(BOOL)))==NULL)
+      return(WS_NOMEMORY);
+
+   atomic_init(&(race.winner), RACE_RUNNING);
+   atomic_init(&(race.running), nracers + 1);
+   ctx->race  = &race;
+   ctx->racer = 0;
+
+   SeedRandom(&rng, seed);
+   for(i=0; i<nracers; i++)
+   {
+      racer = ctx->racers[i];
+      JumpRandom(&rng);
+      if(!ResizeGrid(racer, ctx->options.gridSize) ||
+         !PrepareSearch(racer, list->words, ctx->NWords, seed, TRUE))
+      {
+         RacerGaveUp(&race);
+         continue;
+      }
+      racer->budget   = ctx->budget;
+      racer->deadline = ctx->deadline;
+      racer->rng      = rng;
+      racer->race  = &race;
+      racer->racer = i + 1;
+
+      /* If a thread can't be started the race goes on without it       */
+      started[i] = !pthread_create(&(ctx->threads[i]), NULL, RaceWorker,
+                                   (void *)racer);
+      if(!started[i])
+         RacerGaveUp(&race);
+   }
+
+   RaceWorker((void *)ctx);
+
+   for(i=0; i<nracers; i++)
+   {
+      racer = ctx->racers[i];
+      if(started[i])
+      {
+         pthread_join(ctx->threads[i], NULL);
+         wsAddStats(&(ctx->stats), &(racer->stats));
+      }
+      racer->race = NULL;
+   }
+   ctx->race = NULL;
+   free(started);
+
+   winner = atomic_load(&(race.winner));
+   if(winner == RACE_NOFIT)
+      return(WS_NOFIT);
+   if(winner < 0)
+      return(WS_GAVEUP);
+
+   if(winner > 0)
+   {
+      racer = ctx->racers[winner - 1];
+      memcpy(ctx->grid, racer->grid, 
+             (size_t)ctx->options.gridSize * ctx->stride);
+      memcpy(ctx->words, racer->words, ctx->NWords * sizeof(char *));
+      memcpy(ctx->places, racer->places, 
+             ctx->NWords * sizeof(WORDPLACE));
+   }
+
+   return(WS_OK);
+}
+
+/************************************************************************/
+/*>static BOOL ReserveRacers(WSCONTEXT *ctx, int nracers)
+   ------------------------------------------------------
+   Make sure a context has nracers contexts for the other searches in a
+   race. They are kept for the next puzzle. Returns FALSE if memory 
+   allocation failed.
+
+   18.10.26 Original    By: agent
+*/
+static BOOL ReserveRacers(WSCONTEXT *ctx, int nracers)
+{
+   WSCONTEXT **racers;
+   pthread_t *threads;
+   WSOPTIONS options;
+
+   if(nracers <= ctx->nracers)
+      return(TRUE);
+
+   if((racers = (WSCONTEXT **)realloc(ctx->racers, 
+                                      nracers * sizeof(WSCONTEXT *)))
+      ==NULL)
+      return(FALSE);
+   ctx->racers = racers;
+   if((threads = (pthread_t *)realloc(ctx->threads,
+                                      nracers * sizeof(pthread_t)))==NULL)
+      return(FALSE);
+   ctx->threads = threads;
+
+   options           = ctx->options;
+   options.gridSize  = ctx->maxGrid;
+   options.portfolio = 1;
+   while(ctx->nracers < nracers)
+   {
+      if((ctx->racers[ctx->nracers] = wsCreateContext(&options))==NULL)
+         return(FALSE);
+      ctx->nracers++;
+   }
+
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>static void *RaceWorker(void *arg)
+   ----------------------------------
+   Run one search in a race and, if it finishes first, record the 
+   result. A search that gives up drops out of the race instead.
+
+   18.10.26 Original    By: agent
+            A search that gives up drops out
+*/
+static void *RaceWorker(void *arg)
+{
+   WSCONTEXT *ctx     = (WSCONTEXT *)arg;
+   int       expected = RACE_RUNNING,
+             status   = FitWords(ctx);
+
+   if(status == WS_OK || status == WS_NOFIT)
+      atomic_compare_exchange_strong(&(ctx->race->winner), &expected,
+                                     (status == WS_OK) ? ctx->racer :
+                                                         RACE_NOFIT);
+   else
+      RacerGaveUp(ctx->race);
+
+   return(NULL);
+}
+
+/************************************************************************/
+/*>static void RacerGaveUp(WSRACE *race)
+   -------------------------------------
+   Take a search out of a race. If it was the last still running, the
+   race is given up.
+
+   18.10.26 Original    By: agent
+*/
+static void RacerGaveUp(WSRACE *race)
+{
+   int expected = RACE_RUNNING;
+
+   if(atomic_fetch_sub(&(race->running), 1) == 1)
+      atomic_compare_exchange_strong(&(race->winner), &expected,
+                                     RACE_GAVEUP);
+}
+
+/************************************************************************/
+/*>static void ShuffleWords(WSCONTEXT *ctx)
+   ----------------------------------------
+   Put the words in a random order. After SortByLength() this leaves
+   words of the same length in a random order.
+
+   18.10.26 Original    By: agent
+*/
+static void ShuffleWords(WSCONTEXT *ctx)
+{
+   char *word;
+   int  i, j;
+
+   for(i=ctx->NWords-1; i>0; i--)
+   {
+      j = RandomNum(&(ctx->rng), i+1);
+      word          = ctx->words[i];
+      ctx->words[i] = ctx->words[j];
+      ctx->words[j] = word;
+   }
+}
+
+/************************************************************************/
+/*>static int FitWords(WSCONTEXT *ctx)
+   -----------------------------------
+   Place words in the grid. This is a depth-first backtracking search:
+   each word in turn takes the next valid placement from its own
+   SEARCHSTATE and, when a word has no placements left, the previous
+   word is lifted out of the grid and moved on to its next placement.
+   Returns WS_OK, WS_NOFIT if every arrangement has been tried, which
+   shows that the words cannot be fitted, or WS_GAVEUP if the search
+   stopped first because the context's budget of placements was used
+   up, the deadline passed or, in a race, another search finished.
+
+   With options->dense, DenseWords() is tried first, DENSETRIES times,
+   and the search is only run if it fails each time.
+
+   With a deadline, the clock is read every DEADLINECHECK steps and the
+   search stops once it has passed. The deepest the search has reached
+   is kept by KeepPartial() for DegradePuzzle().
+
+   Once the words are placed, where each is kept by KeepPlace().
+
+   13.01.94 Original    By: ACRM
+   18.10.26 Modified    By: agent
+            Rewritten as a backtracking search
+            Works on a WSCONTEXT and uses its search state
+            Clears the bitboards
+            Stops when another search in a race finishes
+            Stops when the budget is used up
+            Tries dense placement first
+            Stops at the deadline
+            Tells giving up from no fit
+            Keeps where the words are
+*/
+static int FitWords(WSCONTEXT *ctx)
+{
+   SEARCHSTATE *state = ctx->state;
+   int         depth, i,
+               steps  = 0,
+               NWords = ctx->NWords;
+
+   ctx->npartial = 0;
+   if(NWords <= 0)
+      return(WS_OK);
+
+   if(ctx->racer > 0)
+      ShuffleWords(ctx);
+   SortByLength(ctx->words, NWords, ctx->sortWords);
+   ClearBoards(ctx);
+
+   if(ctx->options.dense)
+      IndexPatterns(ctx);
+   for(i=0; ctx->options.dense && i<DENSETRIES; i++)
+   {
+      if(DenseWords(ctx))
+         return(WS_OK);
+   }
+
+   depth = 0;
+   if(NWords) ResetSearch(ctx, &(state[0]));
+
+   while(depth >= 0 && depth < NWords)
+   {
+      /* Give up if another search in a race has finished or the
+         budget has run out
+      */
+      if(ctx->race != NULL &&
+         atomic_load_explicit(&(ctx->race->winner), 
+                              memory_order_relaxed) != RACE_RUNNING)
+         return(WS_GAVEUP);
+      if(ctx->budget && ctx->stats.placements >= ctx->budget)
+         return(WS_GAVEUP);
+      if(ctx->deadline && ++steps % DEADLINECHECK == 0 && 
+         ClockNs() >= ctx->deadline)
+         return(WS_GAVEUP);
+
+      if(PlaceWord(ctx, &(state[depth]), ctx->words[depth]))
+      {
+         if(++depth > ctx->npartial && ctx->deadline)
+            KeepPartial(ctx, depth);
+         if(depth < NWords)
+            ResetSearch(ctx, &(state[depth]));
+      }
+      else
+      {
+         /* No placements left for this word so back up a level        */
+         if(--depth >= 0)
+            UndoWord(ctx, &(state[depth]));
+      }
+   }
+   if(depth < NWords)
+      return(WS_NOFIT);
+
+   for(i=0; i<NWords; i++)
+      KeepPlace(ctx, i, (int)strlen(ctx->words[i]), 
+                PLACEDCELL(&(state[i])), state[i].step,
+                gDirections[state[i].direction].reversed);
+   return(WS_OK);
+}
+
+/************************************************************************/
+/*>static void KeepPlace(WSCONTEXT *ctx, int i, int len, int cell, 
+                         int step, BOOL reversed)
+   ---------------------------------------------------------------
+   Input:   int   i           Word's place in words[]
+            int   len         Its length
+            int   cell        Grid offset of the first cell written
+            int   step        Grid offset between cells
+            BOOL  reversed    The word was written backwards
+
+   Record where word i of the context is, as the cell of its first 
+   letter and the direction it reads in, which do not change if the 
+   grid grows
+
+   18.10.26 Original    By: agent
+*/
+static void KeepPlace(WSCONTEXT *ctx, int i, int len, int cell, int step,
+                      BOOL reversed)
+{
+   WORDPLACE *place = &(ctx->places[i]);
+   int       d;
+
+   if(reversed)
+   {
+      cell += (len - 1) * step;
+      step  = -step;
+   }
+   for(d=0; d<NDIRECTIONS-1 &&
+       gDirections[d].dy * ctx->stride + gDirections[d].dx != step; d++);
+
+   place->x         = cell % ctx->stride;
+   place->y         = cell / ctx->stride;
+   place->direction = d;
+}
+
+/************************************************************************/
+/*>static void KeepPartial(WSCONTEXT *ctx, int depth)
+   --------------------------------------------------
+   Record where the search has put the first depth words, as the most it
+   has placed so far
+
+   18.10.26 Original    By: agent
+*/
+static void KeepPartial(WSCONTEXT *ctx, int depth)
+{
+   SEARCHSTATE *state;
+   int         i;
+
+   for(i=0; i<depth; i++)
+   {
+      state = &(ctx->state[i]);
+      ctx->partial[i].cell     = PLACEDCELL(state);
+      ctx->partial[i].step     = state->step;
+      ctx->partial[i].reversed = gDirections[state->direction].reversed;
+   }
+   ctx->npartial = depth;
+}
+
+/************************************************************************/
+/*>static int DegradePuzzle(WSCONTEXT *ctx)
+   ----------------------------------------
+   Make what can be made of a puzzle whose deadline has passed, as
+   options->fallback says:
+      WS_FALLBACK_NONE     Nothing; returns WS_TIMEOUT
+      WS_FALLBACK_PARTIAL  Put back the most words the search placed
+      WS_FALLBACK_DROP     and try each of the others once more where
+                           they are, without moving any
+      WS_FALLBACK_GROW     and while some are left, grow the grid by a
+                           row and a column and try them again
+   The words left over are dropped. The words placed come first in
+   words[] and the NWords of the context is cut to them, so the puzzle
+   and its word list agree; those dropped follow. Each of these is a
+   single pass with no backtracking, so it takes little time. Where
+   each word placed is goes to KeepPlace().
+
+   Returns WS_OK or WS_TIMEOUT.
+
+   18.10.26 Original    By: agent
+            Keeps where the words are
+*/
+static int DegradePuzzle(WSCONTEXT *ctx)
+{
+   PLACEMENT   *placement;
+   SEARCHSTATE *state;
+   char        *word;
+   int         i, j, s, len, placed;
+
+   if(ctx->options.fallback == WS_FALLBACK_NONE)
+      return(WS_TIMEOUT);
+
+   for(i=0; i<ctx->options.gridSize; i++)
+      memset(ctx->grid + (size_t)i * ctx->stride, ' ', 
+             ctx->options.gridSize);
+   ClearBoards(ctx);
+   for(i=0; i<ctx->npartial; i++)
+   {
+      placement = &(ctx->partial[i]);
+      word      = ctx->words[i];
+      len       = strlen(word);
+      KeepPlace(ctx, i, len, placement->cell, placement->step,
+                placement->reversed);
+      for(j=0, s=placement->cell; j<len; j++, s+=placement->step)
+      {
+         if(ctx->grid[s] == ' ')
+         {
+            ctx->grid[s] = placement->reversed ? word[len-1-j] : word[j];
+            SetBoardCell(ctx, s, ctx->grid[s], TRUE);
+         }
+      }
+   }
+   placed = ctx->npartial;
+
+   while(ctx->options.fallback != WS_FALLBACK_PARTIAL)
+   {
+      for(i=placed; i<ctx->NWords; i++)
+      {
+         state = &(ctx->state[placed]);
+         ResetSearch(ctx, state);
+         if(PlaceWord(ctx, state, ctx->words[i]))
+         {
+            KeepPlace(ctx, placed, (int)strlen(ctx->words[i]),
+                      PLACEDCELL(state), state->step,
+                      gDirections[state->direction].reversed);
+            word                = ctx->words[i];
+            ctx->words[i]       = ctx->words[placed];
+            ctx->words[placed++] = word;
+         }
+      }
+      if(placed == ctx->NWords || 
+         ctx->options.fallback != WS_FALLBACK_GROW || !GrowGrid(ctx))
+         break;
+   }
+
+   ctx->ndropped = ctx->NWords - placed;
+   ctx->NWords   = placed;
+   return(WS_OK);
+}
+
+/************************************************************************/
+/*>static BOOL GrowGrid(WSCONTEXT *ctx)
+   ------------------------------------
+   Add a blank row and column to the grid, keeping the words in it, and
+   bring the bitboards up to date. The rows are moved out to the new
+   stride in place, last first so that none is overwritten. Returns 
+   FALSE if the context's memory has no room for a larger grid or
+   memory allocation failed.
+
+   18.10.26 Original    By: agent
+*/
+static BOOL GrowGrid(WSCONTEXT *ctx)
+{
+   char *row;
+   int  x, y,
+        gridsize = ctx->options.gridSize;
+
+   if(gridsize >= ctx->maxGrid)
+      return(FALSE);
+
+   for(y=gridsize-1; y>0; y--)
+      memmove(ctx->cells + (size_t)y * (gridsize + 2),
+              ctx->cells + (size_t)y * (gridsize + 1), gridsize);
+
+   ctx->options.gridSize = ++gridsize;
+   ctx->stride           = gridsize + 1;
+   ctx->solution         = ctx->cells + (size_t)gridsize * ctx->stride;
+   for(y=0; y<gridsize; y++)
+   {
+      row = ctx->grid + (size_t)y * ctx->stride;
+      if(y == gridsize - 1)
+         memset(row, ' ', gridsize);
+      row[gridsize-1] = ' ';
+      row[gridsize]   = '\0';
+   }
+
+   if(!BuildBoardLines(ctx) || !ReserveBoards(ctx))
+      return(FALSE);
+   SetDirections(ctx);
+   ClearBoards(ctx);
+   for(y=0; y<gridsize; y++)
+   {
+      row = ctx->grid + (size_t)y * ctx->stride;
+      for(x=0; x<gridsize; x++)
+      {
+         if(row[x] != ' ')
+            SetBoardCell(ctx, (int)(row - ctx->grid) + x, row[x], TRUE);
+      }
+   }
+
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>static BOOL ReservePatterns(WSCONTEXT *ctx)
+   --------------------------------------------
+   Make sure there is room for the pattern index of the context's words
+   used by the dense option. Returns FALSE if memory allocation failed.
+
+   18.10.26 Original    By: agent
+*/
+static BOOL ReservePatterns(WSCONTEXT *ctx)
+{
+   uint64_t *patterns;
+   size_t   size;
+   int      i;
+
+   ctx->patternLen = 0;
+   for(i=0; i<ctx->NWords; i++)
+   {
+      if((int)strlen(ctx->words[i]) > ctx->patternLen)
+         ctx->patternLen = (int)strlen(ctx->words[i]);
+   }
+   ctx->patternWords = (int)MAPWORDS(ctx->NWords ? ctx->NWords : 1);
+
+   /* The postings and then the live and match sets                     */
+   size = ((size_t)ctx->patternLen * ctx->nplanes + 2) * ctx->patternWords;
+   if(size > ctx->maxPatterns)
+   {
+      if((patterns = (uint64_t *)realloc(ctx->patterns,
+                                         size * sizeof(uint64_t)))==NULL)
+         return(FALSE);
+      ctx->patterns    = patterns;
+      ctx->maxPatterns = size;
+   }
+   ctx->live  = ctx->patterns + size - 2 * ctx->patternWords;
+   ctx->match = ctx->live + ctx->patternWords;
+
+   if(ctx->options.gridSize >= ctx->maxLetters)
+   {
+      free(ctx->letters);
+      if((ctx->letters = (int *)malloc((ctx->options.gridSize + 1) *
+                                       sizeof(int)))==NULL)
+      {
+         ctx->maxLetters = 0;
+         return(FALSE);
+      }
+      ctx->maxLetters = ctx->options.gridSize + 1;
+   }
+
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>static void IndexPatterns(WSCONTEXT *ctx)
+   -----------------------------------------
+   Build the pattern index of the words in their present order. For each
+   position in a word and each bitboard plane there is a set of the
+   words with that character at that position, with bit n for word n.
+   Once the words are sorted by length, the words matching a pattern
+   such as ?A??E are the AND of the sets for A at 1 and E at 4 with a
+   run of bits, those of length 5.
+
+   18.10.26 Original    By: agent
+*/
+static void IndexPatterns(WSCONTEXT *ctx)
+{
+   int           i, j;
+   unsigned char *ch;
+
+   memset(ctx->patterns, 0, (size_t)ctx->patternLen * ctx->nplanes *
+                            ctx->patternWords * sizeof(uint64_t));
+   for(i=0; i<ctx->NWords; i++)
+   {
+      for(j=0, ch=(unsigned char *)ctx->words[i]; *ch; j++, ch++)
+         POSTING(ctx, j, ctx->plane[*ch])[i / BOARDBITS] |= 
+            (uint64_t)1 << (i % BOARDBITS);
+   }
+}
+
+/************************************************************************/
+/*>static BOOL DenseWords(WSCONTEXT *ctx)
+   --------------------------------------
+   Place the words, longest first, each where it shares the most letters
+   with the words already placed. The candidates are found by reading
+   each stretch of a line holding a letter as a pattern and looking up
+   the words of the length being placed that match it in the pattern
+   index, which BestOverlap() does for every stretch in one pass. A word
+   of that length with the most shared letters is placed there, with
+   ties broken at random. When no word of the length crosses a letter,
+   one is placed at random by PlaceWord(). There is no backtracking:
+   if a word cannot be placed the words placed are taken out again and
+   FALSE is returned. On success the words are left in placement order
+   and where each is has been kept by KeepPlace().
+
+   The words must have been sorted by length before the pattern index
+   was built.
+
+   18.10.26 Original    By: agent
+            Keeps where the words are
+*/
+static BOOL DenseWords(WSCONTEXT *ctx)
+{
+   SEARCHSTATE *state;
+   char        *word;
+   int         depth, lo, hi, len, i, w, s, step, shared;
+
+   for(depth=0, lo=0; lo<ctx->NWords; lo=hi)
+   {
+      len = (int)strlen(ctx->words[lo]);
+      for(hi=lo; hi<ctx->NWords && (int)strlen(ctx->words[hi])==len; hi++);
+
+      memset(ctx->live, 0, ctx->patternWords * sizeof(uint64_t));
+      for(i=lo; i<hi; i++)
+         ctx->live[i / BOARDBITS] |= (uint64_t)1 << (i % BOARDBITS);
+
+      for(; depth<hi; depth++)
+      {
+         state = &(ctx->state[depth]);
+         if((shared = BestOverlap(ctx, len, &w, &s, &step)) == 0)
+         {
+            /* Nothing to cross, so any word of the length will do      */
+            for(w=lo; !(ctx->live[w / BOARDBITS] & 
+                        ((uint64_t)1 << (w % BOARDBITS))); w++);
+            ResetSearch(ctx, state);
+            if(!PlaceWord(ctx, state, ctx->words[w]))
+               break;
+            KeepPlace(ctx, depth, len, PLACEDCELL(state), state->step,
+                      gDirections[state->direction].reversed);
+         }
+         else
+         {
+            ctx->stats.placements++;
+            ctx->stats.lengthTries[StatLength(len)]++;
+            KeepPlace(ctx, depth, len, s, step, FALSE);
+            state->nfilled = 0;
+            for(i=0, word=ctx->words[w]; i<len; i++, s+=step)
+            {
+               if(ctx->grid[s] == ' ')
+               {
+                  ctx->grid[s] = word[i];
+                  SetBoardCell(ctx, s, word[i], TRUE);
+                  state->filled[state->nfilled++] = s;
+               }
+            }
+         }
+         ctx->live[w / BOARDBITS] &= ~((uint64_t)1 << (w % BOARDBITS));
+         ctx->sortWords[depth] = ctx->words[w];
+      }
+      if(depth < hi)
+      {
+         while(--depth >= 0)
+            UndoWord(ctx, &(ctx->state[depth]));
+         return(FALSE);
+      }
+   }
+
+   memcpy(ctx->words, ctx->sortWords, ctx->NWords * sizeof(char *));
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>static int BestOverlap(WSCONTEXT *ctx, int len, int *word, int *start,
+                          int *step)
+   ----------------------------------------------------------------------
+   Input:   int   len         Length of the words in ctx->live
+   Output:  int   *word       The word to place
+            int   *start      Grid offset of its first letter
+            int   *step       Grid offset from one letter to the next
+   Returns: int               Letters it shares, 0 if no word crosses a
+                              letter without lying wholly on others
+
+   Find the placement of a live word that shares the most letters with
+   the grid. The letters on each line of the directions in use are
+   counted first so that stretches of len cells which could not beat
+   the best so far are passed over. The others are read as a pattern
+   from a word's first letter, keeping the set of live words that match
+   so far. The set only ever shrinks, so a stretch is dropped as soon
+   as it is empty. Ties between stretches and between the words
+   matching one are broken by reservoir sampling.
+
+   18.10.26 Original    By: agent
+*/
+static int BestOverlap(WSCONTEXT *ctx, int len, int *word, int *start,
+                       int *step)
+{
+   uint64_t *match   = ctx->match,
+            any;
+   int      *letters = ctx->letters,
+            d, line, last, length, forward, x0, y0, xstep, ystep,
+            a, i, n, t, cell, dstep, shared, count, pick,
+            best   = 0,
+            nties  = 0,
+            nwords = ctx->patternWords;
+   BOOL     reversed;
+
+   for(d=0; d<ctx->ndirs; d++)
+   {
+      reversed = gDirections[ctx->dirs[d]].reversed;
+      last     = ctx->dirBase[d] + ctx->dirLines[d];
+      for(line=ctx->dirBase[d]; line<last; line++)
+      {
+         length = GetLine(ctx->options.gridSize, line, &forward,
+                          &x0, &y0, &xstep, &ystep);
+         dstep  = ystep * ctx->stride + xstep;
+         if(length < len)
+            continue;
+
+         for(t=0, cell=y0*ctx->stride+x0, letters[0]=0; t<length; 
+             t++, cell+=dstep)
+            letters[t+1] = letters[t] + (ctx->grid[cell] != ' ');
+         if(letters[length] < best)
+            continue;
+         if(reversed)
+            dstep = -dstep;
+
+         /* Letter i of a word is at cell a+i of the line, or a-i if the
+            word runs backwards along it
+         */
+         for(a=(reversed ? len-1 : 0); 
+             a<(reversed ? length : length-len+1); a++)
+         {
+            t      = reversed ? a - len + 1 : a;
+            shared = letters[t+len] - letters[t];
+            if(shared == 0 || shared == len || shared < best)
+               continue;
+
+            memcpy(match, ctx->live, nwords * sizeof(uint64_t));
+            cell = (y0 + ystep * a) * ctx->stride + x0 + xstep * a;
+            for(i=0; i<len; i++, cell+=dstep)
+            {
+               if(ctx->grid[cell] == ' ')
+                  continue;
+               for(n=0, any=0; n<nwords; n++)
+                  any |= (match[n] &= POSTING(ctx, i, 
+                             ctx->plane[(unsigned char)ctx->grid[cell]])
+                             [n]);
+               if(!any)
+                  break;
+            }
+            if(i < len)
+               continue;
+
+            for(n=0, count=0; n<nwords; n++)
+               count += CountBits(match[n]);
+            if(shared > best)
+            {
+               best  = shared;
+               nties = 0;
+            }
+            nties += count;
+            if(RandomNum(&(ctx->rng), nties) >= count)
+               continue;
+
+            /* This stretch wins; take one of its words at random       */
+            pick = RandomNum(&(ctx->rng), count);
+            for(n=0; CountBits(match[n]) <= pick; n++)
+               pick -= CountBits(match[n]);
+            for(t=0; t<pick; t++)
+               match[n] &= match[n] - 1;
+            *word  = n * BOARDBITS + LowestBit(match[n]);
+            *start = (y0 + ystep * a) * ctx->stride + x0 + xstep * a;
+            *step  = dstep;
+         }
+      }
+   }
+
+   return(best);
+}
+
+/************************************************************************/
+/*>static void ResetSearch(WSCONTEXT *ctx, SEARCHSTATE *state)
+   -----------------------------------------------------------
+   Prepare a word's search state so that all lines in all directions
+   will be visited. The lines are visited in the order given by a random
+   affine permutation, (a*i + b) mod nlines, with a coprime to nlines;
+   this gives a random-looking order without needing to store it.
+
+   18.10.26 Original    By: agent
+            Visits the lines of the directions in use
+*/
+static void ResetSearch(WSCONTEXT *ctx, SEARCHSTATE *state)
+{
+   int g, h, t;
+
+   state->nlines  = ctx->nvisits;
+   state->line    = 0;
+   state->nstarts = 0;
+   state->next    = 0;
+   state->nfilled = 0;
+   state->b       = RandomNum(&(ctx->rng), state->nlines);
+
+   do
+   {
+      state->a = 1 + RandomNum(&(ctx->rng), state->nlines - 1);
+      for(g=state->a, h=state->nlines; h; t=g%h, g=h, h=t);
+   }  while(g != 1);
+}
+
+/************************************************************************/
+/*>static int GetLine(int gridsize, int index, int *direction, int *x0,
+                      int *y0, int *xstep, int *ystep)
+   --------------------------------------------------------------------
+   Input:   int   gridsize    Size of the grid
+            int   index       Line number (0 ... 6*gridsize-3)
+   Output:  int   *direction  Forward direction of the line
+            int   *x0         Start of line
+            int   *y0
+            int   *xstep      Step along the line
+            int   *ystep
+   Returns: int               Length of the line
+
+   Lines 0..gridsize-1 are rows, the next gridsize are columns, the
+   next 2*gridsize-1 are the diagonals running down-right and the
+   remaining 2*gridsize-1 are the diagonals running up-right.
+
+   18.10.26 Original    By: agent
+            Added the up-right diagonals
+*/
+static int GetLine(int gridsize, int index, int *direction, int *x0,
+                   int *y0, int *xstep, int *ystep)
+{
+   int offset;
+
+   if(index < gridsize)
+   {
+      *direction = DIR_E;
+      *x0 = 0;       *y0 = index;
+      *xstep = 1;    *ystep = 0;
+      return(gridsize);
+   }
+   index -= gridsize;
+
+   if(index < gridsize)
+   {
+      *direction = DIR_S;
+      *x0 = index;   *y0 = 0;
+      *xstep = 0;    *ystep = 1;
+      return(gridsize);
+   }
+   index -= gridsize;
+
+   if(index < 2 * gridsize - 1)
+   {
+      /* Diagonal with x - y == offset                                  */
+      offset = index - (gridsize - 1);
+      *direction = DIR_SE;
+      *x0 = (offset > 0) ?  offset : 0;
+      *y0 = (offset < 0) ? -offset : 0;
+      *xstep = 1;    *ystep = 1;
+      return(gridsize - abs(offset));
+   }
+   index -= 2 * gridsize - 1;
+
+   /* Diagonal with x + y == index                                      */
+   offset = index - (gridsize - 1);
+   *direction = DIR_NE;
+   *x0 = (offset > 0) ? offset : 0;
+   *y0 = index - *x0;
+   *xstep = 1;       *ystep = -1;
+   return(gridsize - abs(offset));
+}
+
+/************************************************************************/
+/*>static int FamilyLines(int gridsize, int family, int *first)
+   ------------------------------------------------------------
+   Input:   int   gridsize    Size of the grid
+            int   family      FAM_ROW, FAM_COL, FAM_DIAG or FAM_ANTI
+   Output:  int   *first      Number of its first line, as for GetLine()
+   Returns: int               Number of lines in the family
+
+   18.10.26 Original    By: agent
+*/
+static int FamilyLines(int gridsize, int family, int *first)
+{
+   switch(family)
+   {
+   case FAM_ROW:
+      *first = 0;
+      return(gridsize);
+   case FAM_COL:
+      *first = gridsize;
+      return(gridsize);
+   case FAM_DIAG:
+      *first = 2 * gridsize;
+      return(2 * gridsize - 1);
+   default:
+      *first = 4 * gridsize - 1;
+      return(2 * gridsize - 1);
+   }
+}
+
+/************************************************************************/
+/*>static void SetDirections(WSCONTEXT *ctx)
+   -----------------------------------------
+   List the directions in options->directions and the lines each one
+   visits. A search visits every line once for each direction that runs
+   along it, so the visits are numbered through the directions in the
+   order of their WS_DIR_ bits. With the default directions this is the
+   order of the lines themselves.
+
+   18.10.26 Original    By: agent
+*/
+static void SetDirections(WSCONTEXT *ctx)
+{
+   int i, family,
+       directions = ctx->options.directions;
+
+   if(!(directions & WS_DIR_ALL))
+      directions = WS_DIRECTIONS;
+
+   ctx->ndirs    = 0;
+   ctx->nvisits  = 0;
+   ctx->families = 0;
+   for(i=0; i<NDIRECTIONS; i++)
+   {
+      if(directions & (1 << i))
+      {
+         family = gDirections[i].family;
+         ctx->dirs[ctx->ndirs]     = i;
+         ctx->dirLines[ctx->ndirs] = 
+            FamilyLines(ctx->options.gridSize, family,
+                        &(ctx->dirBase[ctx->ndirs]));
+         ctx->nvisits  += ctx->dirLines[ctx->ndirs];
+         ctx->families |= 1 << family;
+         ctx->ndirs++;
+      }
+   }
+}
+
+/************************************************************************/
+/*>static int VisitLine(WSCONTEXT *ctx, int visit, int *direction)
+   ---------------------------------------------------------------
+   Input:   int   visit       Visit number (0 ... ctx->nvisits-1)
+   Output:  int   *direction  Direction the word runs in
+   Returns: int               Line number, as for GetLine()
+
+   18.10.26 Original    By: agent
+*/
+static int VisitLine(WSCONTEXT *ctx, int visit, int *direction)
+{
+   int i;
+
+   for(i=0; i<ctx->ndirs-1 && visit >= ctx->dirLines[i]; i++)
+      visit -= ctx->dirLines[i];
+
+   *direction = ctx->dirs[i];
+   return(ctx->dirBase[i] + visit);
+}
+
+/************************************************************************/
+/*>static BOOL PlaceWord(WSCONTEXT *ctx, SEARCHSTATE *state, char *word)
+   ---------------------------------------------------------------------
+   Place a word in the grid at the next valid placement recorded in its
+   search state. Any placement previously made for this word must
+   already have been undone. Returns FALSE when all placements have been
+   tried.
+
+   13.01.94 Original    By: ACRM
+   12.07.01 Fixed bug in selecting random numbers on diagonals.
+   18.10.26 Modified    By: agent
+            Now steps through every valid placement in random order
+            rather than making MAXTRY random guesses
+            Walks the flat grid with a single step per line
+            Finds the valid starts from the bitboards
+            Counts the starts rejected on each line
+            Runs in any direction. Reversed directions write the word
+            backwards along the line
+*/
+static BOOL PlaceWord(WSCONTEXT *ctx, SEARCHSTATE *state, char *word)
+{
+   int   i, j,
+         s,
+         len,
+         line,
+         length,
+         outside,
+         forward,
+         x0, y0,
+         xstep, ystep;
+   BOOL  reversed;
+
+   len = strlen(word);
+
+   while(state->next >= state->nstarts)
+   {
+      if(state->line >= state->nlines)
+         return(FALSE);
+
+      /* Move on to the next line and list the starts where it fits     */
+      line = VisitLine(ctx, (int)(((long)state->a * state->line + 
+                                   state->b) % state->nlines),
+                       &(state->direction));
+      length = GetLine(ctx->options.gridSize, line, &forward,
+                       &x0, &y0, &xstep, &ystep);
+      state->origin  = y0 * ctx->stride + x0;
+      state->step    = ystep * ctx->stride + xstep;
+      state->line++;
+      state->nstarts = ValidStarts(ctx, line, word, len, 
+                                   gDirections[state->direction].reversed,
+                                   state->starts);
+      state->next    = 0;
+
+      /* Every other cell on the line was rejected as a start. Those in
+         the last len-1 would run off the end; the rest clash
+      */
+      outside = (len - 1 < length) ? len - 1 : length;
+      ctx->stats.lines++;
+      ctx->stats.outOfBounds += outside;
+      ctx->stats.conflicts   += length - outside - state->nstarts;
+      ctx->stats.rejected[state->direction] += length - state->nstarts;
+
+      /* Shuffle the starts                                             */
+      for(i=state->nstarts-1; i>0; i--)
+      {
+         j = RandomNum(&(ctx->rng), i+1);
+         s = state->starts[i];
+         state->starts[i] = state->starts[j];
+         state->starts[j] = s;
+      }
+   }
+
+   /* Put in the word, remembering which cells were blank               */
+   ctx->stats.placements++;
+   ctx->stats.lengthTries[StatLength(len)]++;
+   reversed = gDirections[state->direction].reversed;
+   s = state->origin + state->starts[state->next++] * state->step;
+   state->nfilled = 0;
+   for(i=0; i<len; i++, s += state->step)
+   {
+      if(ctx->grid[s] == ' ')
+      {
+         ctx->grid[s] = reversed ? word[len-1-i] : word[i];
+         SetBoardCell(ctx, s, ctx->grid[s], TRUE);
+         state->filled[state->nfilled++] = s;
+      }
+   }
+
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>static void UndoWord(WSCONTEXT *ctx, SEARCHSTATE *state)
+   --------------------------------------------------------
+   Remove the word last placed from this search state, blanking only the
+   cells it filled (crossing letters belong to earlier words).
+
+   18.10.26 Original    By: agent
+*/
+static void UndoWord(WSCONTEXT *ctx, SEARCHSTATE *state)
+{
+   int i;
+
+   ctx->stats.backtracks++;
+   for(i=0; i<state->nfilled; i++)
+   {
+      SetBoardCell(ctx, state->filled[i], ctx->grid[state->filled[i]],
+                   FALSE);
+      ctx->grid[state->filled[i]] = ' ';
+   }
+   state->nfilled = 0;
+}
+
+/************************************************************************/
+/*>static BOOL BuildBoardLines(WSCONTEXT *ctx)
+   -------------------------------------------
+   Lay out the bitboards. Every line that GetLine() can return has a
+   block of planes: the blank plane followed by one plane per character
+   in the word list. Bit n of a plane is cell n along the line. Each
+   plane has a spare zero word at the end so that a word's worth of bits
+   may be read starting at any cell. The lines are allocated on the
+   first call for the largest grid the context may have. Returns FALSE
+   if memory allocation failed.
+
+   18.10.26 Original    By: agent
+            Lays out the up-right diagonals too
+            Allocates the lines only once
+*/
+static BOOL BuildBoardLines(WSCONTEXT *ctx)
+{
+   int    i, direction, x0, y0, xstep, ystep,
+          nlines = NLINES(ctx->maxGrid);
+   size_t base   = 0;
+
+   if(nlines < 1)
+      nlines = 1;
+   if(ctx->lines == NULL &&
+      (ctx->lines = (BOARDLINE *)malloc(nlines * sizeof(BOARDLINE)))
+      ==NULL)
+      return(FALSE);
+
+   nlines = NLINES(ctx->options.gridSize);
+   if(nlines < 1)
+      nlines = 1;
+
+   for(i=0; i<nlines; i++)
+   {
+      ctx->lines[i].length = (ctx->options.gridSize > 0) ?
+         GetLine(ctx->options.gridSize, i, &direction, &x0, &y0, 
+                 &xstep, &ystep) : 0;
+      ctx->lines[i].nwords = ctx->lines[i].length / BOARDBITS + 2;
+      ctx->lines[i].base   = base;
+      base += ctx->lines[i].nwords;
+   }
+   ctx->lineWords = base;
+
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>static BOOL ReserveBoards(WSCONTEXT *ctx)
+   ------------------------------------------
+   Give each character in the puzzle's words its own bitboard plane and
+   make sure there is room for them all. Returns FALSE if memory 
+   allocation failed.
+
+   18.10.26 Original    By: agent
+*/
+static BOOL ReserveBoards(WSCONTEXT *ctx)
+{
+   uint64_t      *boards;
+   size_t        size;
+   int           i;
+   unsigned char *ch;
+
+   memset(ctx->plane, EMPTYPLANE, sizeof(ctx->plane));
+   ctx->nplanes = 1;
+   for(i=0; i<ctx->NWords; i++)
+   {
+      for(ch=(unsigned char *)ctx->words[i]; *ch; ch++)
+      {
+         if(*ch != ' ' && ctx->plane[*ch] == EMPTYPLANE)
+            ctx->plane[*ch] = (unsigned char)(ctx->nplanes++);
+      }
+   }
+
+   size = ctx->nplanes * ctx->lineWords;
+   if(size <= ctx->maxBoards)
+      return(TRUE);
+
+   if((boards = (uint64_t *)realloc(ctx->boards, 
+                                    size * sizeof(uint64_t)))==NULL)
+      return(FALSE);
+   ctx->boards    = boards;
+   ctx->maxBoards = size;
+
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>static void ClearBoards(WSCONTEXT *ctx)
+   ---------------------------------------
+   Set the bitboards for an empty grid: every cell is in the blank plane
+   and no other. Only the lines of the families in use are cleared;
+   each family's planes are contiguous.
+
+   18.10.26 Original    By: agent
+            Clears only the families in use
+*/
+static void ClearBoards(WSCONTEXT *ctx)
+{
+   BOARDLINE *line;
+   uint64_t  *empty;
+   size_t    start, end;
+   int       f, i, n, first, nlines;
+
+   for(f=0; f<NFAMILIES; f++)
+   {
+      nlines = FamilyLines(ctx->options.gridSize, f, &first);
+      if(!(ctx->families & (1 << f)) || nlines < 1)
+         continue;
+      start = ctx->lines[first].base;
+      end   = ctx->lines[first+nlines-1].base + 
+              ctx->lines[first+nlines-1].nwords;
+      memset(ctx->boards + start * ctx->nplanes, 0, 
+             (end - start) * ctx->nplanes * sizeof(uint64_t));
+
+      for(i=first; i<first+nlines; i++)
+      {
+         line  = &(ctx->lines[i]);
+         empty = ctx->boards + line->base * ctx->nplanes;
+         for(n=0; n<line->length/BOARDBITS; n++)
+            empty[n] = ~(uint64_t)0;
+         if(line->length % BOARDBITS)
+            empty[n] = ((uint64_t)1 << (line->length % BOARDBITS)) - 1;
+      }
+   }
+}
+
+/************************************************************************/
+/*>static void SetBoardCell(WSCONTEXT *ctx, int offset, char ch, 
+                            BOOL set)
+   -------------------------------------------------------------
+   Input:   int  offset  Grid offset of the cell
+            char ch      The character placed in or lifted from the cell
+            BOOL set     TRUE if ch is being placed, FALSE if lifted
+
+   Update the bitboards of the lines through a cell when it is filled or
+   blanked. Only the families of lines in use are kept up to date.
+
+   18.10.26 Original    By: agent
+            Added the up-right diagonals
+*/
+static void SetBoardCell(WSCONTEXT *ctx, int offset, char ch, BOOL set)
+{
+   BOARDLINE *line;
+   uint64_t  *empty, *plane, bit;
+   int       x, y, i,
+             index[NFAMILIES],
+             pos[NFAMILIES],
+             gridsize = ctx->options.gridSize,
+             p        = ctx->plane[(unsigned char)ch];
+
+   /* A blank in a word leaves the cell blank                           */
+   if(p == EMPTYPLANE)
+      return;
+
+   x = offset % ctx->stride;
+   y = offset / ctx->stride;
+   index[FAM_ROW]  = y;
+   pos[FAM_ROW]    = x;
+   index[FAM_COL]  = gridsize + x;
+   pos[FAM_COL]    = y;
+   index[FAM_DIAG] = 3 * gridsize - 1 + x - y;
+   pos[FAM_DIAG]   = (x < y) ? x : y;
+   index[FAM_ANTI] = 4 * gridsize - 1 + x + y;
+   pos[FAM_ANTI]   = (x + y > gridsize - 1) ? gridsize - 1 - y : x;
+
+   for(i=0; i<NFAMILIES; i++)
+   {
+      if(!(ctx->families & (1 << i)))
+         continue;
+      line  = &(ctx->lines[index[i]]);
+      empty = ctx->boards + line->base * ctx->nplanes + 
+              pos[i] / BOARDBITS;
+      plane = empty + (size_t)p * line->nwords;
+      bit   = (uint64_t)1 << (pos[i] % BOARDBITS);
+
+      if(set)
+      {
+         *empty &= ~bit;
+         *plane |= bit;
+      }
+      else
+      {
+         *empty |= bit;
+         *plane &= ~bit;
+      }
+   }
+}
+
+/************************************************************************/
+/*>static int ValidStarts(WSCONTEXT *ctx, int line, const char *word,
+                          int len, BOOL reversed, int *starts)
+   ------------------------------------------------------------------
+   Input:   int        line    Line number as for GetLine()
+            const char *word   The word to fit
+            int        len     Its length
+            BOOL       reversed  Fit the word backwards along the line
+   Output:  int        *starts The start positions at which it fits,
+                               in increasing order
+   Returns: int                Number of starts
+
+   Find every start along a line where a word fits. A cell can take the
+   word's i'th letter if it is in the blank plane or that letter's
+   plane, so shifting that pair of planes down by i gives a mask of the
+   starts where letter i fits. ANDing the masks for all the letters
+   tests BOARDBITS starts at a time. A word running against the line is
+   fitted as its reverse, so each start is the cell of its last letter.
+
+   18.10.26 Original    By: agent
+            Added reversed
+*/
+static int ValidStarts(WSCONTEXT *ctx, int line, const char *word,
+                       int len, BOOL reversed, int *starts)
+{
+   BOARDLINE *bl    = &(ctx->lines[line]);
+   uint64_t  *empty = ctx->boards + bl->base * ctx->nplanes,
+             *plane,
+             mask, bits;
+   int       nstarts = 0,
+             last    = bl->length - len,
+             i, n, q, r;
+
+   if(last < 0)
+      return(0);
+
+   for(n=0; n<=last/BOARDBITS; n++)
+   {
+      mask = ~(uint64_t)0;
+      for(i=0; i<len && mask; i++)
+      {
+         plane = empty + 
+                 (size_t)ctx->plane[(unsigned char)
+                                    word[reversed ? len-1-i : i]] * 
+                 bl->nwords;
+         q     = n + i / BOARDBITS;
+         r     = i % BOARDBITS;
+         bits  = empty[q] | plane[q];
+         if(r)
+            bits = (bits >> r) | 
+                   ((empty[q+1] | plane[q+1]) << (BOARDBITS - r));
+         mask &= bits;
+      }
+
+      /* Drop starts past the last one at which the word fits           */
+      if(n == last/BOARDBITS && (last % BOARDBITS) != BOARDBITS - 1)
+         mask &= ((uint64_t)1 << (last % BOARDBITS + 1)) - 1;
+
+      for(; mask; mask &= mask - 1)
+         starts[nstarts++] = n * BOARDBITS + LowestBit(mask);
+   }
+
+   return(nstarts);
+}
+
+/************************************************************************/
+/*>static int LowestBit(uint64_t bits)
+   -----------------------------------
+   Returns the index of the lowest set bit in a non-zero word
+
+   18.10.26 Original    By: agent
+*/
+static int LowestBit(uint64_t bits)
+{
+#ifdef __GNUC__
+   return(__builtin_ctzll(bits));
+#else
+   int n = 0;
+
+   while(!(bits & 1))
+   {
+      bits >>= 1;
+      n++;
+   }
+   return(n);
+#endif
+}
+
+/************************************************************************/
+/*>static void PrintSolution(WSOUT *out, WSCONTEXT *ctx)
+   -----------------------------------------------------
+   Print the grid with only the specified words (no random letters)
+
+   13.01.94 Original    By: ACRM
+   14.01.94 Changed to call DoASCIIOutput()
+   18.10.26 Modified    By: agent
+            Works on a WSCONTEXT
+            Added PDF
+*/
+static void PrintSolution(WSOUT *out, WSCONTEXT *ctx)
+{
+   switch(ctx->options.style)
+   {
+   case STYLE_ASCII:
+      DoASCIIOutput(out, ctx->solution, ctx->options.gridSize,
+                    ctx->stride, ctx->words, ctx->options.wordList, 0,
+                    TRUE);
+      break;
+   case STYLE_PS:
+      DoPSOutput(out, ctx->solution, ctx->options.gridSize, ctx->stride,
+                 ctx->words, ctx->options.wordList, 0, TRUE,
+                 ctx->options.fontSize);
+      break;
+   case STYLE_LATEX:
+      DoLaTeXOutput(out, ctx->solution, ctx->options.gridSize,
+                    ctx->stride, ctx->words, ctx->options.wordList, 0,
+                    TRUE);
+      break;
+   case STYLE_PDF:
+      DoPDFOutput(out, ctx->solution, ctx->options.gridSize, ctx->stride,
+                  ctx->words, ctx->options.wordList, 0, TRUE,
+                  ctx->options.fontSize);
+      break;
+   }
+}
+
+/************************************************************************/
+/*>static void PrintPuzzle(WSOUT *out, WSCONTEXT *ctx)
+   ---------------------------------------------------
+   Print the complete grid with the words for which to search.
+
+   13.01.94 Original    By: ACRM
+   14.01.94 Changed to call DoASCIIOutput()
+   18.10.26 Modified    By: agent
+            Works on a WSCONTEXT
+            Added PDF
+*/
+static void PrintPuzzle(WSOUT *out, WSCONTEXT *ctx)
+{
+   switch(ctx->options.style)
+   {
+   case STYLE_ASCII:
+      DoASCIIOutput(out, ctx->grid, ctx->options.gridSize, ctx->stride,
+                    ctx->words, ctx->options.wordList, ctx->NWords,
+                    FALSE);
+      break;
+   case STYLE_PS:
+      DoPSOutput(out, ctx->grid, ctx->options.gridSize, ctx->stride,
+                 ctx->words, ctx->options.wordList, ctx->NWords, FALSE,
+                 ctx->options.fontSize);
+      break;
+   case STYLE_LATEX:
+      DoLaTeXOutput(out, ctx->grid, ctx->options.gridSize, ctx->stride,
+                    ctx->words, ctx->options.wordList, ctx->NWords,
+                    FALSE);
+      break;
+   case STYLE_PDF:
+      DoPDFOutput(out, ctx->grid, ctx->options.gridSize, ctx->stride,
+                  ctx->words, ctx->options.wordList, ctx->NWords, FALSE,
+                  ctx->options.fontSize);
+      break;
+   }
+}
+
+/************************************************************************/
+/*>static void InitOutput(WSOUT *out, int style, int fontsize, 
+                          BOOL book)
+   ------------------------------------------------------------
+   Initialise an output file (ASCII, PostScript, PDF or LaTeX). A book's
+   PostScript prolog counts its pages at the end and defines the f
+   procedure for page labels; its pages are started by StartPage().
+   out->pdf must be set up for PDF.
+
+   14.01.94 Original    By: ACRM
+   11.07.01 Outputs PostScript header
+   18.10.26 Modified    By: agent
+            Takes the output and font size as parameters
+            Defines the r, w and n procedures in the PostScript prolog
+            Added book
+            Added PDF
+            The creator's version is WS_VERSION
+*/
+static void InitOutput(WSOUT *out, int style, int fontsize, BOOL book)
+{
+   switch(style)
+   {
+   case STYLE_ASCII:
+      break;
+   case STYLE_PDF:
+      StartPDF(out);
+      if(!book)
+         StartPDFPage(out);
+      break;
+   case STYLE_PS:
+      /* Print the PostScript header                                    */
+      OutPrintf(out,"%%!PS-Adobe-%s\n", (book ? "3.0" : "2.0"));
+      OutPrintf(out,"%%%%Creator: WordSearch %s (c) 1994-2026 \
+Andrew C.R. Martin\n", WS_VERSION);
+      if(book)
+         OutPrintf(out,"%%%%Pages: (atend)\n");
+      OutPrintf(out,"%%%%EndComments\n");
+
+
+      OutPrintf(out,"/max\n");
+      OutPrintf(out,"%% n1 n2...max...n\n");
+      OutPrintf(out,"{  2 copy\n");
+      OutPrintf(out,"   lt { exch } if\n");
+      OutPrintf(out,"   pop\n");
+      OutPrintf(out,"}  def\n\n");
+
+      OutPrintf(out,"/Helvetica-Bold findfont %d scalefont setfont\n\n",
+                fontsize);
+
+      OutPrintf(out,"/size (W)  stringwidth pop\n");
+      OutPrintf(out,"      (\\() stringwidth exch pop\n");
+      OutPrintf(out,"      max 4 add def\n\n");
+
+      OutPrintf(out,"/xstart  72 def\n");
+      OutPrintf(out,"/ystart 720 def\n");
+
+      OutPrintf(out,"/xpos xstart def\n");
+      OutPrintf(out,"/ypos ystart def\n\n");
+
+      OutPrintf(out,"/r\n");
+      OutPrintf(out,"%% (row) r -   Show one grid row, a cell at a time\n");
+      OutPrintf(out,"{  /xpos xstart def\n");
+      OutPrintf(out,"   {  ( ) dup 0 4 -1 roll put\n");
+      OutPrintf(out,"      xpos ypos moveto show\n");
+      OutPrintf(out,"      /xpos xpos size add def\n");
+      OutPrintf(out,"   }  forall\n");
+      OutPrintf(out,"   /ypos ypos size sub def\n");
+      OutPrintf(out,"}  bind def\n\n");
+
+      OutPrintf(out,"/w\n");
+      OutPrintf(out,"%% (word) w -   Show a word in the word list\n");
+      OutPrintf(out,"{  xpos ypos moveto show\n");
+      OutPrintf(out,"   /xpos xpos 175 add def\n");
+      OutPrintf(out,"}  bind def\n\n");
+
+      OutPrintf(out,"/n\n");
+      OutPrintf(out,"%% n -   Start a new line of the word list\n");
+      OutPrintf(out,"{  /xpos xstart def\n");
+      OutPrintf(out,"   /ypos ypos size sub def\n");
+      OutPrintf(out,"}  bind def\n\n");
+
+      if(book)
+      {
+         OutPrintf(out,"/f\n");
+         OutPrintf(out,"%% (label) f -   Show a page label at the foot \
+of the page\n");
+         OutPrintf(out,"{  /Helvetica findfont 10 scalefont setfont\n");
+         OutPrintf(out,"   dup stringwidth pop 2 div 306 exch sub 36 \
+moveto show\n");
+         OutPrintf(out,"}  bind def\n\n");
+         OutPrintf(out,"%%%%EndProlog\n\n");
+      }
+      else
+      {
+         OutPrintf(out,"%%%%EndProlog\n\n");
+         OutPrintf(out,"%%%%Page: 1 1\n");
+      }
+      break;
+   case STYLE_LATEX:
+      OutPrintf(out,"\\documentstyle[12pt,a4]{article}\n");
+
+      OutPrintf(out,"\\oddsidemargin -0.3 in\n");
+      OutPrintf(out,"\\evensidemargin -0.3 in\n");
+      OutPrintf(out,"\\marginparwidth 0.75 in\n");
+      OutPrintf(out,"\\textwidth 7.0 true in\n");
+
+      OutPrintf(out,"\\pagestyle{empty}\n");
+      OutPrintf(out,"\\newcommand{\\s}[1]{\\makebox[1.5em]{#1}}\n");
+      OutPrintf(out,"\\begin{document}\n");
+      OutPrintf(out,"\\Large\n");
+      break;
+   }
+}
+
+/************************************************************************/
+/*>static void EndOutput(WSOUT *out, int style)
+   --------------------------------------------
+   Do any tidying up to end a file
+
+   14.01.94 Original    By: ACRM
+   18.10.26 Modified    By: agent
+            Takes the output as a parameter
+            Added PDF
+*/
+static void EndOutput(WSOUT *out, int style)
+{
+   switch(style)
+   {
+   case STYLE_ASCII:
+      break;
+   case STYLE_PDF:
+      EndPDFPage(out);
+      EndPDF(out);
+      break;
+   case STYLE_PS:
+      OutPrintf(out,"showpage\n");
+      break;
+   case STYLE_LATEX:
+      OutPrintf(out,"\\end{document}\n");
+      break;
+   }
+}
+
+/************************************************************************/
+/*>static void NextPage(WSOUT *out, int style)
+   -------------------------------------------
+   End the solution page of a single puzzle and start the puzzle page
+
+   18.10.26 Original    By: agent (split out of DoPSOutput() and
+                                  DoLaTeXOutput())
+            Added PDF
+*/
+static void NextPage(WSOUT *out, int style)
+{
+   switch(style)
+   {
+   case STYLE_ASCII:
+      break;
+   case STYLE_PDF:
+      EndPDFPage(out);
+      StartPDFPage(out);
+      break;
+   case STYLE_PS:
+      OutPrintf(out,"showpage\n\n");
+      OutPrintf(out,"%%%%Page: 2 2\n");
+      OutPrintf(out,"/xpos xstart def\n");
+      OutPrintf(out,"/ypos ystart def\n");
+      break;
+   case STYLE_LATEX:
+      OutPrintf(out,"\\newpage\n");
+      break;
+   }
+}
+
+/************************************************************************/
+/*>static void StartPage(WSOUT *out, int style, int fontsize, int page)
+   --------------------------------------------------------------------
+   Start a page of a book. Each PostScript page sets up its own font
+   and position so that pages may be printed or extracted alone.
+
+   18.10.26 Original    By: agent
+            Added PDF
+*/
+static void StartPage(WSOUT *out, int style, int fontsize, int page)
+{
+   switch(style)
+   {
+   case STYLE_PS:
+      OutPrintf(out,"%%%%Page: %d %d\n", page, page);
+      OutPrintf(out,"/Helvetica-Bold findfont %d scalefont setfont\n",
+                fontsize);
+      OutPrintf(out,"/xpos xstart def\n");
+      OutPrintf(out,"/ypos ystart def\n");
+      break;
+   case STYLE_PDF:
+      StartPDFPage(out);
+      break;
+   }
+}
+
+/************************************************************************/
+/*>static void EndPage(WSOUT *out, int style, int page, int answerTo)
+   ------------------------------------------------------------------
+   End a page of a book with its label: the page number and, for a
+   solution, the page of its puzzle (answerTo, 0 for a puzzle).
+
+   18.10.26 Original    By: agent
+            Added PDF
+*/
+static void EndPage(WSOUT *out, int style, int page, int answerTo)
+{
+   char label[64];
+
+   if(answerTo)
+      sprintf(label, "Page %d: solution to page %d", page, answerTo);
+   else
+      sprintf(label, "Page %d", page);
+
+   switch(style)
+   {
+   case STYLE_ASCII:
+      OutPrintf(out,"%s\n\f\n", label);
+      break;
+   case STYLE_PS:
+      OutPrintf(out,"(%s) f\n", label);
+      OutPrintf(out,"showpage\n\n");
+      break;
+   case STYLE_LATEX:
+      OutPrintf(out,"\\vfill\n");
+      OutPrintf(out,"\\centerline{%s}\n", label);
+      OutPrintf(out,"\\newpage\n");
+      break;
+   case STYLE_PDF:
+      PDFLabel(out, label);
+      EndPDFPage(out);
+      break;
+   }
+}
+
+/************************************************************************/
+/*>static void OpenOutput(WSOUT *out, WSSINK *sink, char *buffer)
+   --------------------------------------------------------------
+   Set up output to a sink through a buffer of OUTBUFFSIZE bytes
+
+   18.10.26 Original    By: agent (split out of wsRender())
+*/
+static void OpenOutput(WSOUT *out, WSSINK *sink, char *buffer)
+{
+   out->sink    = sink;
+   out->buffer  = buffer;
+   out->used    = 0;
+   out->size    = OUTBUFFSIZE;
+   out->written = 0;
+   out->pdf     = NULL;
+   out->error   = FALSE;
+}
+
+/************************************************************************/
+/*>static PDFDOC *CreatePDF(void)
+   ------------------------------
+   Allocate the state for writing PDF documents, which may be reused for
+   any number of them. Returns NULL if out of memory.
+
+   18.10.26 Original    By: agent
+*/
+static PDFDOC *CreatePDF(void)
+{
+   PDFDOC *pdf;
+
+   if((pdf = (PDFDOC *)calloc(1, sizeof(PDFDOC)))==NULL)
+      return(NULL);
+   if(deflateInit(&(pdf->z), PDFLEVEL) != Z_OK)
+   {
+      free(pdf);
+      return(NULL);
+   }
+   return(pdf);
+}
+
+/************************************************************************/
+/*>static void FreePDF(PDFDOC *pdf)
+   --------------------------------
+   Free the state from CreatePDF()
+
+   18.10.26 Original    By: agent
+*/
+static void FreePDF(PDFDOC *pdf)
+{
+   if(pdf == NULL)
+      return;
+
+   deflateEnd(&(pdf->z));
+   free(pdf->offsets);
+   free(pdf);
+}
+
+/************************************************************************/
+/*>static void StartPDF(WSOUT *out)
+   --------------------------------
+   Start a PDF document with its header, catalog and fonts. The page
+   tree, object 2, can only be written once the pages are known so it
+   comes at the end from EndPDF(). The fonts are two of the standard 14
+   so nothing needs to be embedded.
+
+   18.10.26 Original    By: agent
+*/
+static void StartPDF(WSOUT *out)
+{
+   out->pdf->nobjects  = 0;
+   out->pdf->pages     = 0;
+   out->pdf->deflating = FALSE;
+
+   /* The second line marks the file as binary for transfer programs    */
+   OutPrintf(out,"%%PDF-1.4\n%%\342\343\317\323\n");
+
+   PDFObject(out, 1);
+   OutPrintf(out,"<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+   PDFObject(out, 3);
+   OutPrintf(out,"<< /Type /Font /Subtype /Type1 /BaseFont \
+/Helvetica-Bold\n   /Encoding /WinAnsiEncoding >>\nendobj\n");
+   PDFObject(out, 4);
+   OutPrintf(out,"<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica\n\
+   /Encoding /WinAnsiEncoding >>\nendobj\n");
+}
+
+/************************************************************************/
+/*>static void EndPDF(WSOUT *out)
+   ------------------------------
+   End a PDF document with the page tree, the cross-reference table and
+   the trailer. Pages are numbered from PDFFIRSTPAGE with PDFPAGEOBJS
+   objects each, so the page tree needs nothing remembered but the
+   number of pages.
+
+   18.10.26 Original    By: agent
+*/
+static void EndPDF(WSOUT *out)
+{
+   PDFDOC   *pdf = out->pdf;
+   uint64_t xref;
+   int      i;
+
+   PDFObject(out, 2);
+   OutPrintf(out,"<< /Type /Pages /Count %d\n   /Kids [", pdf->pages);
+   for(i=0; i<pdf->pages; i++)
+   {
+      OutPrintf(out,"%s%d 0 R", ((i && i%10==0) ? "\n   " : " "),
+                PDFFIRSTPAGE + i * PDFPAGEOBJS);
+   }
+   OutPrintf(out," ] >>\nendobj\n");
+
+   /* Every entry is exactly 20 bytes, including the end of line        */
+   xref = out->written + out->used;
+   OutPrintf(out,"xref\n0 %d\n0000000000 65535 f \n", pdf->nobjects + 1);
+   for(i=1; i<=pdf->nobjects && !out->error; i++)
+   {
+      OutPrintf(out,"%010llu 00000 n \n",
+                (unsigned long long)pdf->offsets[i]);
+   }
+   OutPrintf(out,"trailer\n<< /Size %d /Root 1 0 R >>\n", 
+             pdf->nobjects + 1);
+   OutPrintf(out,"startxref\n%llu\n%%%%EOF\n", (unsigned long long)xref);
+}
+
+/************************************************************************/
+/*>static void PDFObject(WSOUT *out, int number)
+   ---------------------------------------------
+   Start a PDF object, recording where it is for the cross-reference
+   table
+
+   18.10.26 Original    By: agent
+*/
+static void PDFObject(WSOUT *out, int number)
+{
+   PDFDOC   *pdf = out->pdf;
+   uint64_t *offsets;
+   int      size;
+
+   if(number >= pdf->maxObjects)
+   {
+      size = (pdf->maxObjects ? 2 * pdf->maxObjects : 64);
+      while(size <= number)
+         size *= 2;
+      if((offsets = (uint64_t *)realloc(pdf->offsets, 
+                                        size * sizeof(uint64_t)))==NULL)
+      {
+         out->error = TRUE;
+         return;
+      }
+      pdf->offsets    = offsets;
+      pdf->maxObjects = size;
+   }
+
+   pdf->offsets[number] = out->written + out->used;
+   if(number > pdf->nobjects)
+      pdf->nobjects = number;
+   OutPrintf(out,"%d 0 obj\n", number);
+}
+
+/************************************************************************/
+/*>static void StartPDFPage(WSOUT *out)
+   ------------------------------------
+   Write the next page object and start its content stream. Everything
+   written until EndPDFPage() is compressed. The stream's length is not
+   known until then, so it is an indirect object after the stream.
+
+   18.10.26 Original    By: agent
+*/
+static void StartPDFPage(WSOUT *out)
+{
+   PDFDOC *pdf  = out->pdf;
+   int    page  = PDFFIRSTPAGE + pdf->pages * PDFPAGEOBJS;
+
+   PDFObject(out, page);
+   OutPrintf(out,"<< /Type /Page /Parent 2 0 R /MediaBox [0 0 %d %d]\n",
+             PDFWIDTH, PDFHEIGHT);
+   OutPrintf(out,"   /Resources << /Font << /F1 3 0 R /F2 4 0 R >> >>\n");
+   OutPrintf(out,"   /Contents %d 0 R >>\nendobj\n", page+1);
+   PDFObject(out, page+1);
+   OutPrintf(out,"<< /Length %d 0 R /Filter /FlateDecode >>\nstream\n",
+             page+2);
+   OutFlush(out);
+
+   deflateReset(&(pdf->z));
+   pdf->streamStart = out->written;
+   pdf->deflating   = TRUE;
+}
+
+/************************************************************************/
+/*>static void EndPDFPage(WSOUT *out)
+   ----------------------------------
+   Finish the compressed content stream of a page and write its length
+
+   18.10.26 Original    By: agent
+*/
+static void EndPDFPage(WSOUT *out)
+{
+   PDFDOC   *pdf = out->pdf;
+   uint64_t length;
+   int      page = PDFFIRSTPAGE + pdf->pages * PDFPAGEOBJS;
+
+   PDFDeflate(out, Z_FINISH);
+   pdf->deflating = FALSE;
+   length         = out->written - pdf->streamStart;
+
+   OutPrintf(out,"\nendstream\nendobj\n");
+   PDFObject(out, page+2);
+   OutPrintf(out,"%llu\nendobj\n", (unsigned long long)length);
+   pdf->pages++;
+}
+
+/************************************************************************/
+/*>static void PDFDeflate(WSOUT *out, int flush)
+   ---------------------------------------------
+   Compress the output buffer into the current content stream, passing
+   the compressed data to the sink a block at a time. flush is Z_FINISH
+   to end the stream or Z_NO_FLUSH.
+
+   18.10.26 Original    By: agent
+*/
+static void PDFDeflate(WSOUT *out, int flush)
+{
+   z_stream *z = &(out->pdf->z);
+   size_t   length;
+   int      status;
+
+   z->next_in  = (Bytef *)out->buffer;
+   z->avail_in = (uInt)out->used;
+   do
+   {
+      z->next_out  = out->pdf->block;
+      z->avail_out = PDFBLOCK;
+      status       = deflate(z, flush);
+      length       = PDFBLOCK - z->avail_out;
+
+      if(length && !out->error &&
+         out->sink->write(out->sink->handle, (char *)out->pdf->block,
+                          length) != length)
+         out->error = TRUE;
+      out->written += length;
+   }  while(status == Z_OK && (z->avail_out == 0 || flush == Z_FINISH));
+
+   if(status == Z_STREAM_ERROR)
+      out->error = TRUE;
+   out->used = 0;
+}
+
+/************************************************************************/
+/*>static void PDFLabel(WSOUT *out, const char *label)
+   ---------------------------------------------------
+   Show a page label centred at the foot of a PDF page, as the f
+   procedure does in PostScript
+
+   18.10.26 Original    By: agent
+*/
+static void PDFLabel(WSOUT *out, const char *label)
+{
+   int i,
+       width = 0;
+
+   for(i=0; label[i]; i++)
+      width += CHARWIDTH(gHelvetica, label[i]);
+
+   OutPrintf(out,"BT\n/F2 %d Tf\n%.2f %d Td\n", PDFLABELSIZE,
+             PDFWIDTH / 2.0 - width * PDFLABELSIZE / 2000.0, PDFLABELY);
+   OutPSString(out, label, strlen(label));
+   OutPrintf(out," Tj\nET\n");
+}
+
+/************************************************************************/
+/*>static void DoPSOutput(WSOUT *out, char *grid, int gridsize,
+                          int stride, char **words, BOOL WordList,
+                          int NWords, BOOL solution, int fontsize)
+   ----------------------------------------------------------------
+   Create PostScript output.
+   Input:   WSOUT *out        Output sink
+            char  *grid       The character grid
+            int   gridsize    The size of the grid
+            int   stride      Bytes between rows of the grid
+            char  **words     The word list
+            BOOL  WordList    Should be display the word list if this
+                              isn't the solution display
+            int   NWords      Number of words in the word list
+            BOOL  solution    Is this a solution display
+            int   fontsize    Font size for the grid
+
+   14.01.94 Original    By: ACRM
+   11.07.01 Outputs PostScript page count
+   18.10.26 Modified    By: agent
+            Takes the output, word list and font size as parameters
+            Grid is a flat array with a stride
+            Each row and word is one string and a call to a prolog
+            procedure rather than a moveto and show per letter
+            The solution page is ended by the caller
+*/
+static void DoPSOutput(WSOUT *out, char *grid, int gridsize, int stride,
+                       char **words, BOOL WordList, int NWords,
+                       BOOL solution, int fontsize)
+{
+   int   i, j,
+         FontSize;
+
+
+   if(solution)
+   {
+      OutPrintf(out,"xpos ypos moveto (Solution:) show\n");
+      OutPrintf(out,"/ypos ypos size 2 mul sub def\n");
+   }
+
+   for(i=0; i<gridsize; i++)
+   {
+      OutPSString(out, grid + (size_t)i * stride, gridsize);
+      OutWrite(out, " r\n", 3);
+   }
+
+   if(!solution)           /* Print the word list                       */
+   {
+      /* Leave a blank line                                             */
+      OutPrintf(out,"/ypos ypos size sub def\n");
+
+      /* Reset the font size                                            */
+      FontSize = (fontsize >= 12) ? fontsize - 2 : fontsize;
+      OutPrintf(out,"/Helvetica-Bold findfont %d scalefont setfont\n\n",
+                FontSize);
+
+      if(WordList)
+      {
+         /* Display the word list, 3 to a line                          */
+         OutPrintf(out,"/xpos xstart def\n");
+         for(i=0; i<NWords; i+=3)
+         {
+            for(j=0; j<3 && i+j<NWords; j++)
+            {
+               OutPSString(out, words[i+j], strlen(words[i+j]));
+               OutWrite(out, " w ", 3);
+            }
+            OutWrite(out, "n\n", 2);
+         }
+      }
+   }
+}
+
+/************************************************************************/
+/*>static void DoASCIIOutput(WSOUT *out, char *grid, int gridsize,
+                             int stride, char **words, BOOL WordList,
+                             int NWords, BOOL solution)
+   -------------------------------------------------------------------
+   Create ASCII output.
+   Input:   WSOUT *out        Output sink
+            char  *grid       The character grid
+            int   gridsize    The size of the grid
+            int   stride      Bytes between rows of the grid
+            char  **words     The word list
+            BOOL  WordList    Should be display the word list if this
+                              isn't the solution display
+            int   NWords      Number of words in the word list
+            BOOL  solution    Is this a solution display
+
+   14.01.94 Original    By: ACRM
+   18.10.26 Modified    By: agent
+            Takes the output and word list as parameters
+            Grid is a flat array with a stride
+            Long words no longer overrun the line buffer
+*/
+static void DoASCIIOutput(WSOUT *out, char *grid, int gridsize,
+                          int stride, char **words, BOOL WordList,
+                          int NWords, BOOL solution)
+{
+   int   i, j, k;
+
+   if(solution)
+      OutPrintf(out,"Solution:\n");
+
+   for(i=0; i<gridsize; i++)
+      OutPrintf(out,"%s\n",grid + (size_t)i * stride);
+   OutPrintf(out,"\n");
+
+   if(!solution)           /* Print the word list                       */
+   {
+      if(WordList)
+      {
+         char buffer[88];
+
+         /* Display the word list, 3 to a line                          */
+         for(i=0; i<NWords; i+=3)
+         {
+            for(j=0; j<80; j++) buffer[j] = ' ';
+            buffer[80] = '\0';
+
+            for(j=0; j<3; j++)
+            {
+               if(i+j < NWords)
+               {
+                  for(k=0; words[i+j][k] && j*26+k < 80; k++)
+                     buffer[j*26 + k] = words[i+j][k];
+               }
+            }
+            OutPrintf(out,"%s\n",buffer);
+         }
+      }
+   }
+}
+
+/************************************************************************/
+/*>static void DoLaTeXOutput(WSOUT *out, char *grid, int gridsize,
+                             int stride, char **words, BOOL WordList,
+                             int NWords, BOOL solution)
+   -------------------------------------------------------------------
+   Create LaTeX output.
+   Input:   WSOUT *out        Output sink
+            char  *grid       The character grid
+            int   gridsize    The size of the grid
+            int   stride      Bytes between rows of the grid
+            char  **words     The word list
+            BOOL  WordList    Should be display the word list if this
+                              isn't the solution display
+            int   NWords      Number of words in the word list
+            BOOL  solution    Is this a solution display
+
+   14.01.94 Original    By: ACRM
+   18.10.26 Modified    By: agent
+            Takes the output and word list as parameters
+            Grid is a flat array with a stride
+            The solution page is ended by the caller
+*/
+static void DoLaTeXOutput(WSOUT *out, char *grid, int gridsize,
+                          int stride, char **words, BOOL WordList,
+                          int NWords, BOOL solution)
+{
+   int   i, j;
+
+   if(solution)
+   {
+      OutPrintf(out,"\\noindent Solution:\n\n");
+      OutPrintf(out,"\\vspace{2em}\n\n");
+   }
+
+   OutPrintf(out,"\\begin{center}\n");
+   for(i=0; i<gridsize; i++)
+   {
+      for(j=0; j<gridsize; j++)
+         OutPrintf(out,"\\s{%c}",CELL(grid,stride,j,i));
+      OutPrintf(out,"\n\n");
+   }
+   OutPrintf(out,"\\end{center}\n");
+
+   if(!solution)           /* Print the word list                       */
+   {
+      if(WordList)
+      {
+         /* Display the word list, 3 to a line                          */
+         OutPrintf(out,"\\vspace{2em}\n");
+         OutPrintf(out,"\\begin{center}\n");
+         OutPrintf(out,"\\begin{tabular}{lll}\n");
+
+         for(i=0; i<NWords; i+=3)
+         {
+            for(j=0; j<3; j++)
+            {
+               if(i+j < NWords)
+                  OutPrintf(out,"%s ",words[i+j]);
+               else
+                  OutPrintf(out," ");
+
+               OutPrintf(out,"%s",((j<2) ? "&" : "\\\\\n"));
+            }
+         }
+
+         OutPrintf(out,"\\end{tabular}\n");
+         OutPrintf(out,"\\end{center}\n");
+      }
+   }
+}
+
+/************************************************************************/
+/*>static void DoPDFOutput(WSOUT *out, char *grid, int gridsize,
+                           int stride, char **words, BOOL WordList,
+                           int NWords, BOOL solution, int fontsize)
+   -----------------------------------------------------------------
+   Create the content of a PDF page, laid out as the PostScript.
+   Input:   WSOUT *out        Output sink
+            char  *grid       The character grid
+            int   gridsize    The size of the grid
+            int   stride      Bytes between rows of the grid
+            char  **words     The word list
+            BOOL  WordList    Should be display the word list if this
+                              isn't the solution display
+            int   NWords      Number of words in the word list
+            BOOL  solution    Is this a solution display
+            int   fontsize    Font size for the grid
+
+   The cells are size points apart, as in the PostScript prolog. Each
+   row is one TJ array in which every character is followed by the
+   adjustment that moves from the end of its glyph to the next cell.
+   The adjustments are whole thousandths of the font size, with the
+   fraction that is left over added to every glyph by the character
+   spacing, to keep the arrays short. The text for each character is
+   made the first time it is used.
+
+   18.10.26 Original    By: agent
+*/
+static void DoPDFOutput(WSOUT *out, char *grid, int gridsize, int stride,
+                        char **words, BOOL WordList, int NWords,
+                        BOOL solution, int fontsize)
+{
+   char          cellText[256][24];
+   unsigned char cellLength[256],
+                 ch;
+   double        size  = CHARWIDTH(gHelveticaBold, 'W') * fontsize 
+                         / 1000.0 + 4;
+   int           pitch = (int)(size * 1000.0 / fontsize),
+                 i, j, n,
+                 FontSize;
+   
+   memset(cellLength, 0, sizeof(cellLength));
+
+   OutPrintf(out,"BT\n/F1 %d Tf\n%.3f TL\n%.4f Tc\n%d %d Td\n", fontsize,
+             size, size - pitch * fontsize / 1000.0, PDFXSTART, 
+             PDFYSTART);
+   if(solution)
+      OutPrintf(out,"(Solution:) Tj T* T*\n");
+
+   for(i=0; i<gridsize; i++)
+   {
+      OutWrite(out, "[", 1);
+      for(j=0; j<gridsize; j++)
+      {
+         ch = (unsigned char)CELL(grid, stride, j, i);
+         if(!cellLength[ch])
+         {
+            if(ch == '(' || ch == ')' || ch == '\\')
+               n = sprintf(cellText[ch], "(\\%c)", ch);
+            else if(isprint(ch))
+               n = sprintf(cellText[ch], "(%c)", ch);
+            else
+               n = sprintf(cellText[ch], "(\\%03o)", ch);
+            n += sprintf(cellText[ch] + n, "%d",
+                         CHARWIDTH(gHelveticaBold, ch) - pitch);
+            cellLength[ch] = (unsigned char)n;
+         }
+         OutWrite(out, cellText[ch], cellLength[ch]);
+      }
+      OutWrite(out, "] TJ T*\n", 8);
+   }
+
+   if(!solution)           /* Print the word list                       */
+   {
+      /* Leave a blank line and reset the font size                     */
+      FontSize = (fontsize >= 12) ? fontsize - 2 : fontsize;
+      OutPrintf(out,"T*\n/F1 %d Tf\n0 Tc\n", FontSize);
+
+      if(WordList)
+      {
+         /* Display the word list, 3 to a line                          */
+         for(i=0; i<NWords; i+=3)
+         {
+            for(j=0; j<3 && i+j<NWords; j++)
+            {
+               if(j)
+                  OutPrintf(out," %d 0 Td ", PDFWORDSEP);
+               OutPSString(out, words[i+j], strlen(words[i+j]));
+               OutWrite(out, " Tj", 3);
+            }
+            if(j > 1)
+               OutPrintf(out," %d 0 Td", -PDFWORDSEP * (j-1));
+            OutWrite(out, " T*\n", 4);
+         }
+      }
+   }
+   OutWrite(out, "ET\n", 3);
+}
+
+/************************************************************************/
+/*>static void SortByLength(char **Words, int NWords, char **scratch)
+   -------------------------------------------------------------------
+   Sort strings in an array by length (longest first). Long words have
+   the fewest placements so fitting them first keeps the backtracking
+   search shallow. Words of equal length stay in input order.
+
+   Runs of SORTRUN words are insertion sorted and then merged, so a
+   puzzle of a few words costs no more than before while tens of
+   thousands of words for a large grid do not take quadratic time.
+   scratch must have room for NWords words.
+
+   13.01.94 Framework
+   18.10.26 Modified    By: agent
+            Implemented By: agent
+            Merges sorted runs
+*/
+static void SortByLength(char **Words, int NWords, char **scratch)
+{
+   int  i, j, k,
+        lo, mid, hi,
+        len, width;
+   char *word,
+        **from = Words,
+        **to   = scratch,
+        **swap;
+
+   for(lo=0; lo<NWords; lo+=SORTRUN)
+   {
+      hi = (lo + SORTRUN < NWords) ? lo + SORTRUN : NWords;
+      for(i=lo+1; i<hi; i++)
+      {
+         word = Words[i];
+         len  = strlen(word);
+         for(j=i; j>lo && (int)strlen(Words[j-1]) < len; j--)
+            Words[j] = Words[j-1];
+         Words[j] = word;
+      }
+   }
+
+   /* On a tie the word from the left run goes first                    */
+   for(width=SORTRUN; width<NWords; width*=2)
+   {
+      for(lo=0; lo<NWords; lo+=2*width)
+      {
+         mid = (lo + width < NWords)     ? lo + width     : NWords;
+         hi  = (lo + 2 * width < NWords) ? lo + 2 * width : NWords;
+         for(i=lo, j=mid, k=lo; k<hi; k++)
+         {
+            if(j >= hi || (i < mid && strlen(from[i]) >= strlen(from[j])))
+               to[k] = from[i++];
+            else
+               to[k] = from[j++];
+         }
+      }
+      swap = from;
+      from = to;
+      to   = swap;
+   }
+
+   if(from != Words)
+      memcpy(Words, from, NWords * sizeof(char *));
+}
+
+/************************************************************************/
+/*>static void OutPrintf(WSOUT *out, const char *format, ...)
+   ----------------------------------------------------------
+   printf() to an output sink. Once the sink has failed nothing more is
+   written.
+
+   18.10.26 Original    By: agent
+            Formats straight into the output buffer
+*/
+static void OutPrintf(WSOUT *out, const char *format, ...)
+{
+   char    *text;
+   va_list args;
+   int     length;
+
+   if(out->error)
+      return;
+
+   va_start(args, format);
+   length = vsnprintf(out->buffer + out->used, out->size - out->used,
+                      format, args);
+   va_end(args);
+
+   if(length < 0)
+   {
+      out->error = TRUE;
+      return;
+   }
+   if((size_t)length < out->size - out->used)
+   {
+      out->used += length;
+      return;
+   }
+
+   /* Didn't fit in what was left of the buffer. Empty it and try again,
+      or allocate a buffer if it will never fit
+   */
+   OutFlush(out);
+   if((size_t)length < out->size)
+   {
+      va_start(args, format);
+      vsnprintf(out->buffer, out->size, format, args);
+      va_end(args);
+      out->used = length;
+   }
+   else
+   {
+      if((text = (char *)malloc(length+1)) == NULL)
+      {
+         out->error = TRUE;
+         return;
+      }
+      va_start(args, format);
+      vsnprintf(text, length+1, format, args);
+      va_end(args);
+      OutWrite(out, text, length);
+      free(text);
+   }
+}
+
+/************************************************************************/
+/*>static void OutWrite(WSOUT *out, const char *text, size_t length)
+   -----------------------------------------------------------------
+   Add text to the output buffer, passing the buffer to the sink when it
+   fills. Text longer than the buffer goes straight to the sink, unless
+   it is being compressed, when it goes through the buffer in pieces.
+
+   18.10.26 Original    By: agent
+            Added PDF content streams
+*/
+static void OutWrite(WSOUT *out, const char *text, size_t length)
+{
+   if(out->error)
+      return;
+
+   if(length > out->size && DEFLATING(out))
+   {
+      for(; length > out->size; length -= out->size, text += out->size)
+         OutWrite(out, text, out->size);
+   }
+
+   if(out->used + length > out->size)
+      OutFlush(out);
+
+   if(length > out->size)
+   {
+      if(!out->error &&
+         out->sink->write(out->sink->handle, text, length) != length)
+         out->error = TRUE;
+      out->written += length;
+   }
+   else
+   {
+      memcpy(out->buffer + out->used, text, length);
+      out->used += length;
+   }
+}
+
+/************************************************************************/
+/*>static void OutPSString(WSOUT *out, const char *text, int length)
+   -----------------------------------------------------------------
+   Write text as a PostScript string. Brackets and backslashes are
+   escaped and anything unprintable is written as an octal escape. Long
+   strings are continued over several lines.
+
+   18.10.26 Original    By: agent
+*/
+static void OutPSString(WSOUT *out, const char *text, int length)
+{
+   char buffer[8];
+   int  i,
+        column = 1;
+
+   OutWrite(out, "(", 1);
+   for(i=0; i<length; i++)
+   {
+      if(column >= PSLINELEN)
+      {
+         OutWrite(out, "\\\n", 2);
+         column = 0;
+      }
+
+      switch(text[i])
+      {
+      case '(': case ')': case '\\':
+         buffer[0] = '\\';
+         buffer[1] = text[i];
+         OutWrite(out, buffer, 2);
+         column += 2;
+         break;
+      default:
+         if(isprint((unsigned char)text[i]))
+         {
+            OutWrite(out, text + i, 1);
+            column++;
+         }
+         else
+         {
+            sprintf(buffer, "\\%03o", (unsigned char)text[i]);
+            OutWrite(out, buffer, 4);
+            column += 4;
+         }
+         break;
+      }
+   }
+   OutWrite(out, ")", 1);
+}
+
+/************************************************************************/
+/*>static void OutFlush(WSOUT *out)
+   --------------------------------
+   Pass anything in the output buffer to the sink, compressing it first
+   while in a PDF content stream
+
+   18.10.26 Original    By: agent
+            Added PDF content streams
+*/
+static void OutFlush(WSOUT *out)
+{
+   if(DEFLATING(out))
+   {
+      PDFDeflate(out, Z_NO_FLUSH);
+      return;
+   }
+
+   if(out->used && !out->error &&
+      out->sink->write(out->sink->handle, out->buffer, out->used) 
+      != out->used)
+      out->error = TRUE;
+   out->written += out->used;
+   out->used     = 0;
+}
+
+/************************************************************************/
+/*>static size_t FileWrite(void *handle, const char *buffer,
+                           size_t length)
+   -------------------------------------------------------
+   Sink write function for wsFileSink()
+
+   18.10.26 Original    By: agent
+*/
+static size_t FileWrite(void *handle, const char *buffer, size_t length)
+{
+   return(fwrite(buffer, 1, length, (FILE *)handle));
+}
+
+/************************************************************************/
+/*>static BOOL BuildSolver(WSSOLVER *solver, char **words, int NWords)
+   -------------------------------------------------------------------
+   Compile words into the solver's automaton, reusing its memory. The
+   characters used by the words are numbered from 1 and all others are
+   class 0, so the transition table has a row of nclasses entries for
+   each state. The words are put in a trie, then a breadth first pass
+   sets each state's fail link and fills in its missing transitions
+   from its fail state's, so that scanning takes exactly one lookup per
+   cell. Returns FALSE if memory allocation failed.
+
+   18.10.26 Original    By: agent
+*/
+static BOOL BuildSolver(WSSOLVER *solver, char **words, int NWords)
+{
+   const unsigned char *ch;
+   size_t              letters = 1,
+                       row;
+   int                 *ints,
+                       *delta,
+                       i, j, c, s, f,
+                       child, head, tail,
+                       nclasses = 1;
+
+   memset(solver->class, 0, sizeof(solver->class));
+   for(i=0; i<NWords; i++)
+   {
+      for(ch=(const unsigned char *)words[i]; *ch; ch++)
+      {
+         if(!solver->class[*ch])
+            solver->class[*ch] = (unsigned char)nclasses++;
+         letters++;
+      }
+   }
+
+   /* The trie has at most one state per letter plus the root           */
+   if(NWords > solver->maxWords)
+   {
+      if((ints = (int *)realloc(solver->wordInts, 
+                                (size_t)NWords * 5 * sizeof(int)))==NULL)
+         return(FALSE);
+      solver->wordInts   = ints;
+      solver->length     = ints;
+      solver->first      = ints + NWords;
+      solver->count      = ints + (size_t)2 * NWords;
+      solver->copies     = ints + (size_t)3 * NWords;
+      solver->palindrome = ints + (size_t)4 * NWords;
+      solver->maxWords   = NWords;
+   }
+   if(letters > (size_t)solver->maxStates)
+   {
+      if((ints = (int *)realloc(solver->stateInts, 
+                                letters * 6 * sizeof(int)))==NULL)
+         return(FALSE);
+      solver->stateInts = ints;
+      solver->out       = ints;
+      solver->fail      = ints + letters;
+      solver->dict      = ints + 2 * letters;
+      solver->report    = ints + 3 * letters;
+      solver->queue     = ints + 4 * letters;
+      solver->depth     = ints + 5 * letters;
+      solver->maxStates = (int)letters;
+   }
+   if(letters * nclasses > solver->maxDelta)
+   {
+      if((ints = (int *)realloc(solver->delta, 
+                                letters * nclasses * sizeof(int)))==NULL)
+         return(FALSE);
+      solver->delta    = ints;
+      solver->maxDelta = letters * nclasses;
+   }
+   delta = solver->delta;
+
+   solver->NWords    = NWords;
+   solver->maxLength = 0;
+   solver->nclasses  = nclasses;
+   solver->nstates   = 1;
+   solver->out[0]    = -1;
+   solver->depth[0]  = 0;
+   memset(delta, 0, nclasses * sizeof(int));
+
+   /* Build the trie. State 0 is the root, so 0 also means no child     */
+   for(i=0; i<NWords; i++)
+   {
+      s = 0;
+      for(ch=(const unsigned char *)words[i]; *ch; ch++)
+      {
+         row = (size_t)s * nclasses + solver->class[*ch];
+         if(!delta[row])
+         {
+            delta[row] = solver->nstates;
+            memset(delta + (size_t)solver->nstates * nclasses, 0,
+                   nclasses * sizeof(int));
+            solver->depth[solver->nstates] = solver->depth[s] + 1;
+            solver->out[solver->nstates++] = -1;
+         }
+         s = delta[row];
+      }
+
+      solver->length[i] = (int)((const char *)ch - words[i]);
+      if(solver->length[i] > solver->maxLength)
+         solver->maxLength = solver->length[i];
+      solver->count[i]  = 0;
+      solver->copies[i] = 0;
+      if(solver->out[s] < 0)
+         solver->out[s] = i;
+      solver->first[i] = solver->out[s];
+      solver->copies[solver->first[i]]++;
+
+      solver->palindrome[i] = TRUE;
+      for(j=0; j<solver->length[i]/2; j++)
+      {
+         if(words[i][j] != words[i][solver->length[i]-1-j])
+         {
+            solver->palindrome[i] = FALSE;
+            break;
+         }
+      }
+   }
+
+   /* Set the fail links breadth first, so a state's fail state, being
+      shallower, is always finished before it
+   */
+   solver->fail[0] = solver->dict[0] = solver->report[0] = 0;
+   head = tail = 0;
+   for(c=0; c<nclasses; c++)
+   {
+      if((child = delta[c]) != 0)
+      {
+         solver->fail[child]   = 0;
+         solver->queue[tail++] = child;
+      }
+   }
+   while(head < tail)
+   {
+      s = solver->queue[head++];
+      f = solver->fail[s];
+      solver->dict[s]   = (solver->out[f] >= 0) ? f : solver->dict[f];
+      solver->report[s] = (solver->out[s] >= 0) ? s : solver->dict[s];
+
+      row = (size_t)s * nclasses;
+      for(c=0; c<nclasses; c++)
+      {
+         if((child = delta[row + c]) != 0)
+         {
+            solver->fail[child]   = delta[(size_t)f * nclasses + c];
+            solver->queue[tail++] = child;
+         }
+         else
+         {
+            delta[row + c] = delta[(size_t)f * nclasses + c];
+         }
+      }
+   }
+
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>static void ScanLine(WSSOLVER *solver, const char *grid, int gridsize,
+                        int stride, int x0, int y0, int dx, int dy)
+   ----------------------------------------------------------------------
+   Pass one line of a grid, from (x0,y0) stepping (dx,dy) to the edge,
+   through the solver's automaton and count each word found, recording
+   where it is unless the solver only counts
+
+   18.10.26 Original    By: agent
+*/
+static void ScanLine(WSSOLVER *solver, const char *grid, int gridsize,
+                     int stride, int x0, int y0, int dx, int dy)
+{
+   const unsigned char *cells = (const unsigned char *)grid;
+   const int           *delta = solver->delta;
+   ptrdiff_t           offset = (ptrdiff_t)y0 * stride + x0,
+                       step   = (ptrdiff_t)dy * stride + dx;
+   BOOL                forward = (dx > 0 || (dx == 0 && dy > 0));
+   int                 n = gridsize,
+                       nclasses = solver->nclasses,
+                       i, r, w, back,
+                       s = 0;
+
+   if(dx > 0 && gridsize - x0 < n) n = gridsize - x0;
+   if(dx < 0 && x0 + 1 < n)        n = x0 + 1;
+   if(dy > 0 && gridsize - y0 < n) n = gridsize - y0;
+   if(dy < 0 && y0 + 1 < n)        n = y0 + 1;
+
+   for(i=0; i<n; i++, offset+=step)
+   {
+      s = delta[(size_t)s * nclasses + solver->class[cells[offset]]];
+      for(r=solver->report[s]; r; r=solver->dict[r])
+      {
+         w = solver->out[r];
+
+         /* Don't find a word again over the same cells                 */
+         if(solver->length[w] == 1 ? (dx != 1 || dy != 0)
+                                   : (solver->palindrome[w] && !forward))
+            continue;
+
+         if(solver->record)
+         {
+            back = i - solver->length[w] + 1;
+            AddMatch(solver, w, x0 + back * dx, y0 + back * dy, dx, dy);
+         }
+         else
+         {
+            solver->count[w]++;
+         }
+      }
+   }
+}
+
+/************************************************************************/
+/*>static void AddMatch(WSSOLVER *solver, int word, int x, int y, int dx,
+                        int dy)
+   ----------------------------------------------------------------------
+   Record an occurrence of a word. Sets solver->error if memory 
+   allocation failed.
+
+   18.10.26 Original    By: agent
+*/
+static void AddMatch(WSSOLVER *solver, int word, int x, int y, int dx,
+                     int dy)
+{
+   WSMATCH *matches,
+           *match;
+   int     size;
+
+   if(solver->nmatches >= solver->maxMatches)
+   {
+      size = solver->maxMatches ? 2 * solver->maxMatches : 64;
+      if((matches = (WSMATCH *)realloc(solver->matches,
+                                       size * sizeof(WSMATCH)))==NULL)
+      {
+         solver->error = TRUE;
+         return;
+      }
+      solver->matches    = matches;
+      solver->maxMatches = size;
+   }
+
+   match       = &(solver->matches[solver->nmatches++]);
+   match->word = word;
+   match->x    = x;
+   match->y    = y;
+   match->dx   = dx;
+   match->dy   = dy;
+   solver->count[word]++;
+}
+
+/************************************************************************/
+/*>static int CompareMatches(const void *a, const void *b)
+   -------------------------------------------------------
+   qsort() comparison putting matches in order of word, row, column and
+   direction
+
+   18.10.26 Original    By: agent
+*/
+static int CompareMatches(const void *a, const void *b)
+{
+   const WSMATCH *ma = (const WSMATCH *)a,
+                 *mb = (const WSMATCH *)b;
+
+   if(ma->word != mb->word) return((ma->word < mb->word) ? -1 : 1);
+   if(ma->y    != mb->y)    return((ma->y    < mb->y)    ? -1 : 1);
+   if(ma->x    != mb->x)    return((ma->x    < mb->x)    ? -1 : 1);
+   if(ma->dy   != mb->dy)   return((ma->dy   < mb->dy)   ? -1 : 1);
+   if(ma->dx   != mb->dx)   return((ma->dx   < mb->dx)   ? -1 : 1);
+   return(0);
+}
+
+/************************************************************************/
+/*>static int PrepareSolver(WSCONTEXT *ctx)
+   ----------------------------------------
+   Build the context's solver for the words just placed. Returns WS_OK
+   or WS_NOMEMORY.
+
+   18.10.26 Original    By: agent (split out of VerifyPuzzle())
+*/
+static int PrepareSolver(WSCONTEXT *ctx)
+{
+   if(ctx->solver == NULL &&
+      (ctx->solver = (WSSOLVER *)calloc(1, sizeof(WSSOLVER)))==NULL)
+      return(WS_NOMEMORY);
+   if(!BuildSolver(ctx->solver, ctx->words, ctx->NWords))
+      return(WS_NOMEMORY);
+
+   return(WS_OK);
+}
+
+/************************************************************************/
+/*>static int VerifyPuzzle(WSCONTEXT *ctx)
+   ---------------------------------------
+   Search the finished grid for the puzzle's words. Each word must be
+   found at least as often as it is in the list; any more occurrences
+   are added to the stats as duplicates. Only the counts are needed, so
+   the context's solver does not record where the words are. The solver
+   must have been built by PrepareSolver(). Returns WS_OK, WS_BADPUZZLE if
+   a word is missing or WS_NOMEMORY.
+
+   18.10.26 Original    By: agent
+*/
+static int VerifyPuzzle(WSCONTEXT *ctx)
+{
+   WSSOLVER *solver = ctx->solver;
+   int      i, status;
+
+   if((status = wsSolve(solver, ctx->grid, ctx->options.gridSize,
+                        ctx->stride)) != WS_OK)
+      return(status);
+
+   for(i=0; i<solver->NWords; i++)
+   {
+      if(solver->first[i] != i)
+         continue;
+      if(solver->count[i] < solver->copies[i])
+         return(WS_BADPUZZLE);
+      ctx->stats.duplicates += solver->count[i] - solver->copies[i];
+   }
+
+   return(WS_OK);
+}
+
+/************************************************************************/
+/*>static void CacheKey(WSCONTEXT *ctx, const WSWORDLIST *list, 
+                        int NWords, uint64_t seed, uint64_t *key)
+   ---------------------------------------------------------------
+   Input:   const WSWORDLIST *list   The word list
+            int              NWords  Number of its words used
+            uint64_t         seed    Seed of the puzzle
+   Output:  uint64_t         *key    128-bit key of the puzzle
+
+   Hash everything that decides what puzzle is built: the words, which
+   have already been normalised, the seed and the options that change
+   the grid. The rendering options are left out, since an entry may be
+   rendered in any style. Raced puzzles depend on which search wins, so
+   they are kept apart from puzzles built by a single search.
+
+   18.10.26 Original    By: agent
+            Includes the dense option
+            Includes the automatic grid size and its limit
+*/
+static void CacheKey(WSCONTEXT *ctx, const WSWORDLIST *list, int NWords,
+                     uint64_t seed, uint64_t *key)
+{
+   int      i,
+            values[10];
+   uint64_t hash;
+
+   values[0] = CACHEVERSION;
+   values[1] = ctx->options.autoGrid ? ctx->sizeLimit 
+                                     : ctx->options.gridSize;
+   values[2] = NWords;
+   values[3] = ctx->options.directions;
+   values[4] = ctx->options.unique;
+   values[5] = ctx->options.verify;
+   values[6] = (ctx->options.portfolio > 1);
+   values[7] = TILED(&(ctx->options)) ? ctx->options.tileSize : 0;
+   values[8] = ctx->options.dense;
+   values[9] = ctx->options.autoGrid;
+
+   key[0] = FNVOFFSET;
+   key[1] = GOLDENGAMMA;
+   HashBytes(key, values, sizeof(values));
+   HashBytes(key, &seed, sizeof(seed));
+   for(i=0; i<NWords; i++)
+      HashBytes(key, list->words[i], list->lengths[i] + 1);
+
+   for(i=0; i<2; i++)
+   {
+      hash   = key[i];
+      key[i] = SplitMix64(&hash);
+   }
+}
+
+/************************************************************************/
+/*>static char *CachePath(const WSCONTEXT *ctx, const uint64_t *key,
+                          BOOL temporary)
+   -----------------------------------------------------------------
+   Returns the file name of a cache entry, or with temporary set the
+   name it is written under before being renamed into place. The
+   temporary name is unique to this process and context. The name is
+   malloc()'d; returns NULL if out of memory.
+
+   18.10.26 Original    By: agent
+*/
+static char *CachePath(const WSCONTEXT *ctx, const uint64_t *key,
+                       BOOL temporary)
+{
+   char *path;
+
+   if((path = (char *)malloc(strlen(ctx->options.cache) + 80))==NULL)
+      return(NULL);
+
+   if(temporary)
+      sprintf(path, "%s/.%016llx%016llx.%ld.%lx", ctx->options.cache,
+              (unsigned long long)key[0], (unsigned long long)key[1],
+              (long)getpid(), (unsigned long)(uintptr_t)ctx);
+   else
+      sprintf(path, "%s/%016llx%016llx.wsc", ctx->options.cache,
+              (unsigned long long)key[0], (unsigned long long)key[1]);
+
+   return(path);
+}
+
+/************************************************************************/
+/*>static size_t CacheSize(int gridsize, int NWords)
+   -------------------------------------------------
+   Returns the size in bytes of a cache entry
+
+   18.10.26 Original    By: agent
+            Allows for the word records
+*/
+static size_t CacheSize(int gridsize, int NWords)
+{
+   size_t cells = (size_t)gridsize * gridsize;
+
+   return(sizeof(CACHEHEADER) + 
+          NWords * (sizeof(uint32_t) + sizeof(PUZZLEWORD)) + cells +
+          (cells + 7) / 8 + sizeof(uint64_t));
+}
+
+/************************************************************************/
+/*>static BOOL LoadPuzzle(WSCONTEXT *ctx, const WSWORDLIST *list, 
+                          int NWords, uint64_t seed, const uint64_t *key)
+   ----------------------------------------------------------------------
+   Read a puzzle from the cache into the context. Returns FALSE if it
+   is not there, or the entry is damaged or does not match, in which 
+   case the puzzle is built as usual. With options->autoGrid the grid
+   size is taken from the entry, and the grid is resized to it.
+
+   18.10.26 Original    By: agent
+            Added the automatic grid size
+            Reads where each word is
+*/
+static BOOL LoadPuzzle(WSCONTEXT *ctx, const WSWORDLIST *list, 
+                       int NWords, uint64_t seed, const uint64_t *key)
+{
+   FILE          *fp;
+   char          *path;
+   unsigned char *buffer, *cells, *mask;
+   CACHEHEADER   header;
+   PUZZLEWORD    *records;
+   uint32_t      *index;
+   uint64_t      check,
+                 hash[2] = {FNVOFFSET, GOLDENGAMMA};
+   size_t        size,
+                 nread   = 0,
+                 n;
+   int           i, x, y,
+                 gridsize = ctx->options.gridSize;
+   BOOL          ok       = FALSE;
+
+   if((path = CachePath(ctx, key, FALSE))==NULL)
+      return(FALSE);
+   fp = fopen(path, "rb");
+   free(path);
+   if(fp == NULL)
+      return(FALSE);
+
+   if(ctx->options.autoGrid)
+   {
+      if(fread(&header, sizeof(CACHEHEADER), 1, fp) != 1 ||
+         header.gridSize < 1 || header.gridSize > (uint32_t)ctx->maxGrid)
+      {
+         fclose(fp);
+         return(FALSE);
+      }
+      gridsize = (int)header.gridSize;
+      rewind(fp);
+   }
+   size = CacheSize(gridsize, NWords);
+
+   /* Read one byte more than an entry should have, to catch longer
+      files
+   */
+   if((buffer = (unsigned char *)malloc(size + 1))!=NULL)
+      nread = fread(buffer, 1, size + 1, fp);
+   fclose(fp);
+   if(nread != size)
+   {
+      free(buffer);
+      return(FALSE);
+   }
+
+   memcpy(&header, buffer, sizeof(CACHEHEADER));
+   memcpy(&check, buffer + size - sizeof(uint64_t), sizeof(uint64_t));
+   HashBytes(hash, buffer, size - sizeof(uint64_t));
+   index   = (uint32_t *)(buffer + sizeof(CACHEHEADER));
+   records = (PUZZLEWORD *)(index + NWords);
+   cells   = (unsigned char *)(records + NWords);
+   mask    = cells + (size_t)gridsize * gridsize;
+
+   if(!memcmp(header.magic, CACHEMAGIC, sizeof(header.magic)) &&
+      header.gridSize == (uint32_t)gridsize &&
+      header.NWords   == (uint32_t)NWords   &&
+      header.key[0]   == key[0] && header.key[1] == key[1] &&
+      check == hash[0])
+   {
+      for(i=0; i<NWords && index[i] < (uint32_t)NWords &&
+               records[i].length == list->lengths[index[i]] &&
+               RecordInGrid(&(records[i]), gridsize); i++);
+      ok = (i == NWords);
+   }
+
+   if(ok && gridsize != ctx->options.gridSize)
+      ok = ResizeGrid(ctx, gridsize);
+   if(ok && (ok = PrepareSearch(ctx, list->words, NWords, seed, FALSE)))
+   {
+      for(i=0; i<NWords; i++)
+      {
+         ctx->words[i]            = list->words[index[i]];
+         ctx->places[i].x         = (int)(records[i].start % gridsize);
+         ctx->places[i].y         = (int)(records[i].start / gridsize);
+         ctx->places[i].direction = records[i].direction;
+      }
+
+      for(y=0, n=0; y<gridsize; y++)
+      {
+         for(x=0; x<gridsize; x++, n++)
+         {
+            CELL(ctx->grid, ctx->stride, x, y) = (char)cells[n];
+            CELL(ctx->solution, ctx->stride, x, y) = 
+               (mask[n/8] & (1 << (n%8))) ? (char)cells[n] : ' ';
+         }
+      }
+   }
+
+   free(buffer);
+   return(ok);
+}
+
+/************************************************************************/
+/*>static BOOL StorePuzzle(WSCONTEXT *ctx, const WSWORDLIST *list,
+                           const uint64_t *key)
+   ----------------------------------------------------------------
+   Add the puzzle just generated to the cache. The entry is written to a
+   file of its own and then renamed into place, so other processes see
+   either the whole entry or none of it. The cache directory is made if
+   need be. Returns FALSE if the entry could not be written.
+
+   18.10.26 Original    By: agent
+            Writes where each word is
+*/
+static BOOL StorePuzzle(WSCONTEXT *ctx, const WSWORDLIST *list,
+                        const uint64_t *key)
+{
+   FILE          *fp     = NULL;
+   char          *path   = NULL,
+                 *temp   = NULL,
+                 ***refs = NULL,
+                 ***found,
+                 **want;
+   unsigned char *buffer,
+                 *cells, *mask;
+   CACHEHEADER   header;
+   PUZZLEWORD    *records;
+   uint32_t      *index;
+   uint64_t      hash[2] = {FNVOFFSET, GOLDENGAMMA};
+   size_t        size,
+                 n;
+   int           i, x, y,
+                 gridsize = ctx->options.gridSize,
+                 NWords   = ctx->NWords;
+   BOOL          ok       = FALSE;
+   char          ch;
+
+   size = CacheSize(gridsize, NWords);
+   if((buffer = (unsigned char *)calloc(size, 1))==NULL)
+      return(FALSE);
+
+   memcpy(header.magic, CACHEMAGIC, sizeof(header.magic));
+   header.gridSize = (uint32_t)gridsize;
+   header.NWords   = (uint32_t)NWords;
+   header.key[0]   = key[0];
+   header.key[1]   = key[1];
+   memcpy(buffer, &header, sizeof(CACHEHEADER));
+   index   = (uint32_t *)(buffer + sizeof(CACHEHEADER));
+   records = (PUZZLEWORD *)(index + NWords);
+   cells   = (unsigned char *)(records + NWords);
+   mask    = cells + (size_t)gridsize * gridsize;
+   MakeRecords(ctx, records);
+
+   /* The context's words point into the list; find their indices by
+      sorting references to the list's words by the pointers they hold
+   */
+   if(NWords &&
+      (refs = (char ***)malloc(NWords * sizeof(char **)))==NULL)
+      goto done;
+   for(i=0; i<NWords; i++)
+      refs[i] = &(list->words[i]);
+   qsort(refs, NWords, sizeof(char **), CompareWordRefs);
+   for(i=0; i<NWords; i++)
+   {
+      want  = &(ctx->words[i]);
+      if((found = (char ***)bsearch(&want, refs, NWords, sizeof(char **),
+                                    CompareWordRefs))==NULL)
+         goto done;
+      index[i] = (uint32_t)(*found - list->words);
+   }
+
+   for(y=0, n=0; y<gridsize; y++)
+   {
+      for(x=0; x<gridsize; x++, n++)
+      {
+         cells[n] = (unsigned char)CELL(ctx->grid, ctx->stride, x, y);
+         ch       = CELL(ctx->solution, ctx->stride, x, y);
+         if(ch != ' ')
+            mask[n/8] |= (unsigned char)(1 << (n%8));
+      }
+   }
+   HashBytes(hash, buffer, size - sizeof(uint64_t));
+   memcpy(buffer + size - sizeof(uint64_t), &(hash[0]), sizeof(uint64_t));
+
+   if((path = CachePath(ctx, key, FALSE))==NULL ||
+      (temp = CachePath(ctx, key, TRUE))==NULL)
+      goto done;
+   if((fp = fopen(temp, "wb"))==NULL)
+   {
+      mkdir(ctx->options.cache, 0777);
+      if((fp = fopen(temp, "wb"))==NULL)
+         goto done;
+   }
+   ok = (fwrite(buffer, 1, size, fp) == size);
+   if(fclose(fp) != 0)
+      ok = FALSE;
+   if(!ok || rename(temp, path) != 0)
+   {
+      remove(temp);
+      ok = FALSE;
+   }
+
+done:
+   free(path);
+   free(temp);
+   free(refs);
+   free(buffer);
+   return(ok);
+}
+
+/************************************************************************/
+/*>static void HashBytes(uint64_t *hash, const void *data, size_t length)
+   ----------------------------------------------------------------------
+   I/O:     uint64_t   *hash   Two 64-bit lanes of the hash
+   Input:   const void *data   Bytes to add
+            size_t     length  and how many
+
+   Add bytes to a hash. The first lane is FNV-1a and the second a
+   different multiplicative hash, so that together they make a 128-bit
+   key.
+
+   18.10.26 Original    By: agent
+*/
+static void HashBytes(uint64_t *hash, const void *data, size_t length)
+{
+   const unsigned char *bytes = (const unsigned char *)data;
+   size_t              i;
+
+   for(i=0; i<length; i++)
+   {
+      hash[0] = (hash[0] ^ bytes[i]) * FNVPRIME;
+      hash[1] = (hash[1] + bytes[i] + 1) * MIXPRIME;
+   }
+}
+
+/************************************************************************/
+/*>static int CompareWordRefs(const void *a, const void *b)
+   --------------------------------------------------------
+   qsort()/bsearch() comparison of two references to word pointers, by
+   the address of the word
+
+   18.10.26 Original    By: agent
+*/
+static int CompareWordRefs(const void *a, const void *b)
+{
+   const char *wa = **(char **const *)a,
+              *wb = **(char **const *)b;
+
+   return((wa > wb) - (wa < wb));
+}
+
+/************************************************************************/
+/*>static BOOL ParseLetters(uint32_t *letters, const char *value)
+   --------------------------------------------------------------
+   Read a set of letters, in either case, as a bit for each with bit 0
+   for A. Returns FALSE if anything else is given.
+
+   18.10.26 Original    By: agent
+*/
+static BOOL ParseLetters(uint32_t *letters, const char *value)
+{
+   *letters = 0;
+   for(; *value; value++)
+   {
+      if(!isalpha((unsigned char)*value))
+         return(FALSE);
+      *letters |= (uint32_t)1 << (toupper((unsigned char)*value) - 'A');
+   }
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>static size_t PuzzleSize(int gridsize, int NWords)
+   --------------------------------------------------
+   Returns the size in bytes of a puzzle in a puzzle file, padded so
+   that the next starts on a PUZZLEALIGN boundary
+
+   18.10.26 Original    By: agent
+*/
+static size_t PuzzleSize(int gridsize, int NWords)
+{
+   size_t size = sizeof(PUZZLEHEADER) + NWords * sizeof(PUZZLEWORD) +
+                 (size_t)gridsize * gridsize;
+
+   return((size + PUZZLEALIGN - 1) / PUZZLEALIGN * PUZZLEALIGN);
+}
+
+/************************************************************************/
+/*>static void MakeRecords(const WSCONTEXT *ctx, PUZZLEWORD *records)
+   -------------------------------------------------------------------
+   Fill in a record of where each of the context's words is, from the
+   places kept as they were put in the grid, for a puzzle file or the
+   cache
+
+   18.10.26 Original    By: agent
+*/
+static void MakeRecords(const WSCONTEXT *ctx, PUZZLEWORD *records)
+{
+   const WORDPLACE *place;
+   int             i;
+
+   for(i=0; i<ctx->NWords; i++)
+   {
+      place                = &(ctx->places[i]);
+      records[i].start     = (uint32_t)place->y * ctx->options.gridSize +
+                             (uint32_t)place->x;
+      records[i].length    = (uint16_t)strlen(ctx->words[i]);
+      records[i].direction = (uint8_t)place->direction;
+      records[i].spare     = 0;
+   }
+}
+
+/************************************************************************/
+/*>static BOOL RecordInGrid(const PUZZLEWORD *record, int gridsize)
+   ----------------------------------------------------------------
+   Returns TRUE if a word record lies wholly within a grid of gridsize
+
+   18.10.26 Original    By: agent (split out of ValidPuzzle())
+*/
+static BOOL RecordInGrid(const PUZZLEWORD *record, int gridsize)
+{
+   const DIRECTION *dir;
+   int             x, y;
+
+   if(record->direction >= NDIRECTIONS || record->length < 1 ||
+      record->start >= (uint32_t)gridsize * gridsize)
+      return(FALSE);
+   dir = &(gDirections[record->direction]);
+   x   = (int)(record->start % gridsize) + dir->dx * (record->length - 1);
+   y   = (int)(record->start / gridsize) + dir->dy * (record->length - 1);
+
+   return(x >= 0 && x < gridsize && y >= 0 && y < gridsize);
+}
+
+/************************************************************************/
+/*>static BOOL ValidPuzzle(const char *data, size_t size)
+   ------------------------------------------------------
+   Returns TRUE if the size bytes at data start with a whole puzzle of a
+   puzzle file whose every word lies within its grid
+
+   18.10.26 Original    By: agent
+            Records are checked by RecordInGrid()
+*/
+static BOOL ValidPuzzle(const char *data, size_t size)
+{
+   const PUZZLEHEADER *header  = (const PUZZLEHEADER *)data;
+   const PUZZLEWORD   *records = (const PUZZLEWORD *)(header + 1);
+   int                i;
+
+   if(size < sizeof(PUZZLEHEADER) ||
+      memcmp(header->magic, PUZZLEMAGIC, sizeof(header->magic)) ||
+      header->gridSize < 1 || header->gridSize > UINT16_MAX ||
+      header->NWords > (size - sizeof(PUZZLEHEADER)) / sizeof(PUZZLEWORD)
+      || PuzzleSize((int)header->gridSize, (int)header->NWords) > size)
+      return(FALSE);
+
+   for(i=0; i<(int)header->NWords; i++)
+   {
+      if(!RecordInGrid(&(records[i]), (int)header->gridSize))
+         return(FALSE);
+   }
+
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>static int PickWords(WSCONTEXT *ctx, const WSWORDLIST *list,
+                        uint64_t seed)
+   ------------------------------------------------------------
+   Make the context's picked list from a list's own words followed by
+   words sampled from its index with the context's options. The picked
+   words are views into the list and the index so nothing is copied.
+   Returns WS_OK, WS_NOMEMORY or WS_NOWORDS.
+
+   18.10.26 Original    By: agent
+*/
+static int PickWords(WSCONTEXT *ctx, const WSWORDLIST *list,
+                     uint64_t seed)
+{
+   WSOPTIONS options = ctx->options;
+   int       i;
+
+   options.sample = FALSE;
+   if(ctx->picked != NULL && !wsResetWordList(ctx->picked, &options))
+   {
+      wsDestroyWordList(ctx->picked);
+      ctx->picked = NULL;
+   }
+   if(ctx->picked == NULL &&
+      (ctx->picked = wsCreateWordList(&options))==NULL)
+      return(WS_NOMEMORY);
+
+   for(i=0; i<list->NWords; i++)
+   {
+      if(!AddView(ctx->picked, list->words[i], list->lengths[i]))
+         return(WS_NOMEMORY);
+   }
+
+   if(wsSampleIndex(list->index, ctx->picked, &options, seed) < 0)
+      return(WS_NOMEMORY);
+
+   return(ctx->picked->NWords ? WS_OK : WS_NOWORDS);
+}
+
+/************************************************************************/
+/*>static int SampleBuckets(const WSINDEX *index, WSWORDLIST *list,
+                            const WSOPTIONS *options, int first, 
+                            int last, BOOL pooled, int want, WSRNG *rng)
+   ---------------------------------------------------------------------
+   Add want words picked at random from those of lengths first to last
+   of an index which match the letters of the options, or all of them
+   if there are fewer. If pooled is set, lengths with a quota are left
+   out. The matches are counted from the bitmaps, distinct ranks are
+   chosen among them and the words are then found by walking the
+   bitmaps again, or directly if no letters are given. Words already in
+   the list are skipped. Returns the number of words added or -1 if
+   memory allocation failed.
+
+   18.10.26 Original    By: agent
+*/
+static int SampleBuckets(const WSINDEX *index, WSWORDLIST *list,
+                         const WSOPTIONS *options, int first, int last,
+                         BOOL pooled, int want, WSRNG *rng)
+{
+   const INDEXBUCKET *bucket;
+   const uint64_t    *maps[NLETTERS];
+   const char        *word;
+   unsigned char     *matches = NULL; /* Matches in each bitmap word    */
+   uint64_t          *ranks,
+                     total = 0,
+                     base  = 0,
+                     bits  = 0,
+                     match;
+   size_t            nmap, w, 
+                     nwords = 0,
+                     m      = 0;
+   int               length, nwith, nmaps, j,
+                     next   = 0,
+                     added  = 0,
+                     status = 0;
+   BOOL              letters = (options->withLetters || 
+                                options->withoutLetters);
+
+   if(letters)
+   {
+      for(length=first; length<=last; length++)
+         nwords += MAPWORDS(index->buckets[length].count);
+      if((matches = (unsigned char *)malloc(nwords ? nwords : 1))==NULL)
+         return(-1);
+   }
+
+   for(length=first; length<=last; length++)
+   {
+      if(pooled && length <= WS_MAXQUOTA && options->quota[length] > 0)
+         continue;
+      bucket = &(index->buckets[length]);
+      if(!letters)
+      {
+         total += bucket->count;
+         continue;
+      }
+      nwith = LetterMaps(index, length, options->withLetters, maps);
+      nmaps = nwith + LetterMaps(index, length, options->withoutLetters,
+                                 maps + nwith);
+      nmap  = MAPWORDS(bucket->count);
+      for(w=0; w<nmap; w++, m++)
+      {
+         matches[m] = (unsigned char)
+                      CountBits(MatchBits(bucket, maps, nwith, nmaps, w));
+         total     += matches[m];
+      }
+   }
+
+   if((uint64_t)want > total)
+      want = (int)total;
+   if(want == 0 || (ranks = ChooseRanks(total, want, rng))==NULL)
+   {
+      free(matches);
+      return(want ? -1 : 0);
+   }
+
+   for(length=first, m=0; length<=last && next<want && status>=0; 
+       length++)
+   {
+      if(pooled && length <= WS_MAXQUOTA && options->quota[length] > 0)
+         continue;
+      bucket = &(index->buckets[length]);
+
+      /* Without letters every word matches and a rank is a word number */
+      if(!letters)
+      {
+         for(; next<want && ranks[next] < base + bucket->count; next++)
+         {
+            word = index->data + bucket->text + 
+                   (ranks[next] - base) * (length + 1);
+            if((status = AddPicked(list, word, length)) < 0)
+               break;
+            added += status;
+         }
+         base += bucket->count;
+         continue;
+      }
+
+      /* Otherwise only the bitmap words holding a chosen rank are read
+         again
+      */
+      nwith = LetterMaps(index, length, options->withLetters, maps);
+      nmaps = nwith + LetterMaps(index, length, options->withoutLetters,
+                                 maps + nwith);
+      nmap  = MAPWORDS(bucket->count);
+      for(w=0; w<nmap && next<want && status>=0; w++, m++)
+      {
+         if(ranks[next] < base + matches[m])
+            bits = MatchBits(bucket, maps, nwith, nmaps, w);
+         for(; next<want && ranks[next] < base + matches[m]; next++)
+         {
+            /* Clear the lower matches to find this one                 */
+            for(match=bits, j=(int)(ranks[next]-base); j; j--)
+               match &= match - 1;
+            word = index->data + bucket->text + 
+                   (w * BOARDBITS + LowestBit(match)) * (length + 1);
+            if((status = AddPicked(list, word, length)) < 0)
+               break;
+            added += status;
+         }
+         base += matches[m];
+      }
+   }
+
+   free(matches);
+   free(ranks);
+   return((status < 0) ? -1 : added);
+}
+
+/************************************************************************/
+/*>static int AddPicked(WSWORDLIST *list, const char *word, int length)
+   --------------------------------------------------------------------
+   Add a word picked from an index to a list unless it is there already.
+   The word's slot holds length letters and a NUL; a word from a damaged
+   index whose slot does not end in a NUL is not added, since it would
+   run on past its slot. Returns 1 if it was added, 0 if not or -1 if
+   memory allocation failed.
+
+   18.10.26 Original    By: agent
+            Skips words whose slot does not end in a NUL
+*/
+static int AddPicked(WSWORDLIST *list, const char *word, int length)
+{
+   int i;
+
+   if(word[length] != '\0')
+      return(0);
+   for(i=0; i<list->NWords; i++)
+   {
+      if(list->lengths[i] == length && 
+         !memcmp(list->words[i], word, length))
+         return(0);
+   }
+   return(AddView(list, (char *)word, length) ? 1 : -1);
+}
+
+/************************************************************************/
+/*>static int LetterMaps(const WSINDEX *index, int length, 
+                         uint32_t letters, const uint64_t **maps)
+   --------------------------------------------------------------
+   Fill in maps[] with the bitmaps of a bucket for a set of letters and
+   return how many there are
+
+   18.10.26 Original    By: agent
+*/
+static int LetterMaps(const WSINDEX *index, int length, uint32_t letters,
+                      const uint64_t **maps)
+{
+   const INDEXBUCKET *bucket = &(index->buckets[length]);
+   int               n       = 0;
+
+   for(; letters; letters &= letters - 1)
+   {
+      maps[n++] = (const uint64_t *)(index->data + bucket->bitmaps) +
+                  LowestBit(letters) * MAPWORDS(bucket->count);
+   }
+   return(n);
+}
+
+/************************************************************************/
+/*>static uint64_t MatchBits(const INDEXBUCKET *bucket, 
+                             const uint64_t **maps, int nwith, int nmaps,
+                             size_t word)
+   ----------------------------------------------------------------------
+   Returns the bits for one word of a bucket's bitmaps of the words which
+   are in all of the first nwith maps and none of the rest
+
+   18.10.26 Original    By: agent
+*/
+static uint64_t MatchBits(const INDEXBUCKET *bucket, 
+                          const uint64_t **maps, int nwith, int nmaps,
+                          size_t word)
+{
+   uint64_t bits = ~(uint64_t)0;
+   int      i;
+
+   if(word == MAPWORDS(bucket->count) - 1 && (bucket->count % BOARDBITS))
+      bits = ((uint64_t)1 << (bucket->count % BOARDBITS)) - 1;
+
+   for(i=0; i<nwith; i++)
+      bits &= maps[i][word];
+   for(; i<nmaps; i++)
+      bits &= ~maps[i][word];
+
+   return(bits);
+}
+
+/************************************************************************/
+/*>static uint64_t *ChooseRanks(uint64_t n, int k, WSRNG *rng)
+   -----------------------------------------------------------
+   Choose k distinct numbers from 0 to n-1 uniformly at random, with k
+   no more than n, and return them sorted in a malloc()'d array. This is
+   Floyd's algorithm, which takes k random numbers whatever the size of
+   n, with the numbers chosen so far kept in a hash set. Returns NULL if
+   memory allocation failed.
+
+   18.10.26 Original    By: agent
+*/
+static uint64_t *ChooseRanks(uint64_t n, int k, WSRNG *rng)
+{
+   uint64_t *ranks,
+            *set,
+            j, r;
+   size_t   size = 2,
+            i;
+   int      nranks = 0;
+
+   while(size < 2 * (size_t)k)
+      size *= 2;
+   if((ranks = (uint64_t *)malloc((k ? k : 1) * sizeof(uint64_t)))==NULL)
+      return(NULL);
+   if((set = (uint64_t *)malloc(size * sizeof(uint64_t)))==NULL)
+   {
+      free(ranks);
+      return(NULL);
+   }
+   for(i=0; i<size; i++)
+      set[i] = NORANK;
+
+   /* If r was chosen already then j, which cannot have been, is taken  */
+   for(j=n-k; j<n; j++)
+   {
+      r = RandomBelow(rng, j + 1);
+      if(!AddRank(set, size, r))
+      {
+         r = j;
+         AddRank(set, size, r);
+      }
+      ranks[nranks++] = r;
+   }
+
+   free(set);
+   qsort(ranks, k, sizeof(uint64_t), CompareRanks);
+   return(ranks);
+}
+
+/************************************************************************/
+/*>static BOOL AddRank(uint64_t *set, size_t size, uint64_t rank)
+   --------------------------------------------------------------
+   Add a number to an open addressed hash set of a power of two size
+   which is never full. Returns FALSE if it was there already.
+
+   18.10.26 Original    By: agent
+*/
+static BOOL AddRank(uint64_t *set, size_t size, uint64_t rank)
+{
+   size_t slot = (size_t)((rank * GOLDENGAMMA) >> 32) & (size - 1);
+
+   for(; set[slot] != NORANK; slot = (slot + 1) & (size - 1))
+   {
+      if(set[slot] == rank)
+         return(FALSE);
+   }
+   set[slot] = rank;
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>static int CompareRanks(const void *a, const void *b)
+   -----------------------------------------------------
+   qsort() comparison of two uint64_t
+
+   18.10.26 Original    By: agent
+*/
+static int CompareRanks(const void *a, const void *b)
+{
+   uint64_t ra = *(const uint64_t *)a,
+            rb = *(const uint64_t *)b;
+
+   return((ra > rb) - (ra < rb));
+}
+
+/************************************************************************/
+/*>static int CompareIndexWords(const void *a, const void *b)
+   ----------------------------------------------------------
+   qsort() comparison of two word pointers by length and then
+   alphabetically, the order of the words in an index
+
+   18.10.26 Original    By: agent
+*/
+static int CompareIndexWords(const void *a, const void *b)
+{
+   const char *wa = *(char *const *)a,
+              *wb = *(char *const *)b;
+   size_t     la  = strlen(wa),
+              lb  = strlen(wb);
+
+   if(la != lb)
+      return((la > lb) - (la < lb));
+   return(strcmp(wa, wb));
+}
+
+/************************************************************************/
+/*>static int CountBits(uint64_t bits)
+   -----------------------------------
+   Returns the number of set bits in a word
+
+   18.10.26 Original    By: agent
+*/
+static int CountBits(uint64_t bits)
+{
+#ifdef __GNUC__
+   return(__builtin_popcountll(bits));
+#else
+   int n = 0;
+
+   for(; bits; bits &= bits - 1)
+      n++;
+   return(n);
+#endif
+}
+
+/************************************************************************/
+/*>static uint64_t ClockNs(void)
+   -----------------------------
+   Returns the monotonic clock in ns
+
+   18.10.26 Original    By: agent
+*/
+static uint64_t ClockNs(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+/************************************************************************/
+/*>static int StatLength(int length)
+   ---------------------------------
+   Returns the index in the WSSTATS length arrays for a word length
+
+   18.10.26 Original    By: agent
+*/
+static int StatLength(int length)
+{
+   return((length < WS_MAXSTATLEN) ? length : WS_MAXSTATLEN);
+}
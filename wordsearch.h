@@ -0,0 +1,430 @@
+/*************************************************************************
+
+   Program:    WordSearch
+   File:       wordsearch.h
+
+   Version:    V2.24
+   Date:       18.10.26
+   Function:   Public interface to libwordsearch
+
+   Copyright:  (c) SciTech Software 1994-2026
+   Author:     Dr. Andrew C. R. Martin
+   Address:    SciTech Software
+               23, Stag Leys,
+               Ashtead,
+               Surrey,
+               KT21 2TD.
+   Phone:      +44 (0)1372 275775
+   EMail:      andrew@andrew-martin.org
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be freely copied
+   and distributed for no charge providing this header is included.
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work! The code may not be sold commercially without prior permission
+   from the author, although it may be given away free with commercial
+   products, providing it is made clear that this program is free and that
+   the source code is provided with the program.
+
+**************************************************************************
+
+   Description:
+   ============
+   The library keeps no global state. A WSCONTEXT holds everything needed
+   to build and render one puzzle at a time and a WSWORDLIST may be
+   shared read-only between any number of contexts, so separate threads
+   may each generate puzzles with their own context concurrently.
+
+   Typical use:
+      WSOPTIONS  options;
+      WSWORDLIST *words;
+      WSCONTEXT  *ctx;
+      WSSINK     sink;
+
+      wsDefaultOptions(&options);
+      words = wsCreateWordList(&options);
+      wsAddWord(words, "CAT");  ...
+      ctx   = wsCreateContext(&options);
+      if(wsGenerate(ctx, words, wsPuzzleSeed(options.seed, 0)) == WS_OK)
+         wsRender(ctx, wsFileSink(&sink, stdout));
+      wsDestroyContext(ctx);
+      wsDestroyWordList(words);
+
+   Output goes to a caller-supplied WSSINK whose write() function is
+   called with each block of output and should return the number of
+   bytes it accepted. PDF output is binary, since its pages are
+   compressed with zlib; programs using the library link with -lz.
+
+   The library has its own random number generator, so a puzzle depends
+   only on its seed, options and word list (unless searches are raced
+   with the portfolio option). wsPuzzleSeed() gives the
+   seed of each puzzle in a numbered series from one base seed.
+
+   Since a puzzle is fixed by its seed, options and words, it may be kept
+   in a cache directory given by the cache option. Entries hold the
+   grid, not the output, so a cached puzzle may be rendered in any style.
+   Any number of processes may share a cache directory.
+
+   A WSBOOK puts many puzzles in one document, with the prolog written
+   once and each page numbered and written as soon as it is given.
+   Solution pages are held in a temporary file and make up an answer
+   key at the end, so a book of any length needs the same memory. The
+   pages may be rendered in other threads:
+      book = wsCreateBook(&options, &sink);
+      for each puzzle
+         wsGenerate(...);
+         wsRenderPage(ctx, &pageSink, FALSE);    (into a buffer)
+         wsBookPage(book, buffer, length, FALSE);
+         and the same with TRUE for the solution page
+      wsFinishBook(book);
+
+   A large lexicon may be compiled once into a WSINDEX file with
+   wsWriteIndex(). Its words are bucketed by length, each bucket with a
+   bitmap for every letter of the words that contain it. An index is
+   mapped into memory by wsOpenIndex() and wsSampleIndex() picks words
+   at random from it, matching the length limits, quotas and with and
+   without letters of the options, without copying any of the text.
+   A word list given an index with wsSetIndex() has each puzzle's words
+   sampled by wsGenerate() from the puzzle's seed, after the list's own
+   words which are always used:
+      index = wsOpenIndex(fp);
+      wsSetIndex(words, index);      (words may be empty)
+      wsGenerate(ctx, words, seed);  ...
+      wsCloseIndex(index);
+   Indexes are written in the byte order of the machine.
+
+   A puzzle may be kept, to be rendered again later in any style, by
+   adding it to a puzzle file with wsWritePuzzle(). Each puzzle is a
+   small fixed-size header, a record of where each word starts, its
+   direction and length, and the grid letters, so a 20x20 puzzle of 30
+   words takes 664 bytes. The words and the solution are read back off
+   the grid. A puzzle file is mapped into memory by wsOpenPuzzles() and
+   wsLoadPuzzle() puts any one of its puzzles in a context as if it had
+   just been generated, ready for wsRender():
+      puzzles = wsOpenPuzzles(fp);
+      options.gridSize = wsPuzzleGridSize(puzzles);
+      ctx = wsCreateContext(&options);
+      for(i=0; i<wsPuzzleCount(puzzles); i++)
+         if(wsLoadPuzzle(ctx, puzzles, i) == WS_OK)
+            wsRender(ctx, &sink);
+      wsClosePuzzles(puzzles);
+   Like indexes, puzzle files are in the byte order of the machine.
+
+   A WSSOLVER finds every occurrence of a set of words in a grid, in all
+   eight directions. It is used by the verify option to check each
+   puzzle as it is generated, or may be used alone:
+      solver = wsCreateSolver(words, 0);
+      if(wsSolve(solver, grid, gridsize, gridsize+1) == WS_OK)
+         n = wsGetMatches(solver, &matches);
+      wsDestroySolver(solver);
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V2.0  18.10.26 Original   By: agent
+   V2.1  18.10.26 Added wsClearWordList()   By: agent
+   V2.2  18.10.26 Seeds are 64-bit. Added the seed option and
+                  wsPuzzleSeed()   By: agent
+   V2.3  18.10.26 Word lists have no size limit. Added wsSkippedWords()
+                  By: agent
+   V2.4  18.10.26 Added the sample, minlen and quota options   By: agent
+   V2.5  18.10.26 Added the portfolio option   By: agent
+   V2.6  18.10.26 Added wsGetStats()   By: agent
+   V2.7  18.10.26 WSSTATS counts rejected starts, words and placements
+                  by length, bytes written and, with the stats option,
+                  time spent. Added wsAddStats()   By: agent
+   V2.8  18.10.26 Added wsUpdateContext(), wsResetWordList() and the
+                  server option   By: agent
+   V2.9  18.10.26 Added the tile option. nThreads is also used by the
+                  library for tiled grids   By: agent
+   V2.10 18.10.26 Added the solver, wsGetWord() and the verify and solve
+                  options   By: agent
+   V2.11 18.10.26 Added the unique option   By: agent
+   V2.12 18.10.26 Words may run in all eight directions. Added the dirs
+                  option. WS_NDIRECTIONS is 8   By: agent
+   V2.13 18.10.26 Added the cache option and WSSTATS.cacheHits   By: agent
+   V2.14 18.10.26 Added books: wsRenderPage(), wsCreateBook(),
+                  wsBookPage(), wsFinishBook() and the book option   By: agent
+   V2.15 18.10.26 Added STYLE_PDF and the pdf option   By: agent
+   V2.16 18.10.26 Added word indexes: wsWriteIndex(), wsOpenIndex(),
+                  wsCloseIndex(), wsSetIndex(), wsSampleIndex(), the
+                  index, mkindex, with and without options and
+                  WS_NOWORDS   By: agent
+   V2.17 18.10.26 Added the dense option   By: agent
+   V2.18 18.10.26 Added the autoGrid option, WSSTATS.gridProbes and
+                  WSSTATS.gridCells. wsUpdateContext() may change the
+                  grid size   By: agent
+   V2.19 18.10.26 Added the deadlineMs and fallback options, WS_TIMEOUT,
+                  wsDroppedWords(), wsGetDropped(), WSSTATS.timeouts
+                  and WSSTATS.dropped   By: agent
+   V2.20 18.10.26 Added puzzle files: wsWritePuzzle(), wsOpenPuzzles(),
+                  wsPuzzleCount(), wsPuzzleGridSize(), wsLoadPuzzle(),
+                  wsClosePuzzles(), the save and render options and
+                  WS_TOOLARGE   By: agent
+   V2.21 18.10.26 Added the budget option, WS_GAVEUP and WSSTATS.gaveUp.
+                  Grid sizes below 1 are rejected   By: agent
+   V2.22 18.10.26 Added WSSTATS.gridSizes, gridMin and gridMax   By: agent
+   V2.23 18.10.26 Added WS_VERSION, the version given in output headers
+                  and the usage message   By: agent
+   V2.24 18.10.26 Added MAXPORTFOLIO   By: agent
+
+*************************************************************************/
+#ifndef _WORDSEARCH_H
+#define _WORDSEARCH_H
+
+/************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdint.h>
+
+/************************************************************************/
+/* Defines and macros
+*/
+#ifndef TRUE
+typedef int BOOL;
+#define TRUE          1
+#define FALSE         0
+#endif
+
+#define WS_VERSION "2.24"   /* Release version; kept the same as the
+                              Version: line at the top of this file     */
+
+#define STYLE_PS      1    /* Output styles                             */
+#define STYLE_LATEX   2
+#define STYLE_ASCII   3
+#define STYLE_PDF     4
+
+#define MAXWORDS     30    /* Most words in one puzzle                  */
+#define MAXWORDLEN   15
+#define GRIDSIZE     20
+#define MAXAUTOGRID 100    /* Largest grid tried by -g auto             */
+#define FONTSIZE     18
+#define NPUZZLES      1
+#define NTHREADS      1
+#define MAXPORTFOLIO 64    /* Most searches raced for one puzzle        */
+#define TILESIZE    256    /* Grids at least twice this size are tiled  */
+#define BUDGETPERWORD 1024UL /* Default placements the search may make, */
+#define BUDGETBASE  65536UL /* for each word and in all                 */
+#define WS_MAXQUOTA  32    /* Longest word length that may have a quota */
+#define WS_MAXSTATLEN 32   /* Longer words are counted with this length */
+#define WS_NDIRECTIONS 8   /* Placement directions                      */
+
+#define WS_DIR_E      0x01 /* Direction bits for options->directions,   */
+#define WS_DIR_S      0x02 /* in the order of WSSTATS.rejected[]        */
+#define WS_DIR_SE     0x04
+#define WS_DIR_W      0x08
+#define WS_DIR_N      0x10
+#define WS_DIR_NW     0x20
+#define WS_DIR_NE     0x40
+#define WS_DIR_SW     0x80
+#define WS_DIR_ALL    0xff
+#define WS_DIRECTIONS (WS_DIR_E | WS_DIR_S | WS_DIR_SE) /* Default      */
+
+#define WS_OK         0    /* Return codes                              */
+#define WS_NOMEMORY   1
+#define WS_NOFIT      2    /* The words cannot be fitted in the grid    */
+#define WS_WRITEERROR 3    /* The output sink did not accept the output */
+#define WS_BADOPTION  4    /* Unknown switch                            */
+#define WS_NOVALUE    5    /* Switch is missing its value               */
+#define WS_HELP       6    /* Help was requested                        */
+#define WS_NOPUZZLE   7    /* Nothing has been generated yet            */
+#define WS_BADVALUE   8    /* Switch has an invalid value               */
+#define WS_BADPUZZLE  9    /* Verification found a word missing         */
+#define WS_NOWORDS   10    /* No words in the index match the options   */
+#define WS_TIMEOUT   11    /* The deadline passed before the words were
+                              all placed                                */
+#define WS_TOOLARGE  12    /* A puzzle's grid is larger than the context
+                              was created for                           */
+#define WS_GAVEUP    13    /* The search stopped before it had placed the
+                              words or shown that they cannot be fitted */
+
+#define WS_FALLBACK_NONE    0 /* When the deadline passes: fail         */
+#define WS_FALLBACK_PARTIAL 1 /* Keep the most words the search placed  */
+#define WS_FALLBACK_DROP    2 /* and try each of the rest once more     */
+#define WS_FALLBACK_GROW    3 /* growing the grid for those left over   */
+
+/************************************************************************/
+/* Type definitions
+*/
+typedef struct             /* Everything set by the command line        */
+{
+   BOOL  solution,         /* Output the solution                       */
+         wordList;         /* Output the word list                      */
+   int   maxWords,
+         maxWordLen,
+         gridSize,
+         style,            /* STYLE_PS, STYLE_LATEX, STYLE_ASCII or
+                              STYLE_PDF                                 */
+         fontSize,         /* PostScript and PDF font size              */
+         nPuzzles,         /* Used by batch drivers, not the library    */
+         nThreads;         /* Threads for a batch or a tiled grid, 0 for
+                              one per CPU                               */
+   uint64_t seed;          /* Base seed for wsPuzzleSeed()              */
+   BOOL  sample;           /* Word lists keep a random sample of
+                              maxWords words rather than every word     */
+   int   minWordLen,       /* Shorter words are skipped                 */
+         quota[WS_MAXQUOTA+1], /* Words of each length in a sample      */
+         portfolio;        /* Searches raced for each puzzle            */
+   BOOL  stats;            /* Time each stage for wsGetStats()          */
+   const char *statsFile;  /* Used by drivers: where to write the stats,
+                              "-" for stderr                            */
+   const char *server;     /* Used by drivers: socket to serve requests
+                              on, "-" for stdin and stdout              */
+   int   directions;       /* WS_DIR_ bits for the directions words may
+                              run in                                    */
+   int   tileSize;         /* Grids at least twice this size are split
+                              into tiles of about this size which are
+                              filled in parallel, 0 for never           */
+   BOOL  verify,           /* Check each puzzle with a solver           */
+         unique;           /* Fill blanks without making extra copies
+                              of words                                  */
+   const char *solve;      /* Used by drivers: grid file to solve       */
+   const char *cache;      /* Directory of cached puzzles, NULL for none*/
+   BOOL  book;             /* Used by drivers: write the puzzles as one
+                              book with an answer key                   */
+   const char *index,      /* Used by drivers: word index to sample each
+                              puzzle's words from                       */
+         *makeIndex;       /* Used by drivers: write the words read to
+                              this word index                           */
+   uint32_t withLetters,   /* Words sampled from an index must have all
+                              of these letters (bit 0 is A)             */
+         withoutLetters;   /* and none of these                         */
+   BOOL  dense;            /* Place words where they share the most
+                              letters with those already placed         */
+   BOOL  autoGrid;         /* Use the smallest grid the words fit in,
+                              up to gridSize                            */
+   int   deadlineMs,       /* Time allowed for placing the words, 0 for
+                              no limit                                  */
+         fallback;         /* WS_FALLBACK_ value for when it runs out   */
+   const char *save;       /* Used by drivers: puzzle file to add each
+                              puzzle to                                 */
+   BOOL  render;           /* Used by drivers: render the puzzles of a
+                              puzzle file rather than build new ones    */
+   unsigned long budget;   /* Placements allowed for each puzzle, 0 for
+                              a default that grows with the words or,
+                              with deadlineMs, for no limit             */
+}  WSOPTIONS;
+
+typedef struct             /* Caller-supplied output destination        */
+{
+   size_t (*write)(void *handle, const char *buffer, size_t length);
+   void   *handle;
+}  WSSINK;
+
+typedef struct             /* Work done for the last puzzle             */
+{
+   unsigned long puzzles,    /* Puzzles generated                       */
+                 failures,   /* Puzzles that could not be built         */
+                 gaveUp,     /* Failures where the search stopped rather
+                                than showing the words cannot fit       */
+                 words,      /* Words to be placed                      */
+                 placements, /* Words put in the grid                   */
+                 backtracks, /* Words taken out again                   */
+                 lines,      /* Lines scanned for places to put a word  */
+                 conflicts,  /* Starts rejected as a letter clashed     */
+                 outOfBounds,/* Starts rejected as the word ran off the
+                                end of the line                         */
+                 duplicates, /* Extra occurrences of words found by the
+                                verify option                           */
+                 fillRejects,/* Fill letters that would have made a word
+                                with the unique option                  */
+                 fillForced, /* Cells where every letter made a word    */
+                 cacheHits,  /* Puzzles read from the cache             */
+                 gridProbes, /* Grid sizes tried with options->autoGrid */
+                 gridCells,  /* Cells in the grids of the puzzles built */
+                 gridSizes,  /* Sum of their sizes,                     */
+                 gridMin,    /* the smallest                            */
+                 gridMax,    /* and the largest                         */
+                 timeouts,   /* Puzzles whose deadline passed           */
+                 dropped,    /* Words left out by the fallback          */
+                 rejected[WS_NDIRECTIONS],   /* Starts rejected in each
+                                                direction               */
+                 lengthWords[WS_MAXSTATLEN+1], /* Words of each length  */
+                 lengthTries[WS_MAXSTATLEN+1]; /* and their placements  */
+   uint64_t      bytes,      /* Output passed to the sink               */
+                 fitNs,      /* Time placing the words,                 */
+                 fillNs,     /* filling the blanks,                     */
+                 verifyNs,   /* verifying                               */
+                 renderNs;   /* and rendering. Only with options->stats */
+}  WSSTATS;
+
+typedef struct             /* One occurrence of a word in a grid        */
+{
+   int word,               /* Index of the word in the solver's list    */
+       x, y,               /* Cell of its first letter, from 0          */
+       dx, dy;             /* Step to each following letter            */
+}  WSMATCH;
+
+typedef struct wscontext  WSCONTEXT;
+typedef struct wswordlist WSWORDLIST;
+typedef struct wssolver   WSSOLVER;
+typedef struct wsbook     WSBOOK;
+typedef struct wsindex    WSINDEX;
+typedef struct wspuzzles  WSPUZZLES;
+
+/************************************************************************/
+/* Prototypes
+*/
+void       wsDefaultOptions(WSOPTIONS *options);
+int        wsSetOption(WSOPTIONS *options, const char *name,
+                       const char *value, BOOL *usedValue);
+
+WSWORDLIST *wsCreateWordList(const WSOPTIONS *options);
+BOOL       wsAddWord(WSWORDLIST *list, const char *word);
+void       wsClearWordList(WSWORDLIST *list);
+BOOL       wsResetWordList(WSWORDLIST *list, const WSOPTIONS *options);
+int        wsReadWordList(WSWORDLIST *list, FILE *fp);
+int        wsWordCount(const WSWORDLIST *list);
+int        wsSkippedWords(const WSWORDLIST *list);
+const char *wsGetWord(const WSWORDLIST *list, int index);
+void       wsDestroyWordList(WSWORDLIST *list);
+
+int        wsWriteIndex(const WSWORDLIST *list, FILE *fp);
+WSINDEX    *wsOpenIndex(FILE *fp);
+void       wsSetIndex(WSWORDLIST *list, const WSINDEX *index);
+int        wsSampleIndex(const WSINDEX *index, WSWORDLIST *list,
+                         const WSOPTIONS *options, uint64_t seed);
+void       wsCloseIndex(WSINDEX *index);
+
+WSCONTEXT  *wsCreateContext(const WSOPTIONS *options);
+int        wsGenerate(WSCONTEXT *ctx, const WSWORDLIST *list,
+                      uint64_t seed);
+int        wsRender(WSCONTEXT *ctx, WSSINK *sink);
+BOOL       wsUpdateContext(WSCONTEXT *ctx, const WSOPTIONS *options);
+void       wsDestroyContext(WSCONTEXT *ctx);
+void       wsGetStats(const WSCONTEXT *ctx, WSSTATS *stats);
+int        wsDroppedWords(const WSCONTEXT *ctx);
+const char *wsGetDropped(const WSCONTEXT *ctx, int index);
+void       wsAddStats(WSSTATS *total, const WSSTATS *stats);
+
+int        wsWritePuzzle(WSCONTEXT *ctx, FILE *fp);
+WSPUZZLES  *wsOpenPuzzles(FILE *fp);
+int        wsPuzzleCount(const WSPUZZLES *puzzles);
+int        wsPuzzleGridSize(const WSPUZZLES *puzzles);
+int        wsLoadPuzzle(WSCONTEXT *ctx, const WSPUZZLES *puzzles,
+                        int index);
+void       wsClosePuzzles(WSPUZZLES *puzzles);
+
+WSSOLVER   *wsCreateSolver(const WSWORDLIST *list, int NWords);
+int        wsSolve(WSSOLVER *solver, const char *grid, int gridsize,
+                   int stride);
+int        wsGetMatches(WSSOLVER *solver, const WSMATCH **matches);
+int        wsWordMatches(const WSSOLVER *solver, int word);
+void       wsDestroySolver(WSSOLVER *solver);
+
+int        wsRenderPage(WSCONTEXT *ctx, WSSINK *sink, BOOL solution);
+WSBOOK     *wsCreateBook(const WSOPTIONS *options, WSSINK *sink);
+int        wsBookPage(WSBOOK *book, const char *page, size_t length,
+                      BOOL solution);
+int        wsFinishBook(WSBOOK *book);
+
+WSSINK     *wsFileSink(WSSINK *sink, FILE *fp);
+uint64_t   wsPuzzleSeed(uint64_t base, int index);
+const char *wsErrorString(int code);
+
+#endif